@@ -0,0 +1,27 @@
+#version 450
+
+// Depth prepass, same camera block as shader.vert
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 viewPos;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
+} ubo;
+
+// Per-draw, see DrawConstants
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+
+// Must match shader.vert bit for bit, the main pass tests with EQUAL
+invariant gl_Position;
+
+void main() {
+    mat4 model = ubo.model * draw.model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * worldPos;
+}
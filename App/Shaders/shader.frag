@@ -1,7 +1,44 @@
 #version 450
 
+// Matches ClusteredLighting.h
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+// Matches CascadedShadowMaps.h
+const uint SHADOW_CASCADE_COUNT = 4;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 viewPos;
+    uvec4 clusterGrid;    // x, y, z, light count
+    vec4 clusterParams;   // screen size, slice scale, slice bias
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 cascadeSplits;     // view space distance each cascade ends at
+    vec4 cascadeTexelSizes; // world space size of a shadow map texel
+    vec4 sunDirection;      // xyz direction the light travels, w 1 if any
+    vec4 sunColor;
+} ubo;
+
 layout(binding = 1) uniform sampler2D texSampler;
 
+struct Light {
+    vec4 positionRange;
+    vec4 colorCosInner;
+    vec4 directionCosOuter;
+};
+
+layout(std430, binding = 2) readonly buffer Lights {
+    Light lights[];
+};
+
+// Per cluster: light count, then MAX_LIGHTS_PER_CLUSTER light indices
+layout(std430, binding = 3) readonly buffer Clusters {
+    uint clusterLights[];
+};
+
+// One layer per cascade
+layout(binding = 4) uniform sampler2DArrayShadow shadowMap;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;
@@ -9,30 +46,103 @@ layout(location = 3) in vec3 fragPos;
 
 layout(location = 0) out vec4 outColor;
 
-const vec3 lightPos = vec3(0.0, 4.0, 0.0);   // world space
-const vec3 viewPos = vec3(0.0, 0.0, 5.0);    // TODO: move to uniform
+uint clusterIndex(float viewDepth) {
+    uvec3 grid = ubo.clusterGrid.xyz;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.clusterParams.xy * vec2(grid.xy)),
+                     grid.xy - 1u);
+
+    float slice = log(viewDepth) * ubo.clusterParams.z + ubo.clusterParams.w;
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1u)));
+
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+
+// 1 lit, 0 in shadow
+float sunShadow(vec3 norm, vec3 lightDir, float viewDepth) {
+    uint cascade = 0u;
+    while (cascade < SHADOW_CASCADE_COUNT && viewDepth > ubo.cascadeSplits[cascade])
+        cascade++;
+    if (cascade == SHADOW_CASCADE_COUNT)
+        return 1.0;
+
+    // Normal offset against acne, in texels of the cascade and growing
+    // with the slope to the light
+    float texelSize = ubo.cascadeTexelSizes[cascade];
+    float slope = 1.0 - max(dot(norm, lightDir), 0.0);
+    vec3 offsetPos = fragPos + norm * texelSize * (1.0 + 2.0 * slope);
+
+    vec4 shadowPos = ubo.cascadeViewProj[cascade] * vec4(offsetPos, 1.0);
+    vec3 coord = shadowPos.xyz / shadowPos.w;
+    vec2 uv = coord.xy * 0.5 + 0.5;
+
+    // 3x3 taps on top of the sampler's 2x2 compare filter
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * texel, float(cascade),
+                                           min(coord.z, 1.0)));
+        }
+    }
+    return lit / 9.0;
+}
 
 void main() {
     vec3 norm = normalize(fragNormal);
-
-    // Light direction
-    vec3 lightDir = normalize(lightPos - fragPos);
+    vec3 viewDir = normalize(ubo.viewPos.xyz - fragPos);
 
     // Ambient
     float ambientStrength = 0.15;
     vec3 ambient = ambientStrength * fragColor;
 
-    // Diffuse
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * fragColor;
-
-    // Specular
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
     float specularStrength = 0.4;
-    vec3 viewDir = normalize(viewPos - fragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
 
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * vec3(1.0);
+    float viewDepth = max(-(ubo.view * vec4(fragPos, 1.0)).z, 1e-4);
+
+    uint base = clusterIndex(viewDepth) * (MAX_LIGHTS_PER_CLUSTER + 1u);
+    uint count = clusterLights[base];
+    for (uint i = 0u; i < count; i++) {
+        Light light = lights[clusterLights[base + 1u + i]];
+
+        vec3 toLight = light.positionRange.xyz - fragPos;
+        float dist = length(toLight);
+        vec3 lightDir = toLight / max(dist, 1e-4);
+
+        // Smooth window to zero at the range, inverse square inside
+        float falloff = clamp(1.0 - pow(dist / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (dist * dist + 1.0);
+
+        // Point lights have cosOuter -2 and cosInner -1, always fully inside
+        // the cone
+        float cosAngle = dot(-lightDir, light.directionCosOuter.xyz);
+        attenuation *= smoothstep(light.directionCosOuter.w, light.colorCosInner.w, cosAngle);
+
+        vec3 radiance = light.colorCosInner.rgb * attenuation;
+
+        // Diffuse
+        float diff = max(dot(norm, lightDir), 0.0);
+        diffuse += diff * radiance * fragColor;
+
+        // Specular
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+        specular += specularStrength * spec * radiance;
+    }
+
+    // Directional sun, the only shadowed light
+    if (ubo.sunDirection.w > 0.0) {
+        vec3 lightDir = -normalize(ubo.sunDirection.xyz);
+        vec3 radiance = ubo.sunColor.rgb * sunShadow(norm, lightDir, viewDepth);
+
+        float diff = max(dot(norm, lightDir), 0.0);
+        diffuse += diff * radiance * fragColor;
+
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+        specular += specularStrength * spec * radiance;
+    }
 
     vec3 texColor = texture(texSampler, fragTexCoord).rgb;
 
@@ -4,8 +4,16 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
+    vec4 viewPos;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
 } ubo;
 
+// Per-draw, see DrawConstants
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+} draw;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
@@ -16,13 +24,18 @@ layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec3 fragPos;
 
+// Must match depth.vert bit for bit, the depth prepass is tested with EQUAL
+invariant gl_Position;
+
 void main() {
+    mat4 model = ubo.model * draw.model;
+
     // World space position
-    vec4 worldPos = ubo.model * vec4(inPosition, 1.0);
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     fragPos = worldPos.xyz;
 
     // Proper normal transform
-    mat3 normalMatrix = transpose(inverse(mat3(ubo.model)));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
     fragNormal = normalize(normalMatrix * inNormals);
 
     fragColor = inColor;
@@ -0,0 +1,28 @@
+#version 450
+
+// Matches SHADOW_CASCADE_COUNT in CascadedShadowMaps.h
+const uint SHADOW_CASCADE_COUNT = 4;
+
+// Shadow cascades, the camera block up to the cascade matrices
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 viewPos;
+    uvec4 clusterGrid;
+    vec4 clusterParams;
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+} ubo;
+
+// Per-draw, see DrawConstants. The cascade is pushed once per pass.
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+    uint cascade;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    mat4 model = ubo.model * draw.model;
+    gl_Position = ubo.cascadeViewProj[draw.cascade] * model * vec4(inPosition, 1.0);
+}
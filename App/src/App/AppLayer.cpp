@@ -9,16 +9,132 @@
 #include <GLFW/glfw3.h>
 #include <cstdint>
 #include <glm/glm.hpp>
+#include <print>
 
-#define VERT_SHADER_PATH "../App/Shaders/vert.spv"
-#define FRAG_SHADER_PATH "../App/Shaders/frag.spv"
+// GLSL sources, compiled at startup and recompiled on save in debug builds
+#define VERT_SHADER_PATH "../App/Shaders/shader.vert"
+#define FRAG_SHADER_PATH "../App/Shaders/shader.frag"
+#define CLUSTER_SHADER_PATH "../App/Shaders/cluster_lights.comp"
+#define DEPTH_VERT_SHADER_PATH "../App/Shaders/depth.vert"
+#define SHADOW_VERT_SHADER_PATH "../App/Shaders/shadow.vert"
+// Compressed by TextureCompiler into the build tree, see App/CMakeLists.txt.
+// Relative to the build directory the app runs from, like the shaders.
+#define TEXTURE_PATH "App/textures/mondongo.ktx2"
+
+// World space extent one repeat of the texture is mapped onto
+const float TEXTURE_WORLD_SIZE = 10.0f;
+
+// Small colored point lights laid out on a grid over the floor, on top of
+// the main light
+const uint32_t LIGHT_GRID_SIZE = 16;
+const float LIGHT_GRID_SPACING = 2.5f;
+
+// GPU budget dynamic resolution keeps frames in, leaves room for vsync at
+// 60 Hz
+const float GPU_FRAME_BUDGET_MS = 14.0f;
+
+// Radians per second the dragon turns on its pedestal
+const float DRAGON_SPIN_SPEED = 0.5f;
+const glm::vec3 DRAGON_SPIN_AXIS(0.0f, 1.0f, 0.0f);
+
+// Entities in the ring of small dragons, each orbiting at its own speed
+const uint32_t DRAGON_RING_COUNT = 32;
+const float DRAGON_RING_RADIUS = 12.0f;
+const float DRAGON_RING_SCALE = 0.25f;
+
+struct OrbitComponent {
+  float angle;
+  float speed;
+};
+
+// Proxy of the entity in AppLayer::m_bvh
+struct CullComponent {
+  uint32_t proxy;
+};
+
+// Cycled through with L, the input to present latency of each is printed
+struct PresentPolicyPreset {
+  const char *name;
+  PresentPolicy policy;
+};
+const PresentPolicyPreset PRESENT_POLICIES[] = {
+    {"mailbox", {VK_PRESENT_MODE_MAILBOX_KHR, 0, 0.0f, 0}},
+    {"fifo", {VK_PRESENT_MODE_FIFO_KHR, 0, 0.0f, 0}},
+    {"fifo, 2 images, 1 queued", {VK_PRESENT_MODE_FIFO_KHR, 2, 0.0f, 1}},
+    {"immediate, 120 fps cap", {VK_PRESENT_MODE_IMMEDIATE_KHR, 0, 120.0f, 0}},
+};
+const uint32_t PRESENT_POLICY_COUNT =
+    sizeof(PRESENT_POLICIES) / sizeof(PRESENT_POLICIES[0]);
 
 AppLayer::AppLayer() {
-  m_renderer.Init(VERT_SHADER_PATH, FRAG_SHADER_PATH);
+  m_EventHandlers.Bind<Core::WindowClosedEvent, &AppLayer::onWindowClose>(this);
+  m_EventHandlers.Bind<Core::WindowResizeEvent, &AppLayer::onWindownResize>(
+      this);
+
+  m_renderer.Init(VERT_SHADER_PATH, FRAG_SHADER_PATH, CLUSTER_SHADER_PATH,
+                  DEPTH_VERT_SHADER_PATH, SHADOW_VERT_SHADER_PATH);
+  // Decoded in the background, white until the upload lands. Streamed, so
+  // only the levels needed at the current camera distance stay resident.
+  m_texture = m_renderer.LoadTexture(TEXTURE_PATH, true);
+  m_renderer.SetTexture(m_texture);
+
+  DynamicResolutionSettings resolution;
+  resolution.enabled = true;
+  resolution.targetFrameMs = GPU_FRAME_BUDGET_MS;
+  resolution.minScale = 0.5f;
+  resolution.maxScale = 1.0f;
+  m_renderer.SetDynamicResolution(resolution);
   Mesh dragonMesh("/home/ironowl/Downloads/dragon/dragon.obj");
   Mesh spooza("/home/ironowl/Downloads/sponza/sponza.obj");
-  m_dragonMeshId = m_renderer.addObject(dragonMesh);
-  m_spoozaMeshId = m_renderer.addObject(spooza);
+  m_sponzaNode = m_scene.createNode();
+  m_scene.setMesh(m_sponzaNode, m_renderer.addObject(spooza));
+  uint32_t dragonObjID = m_renderer.addObject(dragonMesh);
+  m_dragonNode = m_scene.createNode(m_sponzaNode);
+  m_scene.setMesh(m_dragonNode, dragonObjID);
+
+  for (uint32_t i = 0; i < DRAGON_RING_COUNT; i++) {
+    OrbitComponent orbit;
+    orbit.angle = glm::two_pi<float>() * i / DRAGON_RING_COUNT;
+    orbit.speed = 0.2f + 0.1f * (i % 4);
+    // Placed by the first update
+    uint32_t proxy = m_bvh.createProxy(m_renderer.GetObjectBounds(dragonObjID));
+    Core::Entity entity =
+        m_world.create(orbit, MeshComponent{dragonObjID}, TransformComponent{},
+                       MaterialComponent{}, VisibilityComponent{},
+                       CullComponent{proxy});
+    m_proxyEntities.resize(std::max<size_t>(m_proxyEntities.size(), proxy + 1));
+    m_proxyEntities[proxy] = entity;
+  }
+
+  // Shadowed, the distant cascades stay cached while it does not move
+  Light sun;
+  sun.type = LightType::Directional;
+  sun.direction = glm::normalize(glm::vec3(-0.3f, -1.0f, -0.2f));
+  sun.color = glm::vec3(1.0f, 0.95f, 0.85f);
+  sun.intensity = 1.0f;
+  m_lights.push_back(sun);
+
+  Light mainLight;
+  mainLight.position = glm::vec3(0.0f, 4.0f, 0.0f);
+  mainLight.range = 50.0f;
+  mainLight.intensity = 20.0f;
+  m_lights.push_back(mainLight);
+
+  float gridOffset = (LIGHT_GRID_SIZE - 1) * LIGHT_GRID_SPACING * 0.5f;
+  for (uint32_t x = 0; x < LIGHT_GRID_SIZE; x++) {
+    for (uint32_t z = 0; z < LIGHT_GRID_SIZE; z++) {
+      Light light;
+      light.position = glm::vec3(x * LIGHT_GRID_SPACING - gridOffset, 0.5f,
+                                 z * LIGHT_GRID_SPACING - gridOffset);
+      light.range = 3.0f;
+      light.intensity = 2.0f;
+      light.color = glm::vec3((x % 3) == 0, (z % 3) == 0, ((x + z) % 3) == 0);
+      if (light.color == glm::vec3(0.0f))
+        light.color = glm::vec3(1.0f, 0.6f, 0.2f);
+      m_lights.push_back(light);
+    }
+  }
+
   m_camera.init(45.0f,
                 Core::Application::Get().getFramebufferSize().x /
                     Core::Application::Get().getFramebufferSize().y,
@@ -70,6 +186,66 @@ void AppLayer::OnUpdate(float ts) {
   if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
     rotation.y += rotateSpeed * ts;
 
+  // F toggles a wireframe permutation for the dragon
+  bool wireframeKeyDown = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+  if (wireframeKeyDown && !m_wireframeKeyDown) {
+    m_wireframe = !m_wireframe;
+    m_scene.setPipelineState(m_dragonNode, m_wireframe
+                                               ? PipelineState::wireframe()
+                                               : PipelineState::opaque());
+  }
+  m_wireframeKeyDown = wireframeKeyDown;
+
+  // P toggles the depth prepass, compare the fragment invocations printed
+  // below in both modes
+  bool depthPrepassKeyDown = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+  if (depthPrepassKeyDown && !m_depthPrepassKeyDown)
+    m_renderer.SetDepthPrepass(!m_renderer.IsDepthPrepassEnabled());
+  m_depthPrepassKeyDown = depthPrepassKeyDown;
+
+  // R toggles dynamic resolution
+  bool resolutionKeyDown = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+  if (resolutionKeyDown && !m_resolutionKeyDown) {
+    DynamicResolutionSettings resolution = m_renderer.GetDynamicResolution();
+    resolution.enabled = !resolution.enabled;
+    m_renderer.SetDynamicResolution(resolution);
+  }
+  m_resolutionKeyDown = resolutionKeyDown;
+
+  // L cycles the presentation policies
+  bool presentPolicyKeyDown = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+  if (presentPolicyKeyDown && !m_presentPolicyKeyDown) {
+    m_presentPolicy = (m_presentPolicy + 1) % PRESENT_POLICY_COUNT;
+    m_renderer.SetPresentPolicy(PRESENT_POLICIES[m_presentPolicy].policy);
+  }
+  m_presentPolicyKeyDown = presentPolicyKeyDown;
+
+  m_statsTimer += ts;
+  if (m_statsTimer >= 1.0f) {
+    m_statsTimer = 0.0f;
+    if (std::optional<uint64_t> invocations =
+            m_renderer.GetFragmentInvocations())
+      std::println("Fragment invocations ({}): {}",
+                   m_renderer.IsDepthPrepassEnabled() ? "depth prepass"
+                                                      : "no prepass",
+                   *invocations);
+    if (std::optional<double> gpuMs = m_renderer.GetGpuFrameMs())
+      std::println("GPU frame: {:.2f} ms, resolution scale {:.2f}", *gpuMs,
+                   m_renderer.GetResolutionScale());
+
+    const DrawStats &draws = m_renderer.GetDrawStats();
+    std::println("Draws: {}, pipeline binds {}, descriptor binds {}",
+                 draws.draws, draws.pipelineBinds, draws.descriptorBinds);
+
+    const PresentStats &present = m_renderer.GetPresentStats();
+    std::println("Input to {} ({}, {} images): {:.2f} ms average, {:.2f} ms "
+                 "max over {} frames",
+                 present.measuresDisplay ? "display" : "present",
+                 PRESENT_POLICIES[m_presentPolicy].name, present.imageCount,
+                 present.averageLatencyMs, present.maxLatencyMs,
+                 present.samples);
+  }
+
   // Optional: Clamp pitch to prevent camera flipping
   rotation.x = glm::clamp(rotation.x, -glm::half_pi<float>() + 0.01f,
                           glm::half_pi<float>() - 0.01f);
@@ -78,30 +254,97 @@ void AppLayer::OnUpdate(float ts) {
   m_camera.setPosition(position);
   m_camera.setRotation(rotation);
   m_renderer.UpdateUniformBuffer(m_camera);
-}
 
-void AppLayer::OnRender() {
-  m_renderer.BeginDraw();
-  m_renderer.DrawObject(m_dragonMeshId);
-  m_renderer.DrawObject(m_spoozaMeshId);
-  m_renderer.EndDraw();
+  m_dragonAngle += DRAGON_SPIN_SPEED * ts;
+  m_scene.setRotation(m_dragonNode,
+                      glm::angleAxis(m_dragonAngle, DRAGON_SPIN_AXIS));
+  m_scene.update();
+
+  m_world.parallelEach<OrbitComponent, TransformComponent>(
+      m_renderer.GetData().threadPool,
+      [ts](OrbitComponent &orbit, TransformComponent &transform) {
+        orbit.angle += orbit.speed * ts;
+        glm::vec3 position(cos(orbit.angle) * DRAGON_RING_RADIUS, 0.0f,
+                           sin(orbit.angle) * DRAGON_RING_RADIUS);
+        transform.world = glm::translate(glm::mat4(1.0f), position) *
+                          glm::rotate(glm::mat4(1.0f), -orbit.angle,
+                                      DRAGON_SPIN_AXIS) *
+                          glm::scale(glm::mat4(1.0f),
+                                     glm::vec3(DRAGON_RING_SCALE));
+      });
+  // Proxies are only reinserted once they leave their fattened bounds
+  m_world.each<MeshComponent, TransformComponent, CullComponent>(
+      [this](const MeshComponent &mesh, const TransformComponent &transform,
+             const CullComponent &cull) {
+        m_bvh.moveProxy(cull.proxy,
+                        AABB::transform(m_renderer.GetObjectBounds(mesh.objID),
+                                        transform.world));
+      });
+
+  // Left click picks the nearest ring dragon under the cursor by its bounds
+  bool pickButtonDown =
+      glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+  if (pickButtonDown && !m_pickButtonDown) {
+    double cursorX, cursorY;
+    int windowWidth, windowHeight;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    glm::vec2 ndc(2.0f * cursorX / windowWidth - 1.0f,
+                  2.0f * cursorY / windowHeight - 1.0f);
+
+    glm::mat4 invViewProj = glm::inverse(m_camera.getProjectionMatrix() *
+                                         m_camera.getViewMatrix());
+    glm::vec4 nearPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 0.0f, 1.0f);
+    glm::vec4 farPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction =
+        glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+    std::optional<uint32_t> picked;
+    m_bvh.raycast(origin, direction, m_camera.getFar(),
+                  [&picked](uint32_t proxy, float distance) {
+                    picked = proxy;
+                    return distance;
+                  });
+    if (picked)
+      std::println("Picked ring dragon {}", m_proxyEntities[*picked].index);
+  }
+  m_pickButtonDown = pickButtonDown;
+
+  float screenPixels = TextureResidency::estimateScreenSize(
+      TEXTURE_WORLD_SIZE, glm::length(position),
+      glm::radians(m_camera.getFov()),
+      Core::Application::Get().getFramebufferSize().y);
+  m_renderer.RequestTextureDetail(m_texture, screenPixels);
 }
 
-void AppLayer::OnEvent(Event &event) {
-  EventDispatcher dispatcher(event);
-  dispatcher.Dispatch<Core::WindowClosedEvent>(
-      [this](Core::WindowClosedEvent &e) { return onWindowClose(e); });
+void AppLayer::OnRender() {
+  if (!m_renderer.BeginDraw())
+    return;
+  for (const Light &light : m_lights)
+    m_renderer.SubmitLight(light);
+  m_renderer.SubmitScene(m_scene);
 
-  dispatcher.Dispatch<Core::WindowResizeEvent>(
-      [this](Core::WindowResizeEvent &e) { return onWindownResize(e); });
+  // Ring dragons the BVH finds outside the view only cast shadows
+  Frustum frustum = Frustum::fromViewProj(m_camera.getProjectionMatrix() *
+                                          m_camera.getViewMatrix());
+  m_proxyVisible.assign(m_proxyEntities.size(), false);
+  m_bvh.queryFrustum(frustum,
+                     [this](uint32_t proxy) { m_proxyVisible[proxy] = true; });
+  m_world.each<CullComponent, VisibilityComponent>(
+      [this](const CullComponent &cull, VisibilityComponent &visibility) {
+        visibility.visible = m_proxyVisible[cull.proxy];
+      });
+  m_renderer.SubmitWorld(m_world);
+  m_renderer.EndDraw();
 }
 
-bool AppLayer::onWindownResize(Core::WindowResizeEvent &e) {
+bool AppLayer::onWindownResize(const Core::WindowResizeEvent &e) {
   m_renderer.OnFrameBufferResize();
-  m_camera.setAspectRatio((float)e.GetWidth() / e.GetHeight());
+  m_camera.setAspectRatio((float)e.Width / e.Height);
   return false;
 }
-bool AppLayer::onWindowClose(Event &e) {
+bool AppLayer::onWindowClose(const Core::WindowClosedEvent &e) {
   Core::Application::Get().Stop();
 
   return true;
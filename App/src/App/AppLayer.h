@@ -2,12 +2,15 @@
 
 #include <cstdint>
 #include <stdint.h>
+#include <vector>
 
 #include "Core/Events/Event.h"
+#include "Core/ECS/World.h"
 #include "Core/Events/WindowEvents.h"
 #include "Core/Layer.h"
 #include "Renderer.h"
 #include "Scene/Camera/Camera.h"
+#include "Scene/SceneGraph/SceneGraph.h"
 
 class AppLayer : public Core::Layer {
 public:
@@ -17,11 +20,9 @@ public:
   virtual void OnUpdate(float ts) override;
   virtual void OnRender() override;
 
-  virtual void OnEvent(Event &event) override;
-
 private:
-  bool onWindownResize(Core::WindowResizeEvent &e);
-  bool onWindowClose(Event &e);
+  bool onWindownResize(const Core::WindowResizeEvent &e);
+  bool onWindowClose(const Core::WindowClosedEvent &e);
 
 private:
   uint32_t m_Shader = 0;
@@ -30,6 +31,29 @@ private:
 
   Renderer m_renderer;
   Camera m_camera;
-  uint32_t m_dragonMeshId;
-  uint32_t m_spoozaMeshId;
+  // Sponza at the root, the dragon placed inside it
+  SceneGraph m_scene;
+  SceneNode m_sponzaNode;
+  SceneNode m_dragonNode;
+  float m_dragonAngle = 0.0f;
+  // A ring of dragons circling the one in the scene graph
+  Core::World m_world;
+  // Bounds of the ring dragons, culled against the camera and picked with
+  // the left mouse button
+  BVH m_bvh;
+  std::vector<Core::Entity> m_proxyEntities;
+  // By proxy, whether the last frustum query found it
+  std::vector<bool> m_proxyVisible;
+  bool m_pickButtonDown = false;
+  TextureHandle m_texture;
+  std::vector<Light> m_lights;
+  bool m_wireframe = false;
+  bool m_wireframeKeyDown = false;
+  bool m_depthPrepassKeyDown = false;
+  bool m_resolutionKeyDown = false;
+  // Into PRESENT_POLICIES
+  uint32_t m_presentPolicy = 0;
+  bool m_presentPolicyKeyDown = false;
+  // Time since the frame stats were last printed
+  float m_statsTimer = 0.0f;
 };
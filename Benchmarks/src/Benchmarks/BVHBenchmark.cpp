@@ -0,0 +1,152 @@
+#include "Scene/BVH/BVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <glm/gtc/matrix_transform.hpp>
+#include <print>
+#include <random>
+#include <vector>
+
+// Boxes are scattered through a cube of this half extent
+const float WORLD_HALF_EXTENT = 500.0f;
+// Queries timed per path, the average is printed
+const uint32_t QUERY_COUNT = 200;
+
+using Clock = std::chrono::steady_clock;
+
+static double microseconds(Clock::time_point begin, Clock::time_point end) {
+  return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+// Slab test, what the brute force ray cast runs against every box
+static bool intersectRay(const AABB &bounds, const glm::vec3 &origin,
+                         const glm::vec3 &invDirection, float maxDistance,
+                         float &distance) {
+  glm::vec3 t0 = (bounds.min - origin) * invDirection;
+  glm::vec3 t1 = (bounds.max - origin) * invDirection;
+  glm::vec3 tMin = glm::min(t0, t1);
+  glm::vec3 tMax = glm::max(t0, t1);
+  float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+  float exit =
+      std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+  distance = enter;
+  return enter <= exit;
+}
+
+static void run(uint32_t count) {
+  std::mt19937 rng(count);
+  std::uniform_real_distribution<float> position(-WORLD_HALF_EXTENT,
+                                                 WORLD_HALF_EXTENT);
+  std::uniform_real_distribution<float> size(0.5f, 3.0f);
+  std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+
+  std::vector<AABB> boxes(count);
+  for (AABB &box : boxes) {
+    glm::vec3 center(position(rng), position(rng), position(rng));
+    glm::vec3 extent(size(rng));
+    box = {center - extent, center + extent};
+  }
+
+  // Camera at the center looking down -z, sees a few percent of the boxes
+  glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(45.0f), 16.0f / 9.0f,
+                                         0.1f, 1000.0f);
+  Frustum frustum = Frustum::fromViewProj(proj);
+  AABB region = {glm::vec3(-50.0f), glm::vec3(50.0f)};
+  std::vector<glm::vec3> rayOrigins(QUERY_COUNT);
+  for (glm::vec3 &origin : rayOrigins) {
+    origin = glm::vec3(position(rng), position(rng), -WORLD_HALF_EXTENT);
+  }
+  glm::vec3 rayDirection(0.0f, 0.0f, 1.0f);
+  float rayLength = 2.0f * WORLD_HALF_EXTENT;
+
+  BVH bvh;
+  Clock::time_point begin = Clock::now();
+  bvh.build(boxes);
+  double buildUs = microseconds(begin, Clock::now());
+
+  // Counted and printed so the loops are not optimized away
+  uint64_t bvhHits = 0;
+  uint64_t bruteHits = 0;
+
+  begin = Clock::now();
+  for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+    bvh.queryFrustum(frustum, [&](uint32_t) { bvhHits++; });
+  }
+  double frustumBvhUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+  begin = Clock::now();
+  for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+    for (const AABB &box : boxes) {
+      bruteHits += frustum.test(box) != Frustum::Result::Outside;
+    }
+  }
+  double frustumBruteUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+  uint64_t visible = bruteHits / QUERY_COUNT;
+
+  begin = Clock::now();
+  for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+    bvh.queryAABB(region, [&](uint32_t) { bvhHits++; });
+  }
+  double aabbBvhUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+  begin = Clock::now();
+  for (uint32_t i = 0; i < QUERY_COUNT; i++) {
+    for (const AABB &box : boxes) {
+      bruteHits += box.overlaps(region);
+    }
+  }
+  double aabbBruteUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+
+  // Nearest hit along each ray
+  begin = Clock::now();
+  for (const glm::vec3 &origin : rayOrigins) {
+    bvh.raycast(origin, rayDirection, rayLength,
+                [&](uint32_t, float distance) {
+                  bvhHits++;
+                  return distance;
+                });
+  }
+  double rayBvhUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+  begin = Clock::now();
+  glm::vec3 invDirection = 1.0f / rayDirection;
+  for (const glm::vec3 &origin : rayOrigins) {
+    float nearest = rayLength;
+    bool hit = false;
+    for (const AABB &box : boxes) {
+      float distance;
+      if (intersectRay(box, origin, invDirection, nearest, distance)) {
+        nearest = distance;
+        hit = true;
+      }
+    }
+    bruteHits += hit;
+  }
+  double rayBruteUs = microseconds(begin, Clock::now()) / QUERY_COUNT;
+
+  // Every box takes a small step, most stay inside their fattened leaf
+  for (AABB &box : boxes) {
+    glm::vec3 offset(step(rng), step(rng), step(rng));
+    box = {box.min + offset * 0.1f, box.max + offset * 0.1f};
+  }
+  begin = Clock::now();
+  for (uint32_t proxy = 0; proxy < count; proxy++) {
+    bvh.moveProxy(proxy, boxes[proxy]);
+  }
+  double moveUs = microseconds(begin, Clock::now());
+
+  std::println("{} boxes, {} visible, built in {:.1f} us", count, visible,
+               buildUs);
+  std::println("  frustum   bvh {:10.2f} us  brute force {:10.2f} us",
+               frustumBvhUs, frustumBruteUs);
+  std::println("  aabb      bvh {:10.2f} us  brute force {:10.2f} us",
+               aabbBvhUs, aabbBruteUs);
+  std::println("  raycast   bvh {:10.2f} us  brute force {:10.2f} us",
+               rayBvhUs, rayBruteUs);
+  std::println("  move all  {:.1f} us, {} reinserted, {} hits", moveUs,
+               bvh.getReinsertCount(), bvhHits + bruteHits);
+}
+
+int main() {
+  for (uint32_t count : {1000u, 10000u, 100000u}) {
+    run(count);
+  }
+}
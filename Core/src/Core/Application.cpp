@@ -20,10 +20,6 @@ Application::Application(const ApplicationSpec &specification)
     : m_Specification(specification) {
   s_Application = this;
 
-  m_Specification.Window.EventCallback = [this](Event &event) {
-    RaiseEvent(event);
-  };
-
   m_Window = std::make_unique<Window>(m_Specification.Window);
 
   m_Window->create();
@@ -47,7 +43,10 @@ void Application::Run() {
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
+    // GLFW callbacks queue the events, layers see them once per frame
     m_Window->update();
+    m_Window->getEventQueue().Drain(
+        [this](Event &event) { RaiseEvent(event); });
 
     for (const std::unique_ptr<Layer> &layer : m_LayerStack)
       layer->OnUpdate(deltaTime);
@@ -60,7 +59,7 @@ void Application::Run() {
 
 void Application::RaiseEvent(Event &event) {
   for (int i = m_LayerStack.size() - 1; i >= 0; i--) {
-    m_LayerStack[i]->OnEvent(event);
+    m_LayerStack[i]->GetEventHandlers().Dispatch(event);
     if (event.Handled)
       break;
   }
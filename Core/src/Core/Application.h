@@ -27,6 +27,7 @@ public:
     m_LayerStack.push_back(std::make_unique<TLayer>());
   }
 
+  // Dispatches to the layers right away, top of the stack first
   void RaiseEvent(Event &event);
 
   glm::vec2 getFramebufferSize() const;
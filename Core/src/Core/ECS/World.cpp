@@ -0,0 +1,193 @@
+#include "World.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace Core {
+
+namespace {
+
+std::mutex s_componentMutex;
+std::array<ComponentInfo, MAX_COMPONENTS> s_components;
+uint32_t s_componentCount = 0;
+
+uint32_t alignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+ComponentId registerComponent(uint32_t size, uint32_t alignment) {
+  std::lock_guard lock(s_componentMutex);
+  if (s_componentCount == MAX_COMPONENTS) {
+    throw std::runtime_error("too many component types!");
+  }
+  s_components[s_componentCount] = {size, alignment};
+  return s_componentCount++;
+}
+
+const ComponentInfo &getComponentInfo(ComponentId id) {
+  return s_components[id];
+}
+
+void World::destroy(Entity entity) {
+  EntityRecord &record = getRecord(entity);
+  removeRow(record.archetype, record.chunk, record.row);
+  record.generation++;
+  m_freeEntities.push_back(entity.index);
+  m_entityCount--;
+}
+
+bool World::isAlive(Entity entity) const {
+  return entity.index < m_records.size() &&
+         m_records[entity.index].generation == entity.generation;
+}
+
+Entity World::allocateEntity() {
+  uint32_t index;
+  if (!m_freeEntities.empty()) {
+    index = m_freeEntities.back();
+    m_freeEntities.pop_back();
+  } else {
+    index = static_cast<uint32_t>(m_records.size());
+    m_records.emplace_back();
+  }
+  m_entityCount++;
+  return {index, m_records[index].generation};
+}
+
+World::EntityRecord &World::getRecord(Entity entity) {
+  if (!isAlive(entity)) {
+    throw std::runtime_error("invalid entity!");
+  }
+  return m_records[entity.index];
+}
+
+const World::EntityRecord &World::getRecord(Entity entity) const {
+  if (!isAlive(entity)) {
+    throw std::runtime_error("invalid entity!");
+  }
+  return m_records[entity.index];
+}
+
+uint32_t World::getOrCreateArchetype(ComponentMask mask) {
+  auto it = m_archetypeLookup.find(mask);
+  if (it != m_archetypeLookup.end())
+    return it->second;
+
+  auto archetype = std::make_unique<Archetype>();
+  archetype->mask = mask;
+  uint32_t rowSize = sizeof(Entity);
+  for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+    if (mask & (ComponentMask(1) << id)) {
+      archetype->components.push_back(id);
+      rowSize += getComponentInfo(id).size;
+    }
+  }
+
+  // As many rows as fit, minus what the column alignment pads away
+  uint32_t capacity = ECS_CHUNK_SIZE / rowSize;
+  while (true) {
+    uint32_t offset = capacity * sizeof(Entity);
+    for (ComponentId id : archetype->components) {
+      const ComponentInfo &info = getComponentInfo(id);
+      offset = alignUp(offset, info.alignment);
+      archetype->offsets[id] = offset;
+      offset += capacity * info.size;
+    }
+    if (offset <= ECS_CHUNK_SIZE)
+      break;
+    capacity--;
+  }
+  if (capacity == 0) {
+    throw std::runtime_error("archetype does not fit in a chunk!");
+  }
+  archetype->chunkCapacity = capacity;
+
+  uint32_t index = static_cast<uint32_t>(m_archetypes.size());
+  m_archetypes.push_back(std::move(archetype));
+  m_archetypeLookup.emplace(mask, index);
+  return index;
+}
+
+void World::allocateRow(EntityRecord &record, Entity entity) {
+  Archetype &archetype = *m_archetypes[record.archetype];
+  if (archetype.chunks.empty() ||
+      archetype.chunks.back().count == archetype.chunkCapacity) {
+    Chunk chunk;
+    chunk.storage = std::make_unique<ChunkStorage>();
+    archetype.chunks.push_back(std::move(chunk));
+  }
+
+  Chunk &chunk = archetype.chunks.back();
+  record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+  record.row = chunk.count++;
+  entityColumn(chunk)[record.row] = entity;
+  archetype.entityCount++;
+}
+
+void World::removeRow(uint32_t archetypeIndex, uint32_t chunkIndex,
+                      uint32_t row) {
+  Archetype &archetype = *m_archetypes[archetypeIndex];
+  Chunk &chunk = archetype.chunks[chunkIndex];
+  Chunk &lastChunk = archetype.chunks.back();
+  uint32_t lastRow = lastChunk.count - 1;
+
+  if (&chunk != &lastChunk || row != lastRow) {
+    Entity moved = entityColumn(lastChunk)[lastRow];
+    entityColumn(chunk)[row] = moved;
+    for (ComponentId id : archetype.components) {
+      uint32_t size = getComponentInfo(id).size;
+      uint32_t offset = archetype.offsets[id];
+      std::memcpy(chunk.storage->bytes + offset + row * size,
+                  lastChunk.storage->bytes + offset + lastRow * size, size);
+    }
+    EntityRecord &movedRecord = m_records[moved.index];
+    movedRecord.chunk = chunkIndex;
+    movedRecord.row = row;
+  }
+
+  lastChunk.count--;
+  if (lastChunk.count == 0)
+    archetype.chunks.pop_back();
+  archetype.entityCount--;
+}
+
+void World::moveEntity(Entity entity, uint32_t archetypeIndex) {
+  EntityRecord &record = m_records[entity.index];
+  uint32_t oldArchetype = record.archetype;
+  uint32_t oldChunk = record.chunk;
+  uint32_t oldRow = record.row;
+
+  record.archetype = archetypeIndex;
+  allocateRow(record, entity);
+
+  Archetype &from = *m_archetypes[oldArchetype];
+  Archetype &to = *m_archetypes[archetypeIndex];
+  Chunk &source = from.chunks[oldChunk];
+  Chunk &destination = to.chunks[record.chunk];
+  for (ComponentId id : to.components) {
+    if (!(from.mask & (ComponentMask(1) << id)))
+      continue;
+    uint32_t size = getComponentInfo(id).size;
+    std::memcpy(destination.storage->bytes + to.offsets[id] +
+                    record.row * size,
+                source.storage->bytes + from.offsets[id] + oldRow * size,
+                size);
+  }
+
+  removeRow(oldArchetype, oldChunk, oldRow);
+}
+
+const World::Query &World::getQuery(ComponentMask mask,
+                                    ComponentMask exclude) {
+  Query &query = m_queries[{mask, exclude}];
+  uint32_t archetypeCount = static_cast<uint32_t>(m_archetypes.size());
+  for (; query.archetypesSeen < archetypeCount; query.archetypesSeen++) {
+    ComponentMask archetypeMask = m_archetypes[query.archetypesSeen]->mask;
+    if ((archetypeMask & mask) == mask && !(archetypeMask & exclude))
+      query.archetypes.push_back(query.archetypesSeen);
+  }
+  return query;
+}
+
+} // namespace Core
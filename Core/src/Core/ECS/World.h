@@ -0,0 +1,294 @@
+#pragma once
+
+#include "Core/ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+using ComponentId = uint32_t;
+// One bit per component type in an archetype's mask
+using ComponentMask = uint64_t;
+const uint32_t MAX_COMPONENTS = 64;
+
+// Bytes of component data per chunk, every column of an archetype lives in
+// the same chunk so iteration walks memory linearly
+const uint32_t ECS_CHUNK_SIZE = 16 * 1024;
+
+// Index into the world's entity records, the generation tells reused
+// indices apart. The default value never names a live entity.
+struct Entity {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  bool operator==(const Entity &other) const = default;
+};
+
+struct ComponentInfo {
+  uint32_t size;
+  uint32_t alignment;
+};
+
+// Thread safe, called once per component type by componentId
+ComponentId registerComponent(uint32_t size, uint32_t alignment);
+const ComponentInfo &getComponentInfo(ComponentId id);
+
+// Components are plain data, moved between chunks with memcpy and never
+// destroyed
+template <typename T> ComponentId componentId() {
+  using Component = std::remove_cvref_t<T>;
+  static_assert(std::is_trivially_copyable_v<Component> &&
+                    std::is_trivially_destructible_v<Component>,
+                "components must be trivially copyable and destructible");
+  static const ComponentId id =
+      registerComponent(sizeof(Component), alignof(Component));
+  return id;
+}
+
+template <typename... Ts> ComponentMask componentMask() {
+  return ((ComponentMask(1) << componentId<Ts>()) | ... | ComponentMask(0));
+}
+
+// Archetype based entity component system. Entities with the same set of
+// components share an archetype, which stores each component in its own
+// dense column inside fixed size chunks. Adding or removing a component
+// moves the entity to another archetype.
+//
+// Queries are cached by component mask and only look at archetypes created
+// since they last ran. Structural changes (create, destroy, add, remove)
+// must not happen while iterating.
+class World {
+public:
+  World() = default;
+  World(const World &) = delete;
+  World &operator=(const World &) = delete;
+
+  template <typename... Ts> Entity create(const Ts &...components) {
+    Entity entity = allocateEntity();
+    EntityRecord &record = m_records[entity.index];
+    record.archetype = getOrCreateArchetype(componentMask<Ts...>());
+    allocateRow(record, entity);
+    (writeComponent(record, components), ...);
+    return entity;
+  }
+  void destroy(Entity entity);
+  bool isAlive(Entity entity) const;
+
+  // Replaces the component if the entity already has one
+  template <typename T> void add(Entity entity, const T &component) {
+    EntityRecord &record = getRecord(entity);
+    ComponentMask mask = m_archetypes[record.archetype]->mask;
+    ComponentMask bit = componentMask<T>();
+    if (!(mask & bit))
+      moveEntity(entity, getOrCreateArchetype(mask | bit));
+    writeComponent(record, component);
+  }
+  template <typename T> void remove(Entity entity) {
+    EntityRecord &record = getRecord(entity);
+    ComponentMask mask = m_archetypes[record.archetype]->mask;
+    ComponentMask bit = componentMask<T>();
+    if (mask & bit)
+      moveEntity(entity, getOrCreateArchetype(mask & ~bit));
+  }
+  template <typename T> bool has(Entity entity) const {
+    const EntityRecord &record = getRecord(entity);
+    return m_archetypes[record.archetype]->mask & componentMask<T>();
+  }
+  // nullptr when the entity does not have the component. Valid until the
+  // next structural change.
+  template <typename T> T *get(Entity entity) {
+    EntityRecord &record = getRecord(entity);
+    Archetype &archetype = *m_archetypes[record.archetype];
+    if (!(archetype.mask & componentMask<T>()))
+      return nullptr;
+    return column<T>(archetype, archetype.chunks[record.chunk]) + record.row;
+  }
+
+  // fn(Ts &...) for every entity with all of Ts, chunk by chunk
+  template <typename... Ts, typename Fn> void each(Fn &&fn) {
+    each<Ts...>(ComponentMask(0), fn);
+  }
+  // Like each, skipping entities with any of the components in `exclude`
+  template <typename... Ts, typename Fn>
+  void each(ComponentMask exclude, Fn &&fn) {
+    const Query &query = getQuery(componentMask<Ts...>(), exclude);
+    for (uint32_t archetypeIndex : query.archetypes) {
+      Archetype &archetype = *m_archetypes[archetypeIndex];
+      for (Chunk &chunk : archetype.chunks)
+        eachRow(chunk.count, fn, column<Ts>(archetype, chunk)...);
+    }
+  }
+
+  // Like each, with the chunks split between the calling thread and the
+  // pool's workers. Blocks until all of them are done, fn must be safe to
+  // call concurrently.
+  //
+  // The calling thread claims chunks too, so the call never waits for a
+  // worker to pick its job up: the pool is shared with jobs that queue
+  // ahead or block on the main thread.
+  template <typename... Ts, typename Fn>
+  void parallelEach(ThreadPool &threadPool, Fn &&fn) {
+    const Query &query = getQuery(componentMask<Ts...>());
+    auto work = std::make_shared<ParallelWork>();
+    for (uint32_t archetypeIndex : query.archetypes) {
+      Archetype &archetype = *m_archetypes[archetypeIndex];
+      for (Chunk &chunk : archetype.chunks)
+        work->chunks.push_back({&archetype, &chunk});
+    }
+    uint32_t chunkCount = static_cast<uint32_t>(work->chunks.size());
+    if (chunkCount == 0)
+      return;
+
+    // Jobs starting after the call returned find nothing left to claim and
+    // never touch fn
+    auto runChunks = [&fn, chunkCount](ParallelWork &work) {
+      for (uint32_t i = work.next++; i < chunkCount; i = work.next++) {
+        auto [archetype, chunk] = work.chunks[i];
+        eachRow(chunk->count, fn, column<Ts>(*archetype, *chunk)...);
+        if (++work.finished == chunkCount)
+          work.finished.notify_all();
+      }
+    };
+
+    uint32_t helpers = std::min(chunkCount - 1, threadPool.getThreadCount());
+    for (uint32_t i = 0; i < helpers; i++) {
+      threadPool.submit([work, runChunks]() { runChunks(*work); });
+    }
+    runChunks(*work);
+
+    // Chunks claimed by workers still running
+    for (uint32_t finished = work->finished; finished < chunkCount;
+         finished = work->finished)
+      work->finished.wait(finished);
+  }
+
+  // Entities with all of Ts and none of `exclude`
+  template <typename... Ts> uint32_t count(ComponentMask exclude = 0) {
+    uint32_t total = 0;
+    const Query &query = getQuery(componentMask<Ts...>(), exclude);
+    for (uint32_t archetypeIndex : query.archetypes)
+      total += m_archetypes[archetypeIndex]->entityCount;
+    return total;
+  }
+
+  uint32_t getEntityCount() const { return m_entityCount; }
+  uint32_t getArchetypeCount() const {
+    return static_cast<uint32_t>(m_archetypes.size());
+  }
+
+private:
+  struct alignas(64) ChunkStorage {
+    std::byte bytes[ECS_CHUNK_SIZE];
+  };
+
+  struct Chunk {
+    std::unique_ptr<ChunkStorage> storage;
+    uint32_t count = 0;
+  };
+
+  struct Archetype {
+    ComponentMask mask;
+    std::vector<ComponentId> components;
+    // Byte offset of each component's column in a chunk, by ComponentId.
+    // The entity column is at offset 0.
+    std::array<uint32_t, MAX_COMPONENTS> offsets{};
+    uint32_t chunkCapacity;
+    // Full except for the last one
+    std::vector<Chunk> chunks;
+    uint32_t entityCount = 0;
+  };
+
+  struct EntityRecord {
+    uint32_t generation = 1;
+    uint32_t archetype = 0;
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+  };
+
+  struct Query {
+    std::vector<uint32_t> archetypes;
+    // Archetypes already matched against the masks
+    uint32_t archetypesSeen = 0;
+  };
+
+  struct QueryKey {
+    ComponentMask mask;
+    ComponentMask exclude;
+
+    bool operator==(const QueryKey &other) const = default;
+  };
+  struct QueryKeyHash {
+    size_t operator()(const QueryKey &key) const {
+      return std::hash<ComponentMask>()(key.mask * 0x9E3779B97F4A7C15ull ^
+                                        key.exclude);
+    }
+  };
+
+  struct ParallelChunk {
+    Archetype *archetype;
+    Chunk *chunk;
+  };
+
+  // Shared with the jobs of one parallelEach, which may outlive the call
+  struct ParallelWork {
+    std::vector<ParallelChunk> chunks;
+    // Next chunk to claim
+    std::atomic<uint32_t> next = 0;
+    std::atomic<uint32_t> finished = 0;
+  };
+
+  template <typename T> static T *column(Archetype &archetype, Chunk &chunk) {
+    return reinterpret_cast<T *>(chunk.storage->bytes +
+                                 archetype.offsets[componentId<T>()]);
+  }
+  static Entity *entityColumn(Chunk &chunk) {
+    return reinterpret_cast<Entity *>(chunk.storage->bytes);
+  }
+
+  template <typename Fn, typename... Ts>
+  static void eachRow(uint32_t count, Fn &fn, Ts *...columns) {
+    for (uint32_t row = 0; row < count; row++)
+      fn(columns[row]...);
+  }
+
+  template <typename T>
+  void writeComponent(EntityRecord &record, const T &component) {
+    Archetype &archetype = *m_archetypes[record.archetype];
+    column<T>(archetype, archetype.chunks[record.chunk])[record.row] =
+        component;
+  }
+
+  Entity allocateEntity();
+  EntityRecord &getRecord(Entity entity);
+  const EntityRecord &getRecord(Entity entity) const;
+
+  uint32_t getOrCreateArchetype(ComponentMask mask);
+  // Appends a row to the record's archetype and points the record at it
+  void allocateRow(EntityRecord &record, Entity entity);
+  // Fills the hole with the archetype's last row, keeping chunks dense
+  void removeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+  // Copies the components both archetypes have, the others are left for
+  // the caller to write
+  void moveEntity(Entity entity, uint32_t archetypeIndex);
+
+  const Query &getQuery(ComponentMask mask, ComponentMask exclude = 0);
+
+private:
+  std::vector<EntityRecord> m_records;
+  std::vector<uint32_t> m_freeEntities;
+  uint32_t m_entityCount = 0;
+
+  std::vector<std::unique_ptr<Archetype>> m_archetypes;
+  std::unordered_map<ComponentMask, uint32_t> m_archetypeLookup;
+  std::unordered_map<QueryKey, Query, QueryKeyHash> m_queries;
+};
+
+} // namespace Core
@@ -1,8 +1,12 @@
 #pragma once
 
-#include <functional>
-#include <string>
-enum class EventType {
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+enum class EventType : uint8_t {
   None = 0,
   WindowClose,
   WindowResize,
@@ -12,32 +16,97 @@ enum class EventType {
   MouseButtonReleased,
   MouseMoved,
   MouseScrolled,
+  Count,
 };
 
-#define EVENT_CLASS_TYPE(type)                                                 \
-  static EventType GetStaticType() { return EventType::type; }                 \
-  virtual EventType GetEventType() const override { return GetStaticType(); }  \
-  virtual const char *GetName() const override { return #type; }
+// Largest payload an event type may have
+const size_t EVENT_PAYLOAD_SIZE = 12;
+
+// Event payloads are small trivially copyable structs naming their type:
+//   static constexpr EventType Type = EventType::...;
+template <typename T>
+concept EventPayload =
+    std::is_trivially_copyable_v<T> && sizeof(T) <= EVENT_PAYLOAD_SIZE &&
+    requires { T::Type; };
 
+// Type tag and a copy of the payload, 16 bytes, queued and dispatched by
+// value
 class Event {
 public:
   bool Handled = false;
 
-  virtual ~Event(){}
-  virtual EventType GetEventType() const = 0;
-  virtual const char *GetName() const = 0;
-  virtual std::string ToString() const { return GetName(); }
+  Event() = default;
+
+  template <EventPayload T> static Event Make(const T &payload) {
+    Event event;
+    event.m_Type = T::Type;
+    std::memcpy(event.m_Payload, &payload, sizeof(T));
+    return event;
+  }
+
+  EventType GetEventType() const { return m_Type; }
+
+  template <EventPayload T> bool Is() const { return m_Type == T::Type; }
+  // The payload of an event of type T
+  template <EventPayload T> T As() const {
+    T payload;
+    std::memcpy(&payload, m_Payload, sizeof(T));
+    return payload;
+  }
+  // Replaces the payload, for coalescing events of the same type
+  void SetPayload(const Event &other) {
+    std::memcpy(m_Payload, other.m_Payload, EVENT_PAYLOAD_SIZE);
+  }
+
+private:
+  EventType m_Type = EventType::None;
+  alignas(4) std::byte m_Payload[EVENT_PAYLOAD_SIZE]{};
 };
+static_assert(sizeof(Event) == 16, "events stay tightly packed");
 
-class EventDispatcher {
-  template <typename T> using EventFn = std::function<bool(T &)>;
+// Handlers of a layer indexed by event type. Plain function pointers with
+// a context, dispatching allocates nothing and costs one indirect call.
+class EventHandlers {
+public:
+  // `Method` is bool (Owner::*)(const T &), true marks the event handled
+  template <EventPayload T, auto Method, typename Owner>
+  void Bind(Owner *owner) {
+    m_Handlers[static_cast<size_t>(T::Type)] = {
+        [](void *context, const Event &event) {
+          return (static_cast<Owner *>(context)->*Method)(event.As<T>());
+        },
+        owner};
+  }
+  template <EventPayload T> void Unbind() {
+    m_Handlers[static_cast<size_t>(T::Type)] = {};
+  }
+
+  // Sets Handled from the handler, false when there is none
+  bool Dispatch(Event &event) const {
+    const Entry &entry = m_Handlers[static_cast<size_t>(event.GetEventType())];
+    if (!entry.Handler)
+      return false;
+    event.Handled = entry.Handler(entry.Context, event);
+    return true;
+  }
 
+private:
+  struct Entry {
+    bool (*Handler)(void *context, const Event &event) = nullptr;
+    void *Context = nullptr;
+  };
+
+  std::array<Entry, static_cast<size_t>(EventType::Count)> m_Handlers{};
+};
+
+// Calls the handler when the event has type T and is not handled yet
+class EventDispatcher {
 public:
   EventDispatcher(Event &event) : m_Event(event) {}
 
-  template <typename T> bool Dispatch(EventFn<T> func) {
-    if (m_Event.GetEventType() == T::GetStaticType() && !m_Event.Handled) {
-      m_Event.Handled = func(*(T *)&m_Event);
+  template <EventPayload T, typename Fn> bool Dispatch(Fn &&func) {
+    if (m_Event.Is<T>() && !m_Event.Handled) {
+      m_Event.Handled = func(m_Event.As<T>());
       return true;
     }
     return false;
@@ -0,0 +1,31 @@
+#include "EventQueue.h"
+
+namespace Core {
+
+EventQueue::EventQueue(uint32_t capacity) {
+  m_Events.reserve(capacity);
+  SetCoalesced(EventType::WindowResize, true);
+  SetCoalesced(EventType::MouseMoved, true);
+}
+
+void EventQueue::Push(const Event &event) {
+  EventType type = event.GetEventType();
+  if (m_Coalesced[static_cast<size_t>(type)] && m_Events.size() > m_Next &&
+      m_Events.back().GetEventType() == type) {
+    m_Events.back().SetPayload(event);
+    m_CoalescedCount++;
+    return;
+  }
+  m_Events.push_back(event);
+}
+
+void EventQueue::SetCoalesced(EventType type, bool coalesced) {
+  m_Coalesced[static_cast<size_t>(type)] = coalesced;
+}
+
+void EventQueue::Clear() {
+  m_Events.clear();
+  m_Next = 0;
+}
+
+} // namespace Core
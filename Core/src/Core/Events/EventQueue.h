@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Event.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+// Events raised during a frame, drained once by Application::Run. Pushing
+// only allocates when the queue outgrows its largest frame so far.
+//
+// For coalesced types only the latest state matters: a new event
+// overwrites the payload of the last queued one when it has the same type.
+// Anything queued in between keeps them apart, so handlers never see a
+// state from after an event they have not been given yet. Window resizes
+// and mouse moves are coalesced by default.
+class EventQueue {
+public:
+  explicit EventQueue(uint32_t capacity = 256);
+
+  template <EventPayload T> void Push(const T &payload) {
+    Push(Event::Make(payload));
+  }
+  void Push(const Event &event);
+
+  void SetCoalesced(EventType type, bool coalesced);
+
+  // fn(Event &) for every queued event in order, including ones pushed
+  // while draining. The queue is empty afterwards.
+  template <typename Fn> void Drain(Fn &&fn) {
+    while (m_Next < m_Events.size()) {
+      // A copy, handlers may push and grow the queue
+      Event event = m_Events[m_Next++];
+      fn(event);
+    }
+    Clear();
+  }
+  void Clear();
+
+  size_t GetSize() const { return m_Events.size(); }
+  // Events merged into queued ones since the queue was created
+  uint64_t GetCoalescedCount() const { return m_CoalescedCount; }
+
+private:
+  static constexpr size_t TYPE_COUNT = static_cast<size_t>(EventType::Count);
+
+  std::vector<Event> m_Events;
+  // First event Drain has not dispatched yet, older ones are not merged into
+  size_t m_Next = 0;
+  std::array<bool, TYPE_COUNT> m_Coalesced{};
+  uint64_t m_CoalescedCount = 0;
+};
+
+} // namespace Core
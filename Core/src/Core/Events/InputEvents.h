@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Event.h"
+namespace Core {
+// GLFW key codes and modifier bits
+struct KeyPressedEvent {
+  static constexpr EventType Type = EventType::KeyPressed;
+
+  int Key;
+  int Mods;
+  bool Repeat;
+};
+
+struct KeyReleasedEvent {
+  static constexpr EventType Type = EventType::KeyReleased;
+
+  int Key;
+  int Mods;
+};
+
+struct MouseButtonPressedEvent {
+  static constexpr EventType Type = EventType::MouseButtonPressed;
+
+  int Button;
+  int Mods;
+};
+
+struct MouseButtonReleasedEvent {
+  static constexpr EventType Type = EventType::MouseButtonReleased;
+
+  int Button;
+  int Mods;
+};
+
+// Window coordinates of the cursor
+struct MouseMovedEvent {
+  static constexpr EventType Type = EventType::MouseMoved;
+
+  float X;
+  float Y;
+};
+
+struct MouseScrolledEvent {
+  static constexpr EventType Type = EventType::MouseScrolled;
+
+  float XOffset;
+  float YOffset;
+};
+
+} // namespace Core
@@ -1,32 +1,17 @@
-
 #pragma once
 
 #include "Event.h"
-#include <format>
+#include <cstdint>
 namespace Core {
-class WindowClosedEvent : public Event {
-public:
-  WindowClosedEvent() {}
-  EVENT_CLASS_TYPE(WindowClose);
+struct WindowClosedEvent {
+  static constexpr EventType Type = EventType::WindowClose;
 };
 
-class WindowResizeEvent : public Event {
-public:
-  WindowResizeEvent(uint32_t width, uint32_t height)
-      : m_Width(width), m_Height(height) {}
-
-  inline uint32_t GetWidth() const { return m_Width; }
-
-  inline uint32_t GetHeight() const { return m_Height; }
-
-  std::string ToString() const override {
-    return std::format("WindowResizeEvent: {}, {}", m_Width, m_Height);
-  }
-
-  EVENT_CLASS_TYPE(WindowResize);
+struct WindowResizeEvent {
+  static constexpr EventType Type = EventType::WindowResize;
 
-private:
-  uint32_t m_Width, m_Height;
+  uint32_t Width;
+  uint32_t Height;
 };
 
 } // namespace Core
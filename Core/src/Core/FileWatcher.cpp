@@ -0,0 +1,121 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Core {
+
+FileWatcher::~FileWatcher() { shutdown(); }
+
+std::string FileWatcher::normalize(const std::string &path) {
+  std::error_code error;
+  std::filesystem::path absolute = std::filesystem::absolute(path, error);
+  return (error ? std::filesystem::path(path) : absolute)
+      .lexically_normal()
+      .string();
+}
+
+#ifdef __linux__
+
+void FileWatcher::init() {
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+void FileWatcher::shutdown() {
+  if (m_inotifyFd >= 0)
+    close(m_inotifyFd);
+  m_inotifyFd = -1;
+  m_directories.clear();
+  m_files.clear();
+}
+
+void FileWatcher::watch(const std::string &path) {
+  std::string file = normalize(path);
+  m_files[file] = path;
+  if (m_inotifyFd < 0)
+    return;
+
+  // Watch the directory, editors often save by renaming a temporary file
+  // over the original which would drop a watch on the file itself
+  std::string directory = std::filesystem::path(file).parent_path().string();
+  for (const auto &[wd, watched] : m_directories) {
+    if (watched == directory)
+      return;
+  }
+
+  int wd = inotify_add_watch(m_inotifyFd, directory.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (wd >= 0)
+    m_directories[wd] = directory;
+}
+
+std::vector<std::string> FileWatcher::poll() {
+  std::vector<std::string> changed;
+  if (m_inotifyFd < 0)
+    return changed;
+
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+    if (length <= 0)
+      break;
+
+    for (char *ptr = buffer; ptr < buffer + length;) {
+      auto *event = reinterpret_cast<inotify_event *>(ptr);
+      ptr += sizeof(inotify_event) + event->len;
+
+      auto directory = m_directories.find(event->wd);
+      if (directory == m_directories.end() || event->len == 0)
+        continue;
+
+      std::string file =
+          (std::filesystem::path(directory->second) / event->name).string();
+      auto watched = m_files.find(file);
+      if (watched != m_files.end() &&
+          std::find(changed.begin(), changed.end(), watched->second) ==
+              changed.end())
+        changed.push_back(watched->second);
+    }
+  }
+
+  return changed;
+}
+
+#else
+
+void FileWatcher::init() {}
+
+void FileWatcher::shutdown() {
+  m_files.clear();
+  m_writeTimes.clear();
+}
+
+void FileWatcher::watch(const std::string &path) {
+  std::string file = normalize(path);
+  m_files[file] = path;
+
+  std::error_code error;
+  m_writeTimes[file] = std::filesystem::last_write_time(file, error);
+}
+
+std::vector<std::string> FileWatcher::poll() {
+  std::vector<std::string> changed;
+  for (auto &[file, writeTime] : m_writeTimes) {
+    std::error_code error;
+    auto current = std::filesystem::last_write_time(file, error);
+    if (!error && current != writeTime) {
+      writeTime = current;
+      changed.push_back(m_files[file]);
+    }
+  }
+  return changed;
+}
+
+#endif
+
+} // namespace Core
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+// Reports files that were written since the last poll. Uses inotify on
+// Linux and falls back to comparing modification times elsewhere.
+class FileWatcher {
+public:
+  FileWatcher() = default;
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  void init();
+  void shutdown();
+
+  void watch(const std::string &path);
+
+  // Non-blocking, returns each changed file once using the path given to
+  // watch()
+  std::vector<std::string> poll();
+
+private:
+  static std::string normalize(const std::string &path);
+
+private:
+  // Normalized path -> path as passed to watch()
+  std::unordered_map<std::string, std::string> m_files;
+
+#ifdef __linux__
+  int m_inotifyFd = -1;
+  // Watch descriptor -> normalized directory
+  std::unordered_map<int, std::string> m_directories;
+#else
+  std::unordered_map<std::string, std::filesystem::file_time_type>
+      m_writeTimes;
+#endif
+};
+
+} // namespace Core
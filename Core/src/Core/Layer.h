@@ -6,9 +6,15 @@ class Layer {
 public:
   virtual ~Layer() = default;
 
-  virtual void OnEvent(Event &event) {}
   virtual void OnUpdate(float ts) {}
   virtual void OnRender() {}
+
+  // What Application dispatches events to this layer through
+  const EventHandlers &GetEventHandlers() const { return m_EventHandlers; }
+
+protected:
+  // Bound by the layer for the event types it handles
+  EventHandlers m_EventHandlers;
 };
 
 } // namespace Core
@@ -0,0 +1,75 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace Core {
+
+ThreadPool::~ThreadPool() { shutdown(); }
+
+void ThreadPool::init(uint32_t threadCount) {
+  if (threadCount == 0) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = std::max(hardwareThreads, 2u) - 1;
+  }
+
+  m_stopping = false;
+  m_workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++)
+    m_workers.emplace_back([this] { workerLoop(); });
+}
+
+void ThreadPool::shutdown() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_jobAvailable.notify_all();
+
+  for (std::thread &worker : m_workers) {
+    if (worker.joinable())
+      worker.join();
+  }
+  m_workers.clear();
+  m_jobs.clear();
+}
+
+void ThreadPool::submit(Job job) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+  }
+  m_jobAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+  std::unique_lock lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock(m_mutex);
+      m_jobAvailable.wait(lock,
+                          [this] { return m_stopping || !m_jobs.empty(); });
+      if (m_stopping)
+        return;
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      m_activeJobs++;
+    }
+
+    job();
+
+    {
+      std::lock_guard lock(m_mutex);
+      m_activeJobs--;
+      if (m_jobs.empty() && m_activeJobs == 0)
+        m_idle.notify_all();
+    }
+  }
+}
+
+} // namespace Core
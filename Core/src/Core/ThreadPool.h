@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+// Fixed set of worker threads pulling jobs from a shared FIFO queue.
+class ThreadPool {
+public:
+  using Job = std::function<void()>;
+
+  ThreadPool() = default;
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // 0 picks hardware_concurrency - 1, leaving a core for the main thread
+  void init(uint32_t threadCount = 0);
+  void shutdown();
+
+  void submit(Job job);
+
+  // Blocks until the queue is empty and no job is running
+  void waitIdle();
+
+  uint32_t getThreadCount() const {
+    return static_cast<uint32_t>(m_workers.size());
+  }
+
+private:
+  void workerLoop();
+
+private:
+  std::vector<std::thread> m_workers;
+  std::deque<Job> m_jobs;
+
+  std::mutex m_mutex;
+  std::condition_variable m_jobAvailable;
+  std::condition_variable m_idle;
+
+  uint32_t m_activeJobs = 0;
+  bool m_stopping = false;
+};
+
+} // namespace Core
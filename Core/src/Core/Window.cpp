@@ -1,5 +1,6 @@
 #include "Window.h"
 #include "Core/Application.h"
+#include "Core/Events/InputEvents.h"
 #include "Core/Events/WindowEvents.h"
 
 #include <GLFW/glfw3.h>
@@ -26,16 +27,45 @@ void Window::create() {
   glfwSetWindowCloseCallback(m_Handle, [](GLFWwindow *handle) {
     Window &window =
         *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
-    WindowClosedEvent event;
-    window.raiseEvent(event);
+    window.raiseEvent(WindowClosedEvent{});
   });
   glfwSetWindowSizeCallback(
       m_Handle, [](GLFWwindow *handle, int width, int height) {
         Window &window =
             *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
-        WindowResizeEvent event((uint32_t)width, (uint32_t)height);
-        window.raiseEvent(event);
+        window.raiseEvent(
+            WindowResizeEvent{(uint32_t)width, (uint32_t)height});
       });
+  glfwSetKeyCallback(m_Handle, [](GLFWwindow *handle, int key, int,
+                                  int action, int mods) {
+    Window &window =
+        *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
+    if (action == GLFW_RELEASE)
+      window.raiseEvent(KeyReleasedEvent{key, mods});
+    else
+      window.raiseEvent(KeyPressedEvent{key, mods, action == GLFW_REPEAT});
+  });
+  glfwSetMouseButtonCallback(
+      m_Handle, [](GLFWwindow *handle, int button, int action, int mods) {
+        Window &window =
+            *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
+        if (action == GLFW_RELEASE)
+          window.raiseEvent(MouseButtonReleasedEvent{button, mods});
+        else
+          window.raiseEvent(MouseButtonPressedEvent{button, mods});
+      });
+  glfwSetCursorPosCallback(m_Handle, [](GLFWwindow *handle, double x,
+                                        double y) {
+    Window &window =
+        *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
+    window.raiseEvent(MouseMovedEvent{(float)x, (float)y});
+  });
+  glfwSetScrollCallback(m_Handle, [](GLFWwindow *handle, double xOffset,
+                                     double yOffset) {
+    Window &window =
+        *((Application *)glfwGetWindowUserPointer(handle))->getWindow();
+    window.raiseEvent(MouseScrolledEvent{(float)xOffset, (float)yOffset});
+  });
 }
 
 void Window::destroy() {
@@ -53,9 +83,4 @@ glm::vec2 Window::getFramebufferSize() {
   return {width, height};
 }
 
-void Window::raiseEvent(Event &event) {
-  if (m_specification.EventCallback)
-    m_specification.EventCallback(event);
-}
-
 } // namespace Core
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Core/Events/Event.h"
+#include "Core/Events/EventQueue.h"
 #include "vulkan/vulkan_core.h"
 #include <GLFW/glfw3.h>
 
@@ -16,9 +16,6 @@ struct WindowSpec {
   uint32_t Height = 720;
   bool IsResizeable = true;
   bool VSync = true;
-
-  using EventCallbackFn = std::function<void(Event &)>;
-  EventCallbackFn EventCallback;
 };
 
 class Window {
@@ -35,10 +32,16 @@ public:
 
   GLFWwindow *getHandle() const { return m_Handle; }
 
-  void raiseEvent(Event &event);
+  // Queued, dispatched when Application drains the queue
+  template <EventPayload T> void raiseEvent(const T &event) {
+    m_Events.Push(event);
+  }
+  EventQueue &getEventQueue() { return m_Events; }
 
 private:
   WindowSpec m_specification;
+  // Filled by the GLFW callbacks during update()
+  EventQueue m_Events;
 
   GLFWwindow *m_Handle = nullptr;
 };
@@ -73,3 +73,14 @@ void BufferManager::copyBufferToImage(VkBuffer buffer, VkImage image,
   vkCmdCopyBufferToImage(submit.get(), buffer, image,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
+
+void BufferManager::copyBufferToImage(
+    VkBuffer buffer, VkImage image,
+    const std::vector<VkBufferImageCopy> &regions) {
+  OneTimeSubmit submit(mp_cmdManager);
+
+  vkCmdCopyBufferToImage(submit.get(), buffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         static_cast<uint32_t>(regions.size()),
+                         regions.data());
+}
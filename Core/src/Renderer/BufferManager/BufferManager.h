@@ -3,6 +3,8 @@
 #include "Commands/CommandManager.h"
 #include "Swapchain/Swapchain.h"
 #include "vulkan/vulkan_core.h"
+#include <vector>
+
 class BufferManager {
 public:
   void init(VulkanContext *p_context, CommandManager *p_cmdManager);
@@ -17,6 +19,9 @@ public:
   void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
                          uint32_t height);
 
+  void copyBufferToImage(VkBuffer buffer, VkImage image,
+                         const std::vector<VkBufferImageCopy> &regions);
+
 private:
   VulkanContext *mp_context;
   CommandManager *mp_cmdManager;
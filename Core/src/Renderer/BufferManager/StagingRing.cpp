@@ -0,0 +1,98 @@
+#include "StagingRing.h"
+
+void StagingRing::init(VulkanContext *p_context,
+                       BufferManager *p_bufferManager, VkDeviceSize capacity) {
+  mp_context = p_context;
+  m_capacity = capacity;
+  m_head = 0;
+  m_aborted = false;
+
+  p_bufferManager->createBuffer(m_capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                m_buffer, m_memory);
+  vkMapMemory(mp_context->getDevice(), m_memory, 0, m_capacity, 0, &m_mapped);
+}
+
+void StagingRing::shutdown() {
+  abort();
+
+  vkUnmapMemory(mp_context->getDevice(), m_memory);
+  vkDestroyBuffer(mp_context->getDevice(), m_buffer, nullptr);
+  vkFreeMemory(mp_context->getDevice(), m_memory, nullptr);
+  m_buffer = VK_NULL_HANDLE;
+  m_memory = VK_NULL_HANDLE;
+  m_mapped = nullptr;
+  m_blocks.clear();
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment,
+                           StagingAllocation &allocation) {
+  if (size > m_capacity)
+    return false;
+
+  std::unique_lock lock(m_mutex);
+  VkDeviceSize offset = 0;
+  m_spaceFreed.wait(lock, [&] {
+    return m_aborted || tryAllocate(size, alignment, offset);
+  });
+  if (m_aborted)
+    return false;
+
+  allocation.offset = offset;
+  allocation.size = size;
+  allocation.mapped = static_cast<char *>(m_mapped) + offset;
+  return true;
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment,
+                              VkDeviceSize &offset) {
+  auto alignUp = [alignment](VkDeviceSize value) {
+    return (value + alignment - 1) / alignment * alignment;
+  };
+
+  if (m_blocks.empty())
+    m_head = 0;
+
+  VkDeviceSize tail = m_blocks.empty() ? m_capacity : m_blocks.front().begin;
+  bool wrapped = !m_blocks.empty() && m_head <= tail;
+
+  VkDeviceSize begin = alignUp(m_head);
+  if (wrapped) {
+    if (begin + size > tail)
+      return false;
+  } else if (begin + size > m_capacity) {
+    // Not enough room before the end, restart at the front of the buffer
+    if (!m_blocks.empty() && size > tail)
+      return false;
+    begin = 0;
+  }
+
+  m_blocks.push_back({begin, begin + size, false});
+  m_head = begin + size;
+  offset = begin;
+  return true;
+}
+
+void StagingRing::release(const StagingAllocation &allocation) {
+  {
+    std::lock_guard lock(m_mutex);
+    for (Block &block : m_blocks) {
+      if (block.begin == allocation.offset) {
+        block.released = true;
+        break;
+      }
+    }
+    while (!m_blocks.empty() && m_blocks.front().released)
+      m_blocks.pop_front();
+  }
+  m_spaceFreed.notify_all();
+}
+
+void StagingRing::abort() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_aborted = true;
+  }
+  m_spaceFreed.notify_all();
+}
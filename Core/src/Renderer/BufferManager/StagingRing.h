@@ -0,0 +1,63 @@
+#pragma once
+
+#include "BufferManager/BufferManager.h"
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+struct StagingAllocation {
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+};
+
+// Persistently mapped upload buffer shared by the loader threads. Space is
+// handed out in FIFO order and reclaimed once the GPU copy that reads it has
+// completed, allocations wait for room instead of creating new buffers.
+class StagingRing {
+public:
+  void init(VulkanContext *p_context, BufferManager *p_bufferManager,
+            VkDeviceSize capacity);
+  void shutdown();
+
+  // Thread safe, blocks until `size` bytes are free. Returns false when the
+  // request is larger than the ring or the ring is shutting down.
+  bool allocate(VkDeviceSize size, VkDeviceSize alignment,
+                StagingAllocation &allocation);
+  void release(const StagingAllocation &allocation);
+
+  // Wakes every thread waiting in allocate()
+  void abort();
+
+  VkBuffer getBuffer() const { return m_buffer; }
+  VkDeviceSize getCapacity() const { return m_capacity; }
+
+private:
+  bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment,
+                   VkDeviceSize &offset);
+
+private:
+  struct Block {
+    VkDeviceSize begin;
+    VkDeviceSize end;
+    bool released;
+  };
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  void *m_mapped = nullptr;
+  VkDeviceSize m_capacity = 0;
+
+  // Live blocks, oldest first. Free space is [m_head, front.begin) wrapping
+  // around the end of the buffer.
+  std::deque<Block> m_blocks;
+  VkDeviceSize m_head = 0;
+
+  std::mutex m_mutex;
+  std::condition_variable m_spaceFreed;
+  bool m_aborted = false;
+
+  VulkanContext *mp_context;
+};
@@ -0,0 +1,56 @@
+#include "UniformRingBuffer.h"
+#include <algorithm>
+#include <stdexcept>
+
+void UniformRingBuffer::init(VulkanContext *p_context,
+                             BufferManager *p_bufferManager,
+                             uint32_t framesInFlight,
+                             VkDeviceSize bytesPerFrame) {
+  mp_context = p_context;
+  mp_bufferManager = p_bufferManager;
+
+  const VkPhysicalDeviceLimits &limits = mp_context->getProperties().limits;
+  m_alignment = std::max(limits.minUniformBufferOffsetAlignment,
+                         limits.minStorageBufferOffsetAlignment);
+  m_alignment = std::max<VkDeviceSize>(m_alignment, 1);
+
+  // Keeps every frame region starting on an aligned offset
+  m_bytesPerFrame =
+      (bytesPerFrame + m_alignment - 1) / m_alignment * m_alignment;
+
+  mp_bufferManager->createBuffer(m_bytesPerFrame * framesInFlight,
+                                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                 m_buffer, m_memory);
+
+  void *mapped;
+  if (vkMapMemory(mp_context->getDevice(), m_memory, 0, VK_WHOLE_SIZE, 0,
+                  &mapped) != VK_SUCCESS) {
+    throw std::runtime_error("failed to map uniform ring buffer!");
+  }
+  mp_mapped = static_cast<uint8_t *>(mapped);
+}
+
+void UniformRingBuffer::shutdown() {
+  vkUnmapMemory(mp_context->getDevice(), m_memory);
+  vkDestroyBuffer(mp_context->getDevice(), m_buffer, nullptr);
+  vkFreeMemory(mp_context->getDevice(), m_memory, nullptr);
+  mp_mapped = nullptr;
+}
+
+void UniformRingBuffer::beginFrame(uint32_t frameIndex) {
+  m_frameBegin = m_bytesPerFrame * frameIndex;
+  m_head = m_frameBegin;
+}
+
+UniformAllocation UniformRingBuffer::allocate(VkDeviceSize size) {
+  VkDeviceSize offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+  if (offset + size > m_frameBegin + m_bytesPerFrame) {
+    throw std::runtime_error("uniform ring buffer frame region exhausted!");
+  }
+
+  m_head = offset + size;
+  return {static_cast<uint32_t>(offset), mp_mapped + offset};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "BufferManager/BufferManager.h"
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <cstring>
+
+struct UniformAllocation {
+  // Pass as the dynamic offset when binding
+  uint32_t offset = 0;
+  void *mapped = nullptr;
+};
+
+// One persistently mapped buffer split into a region per frame in flight.
+// Per-frame constants are bump allocated from the current region and bound
+// through VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC (or the storage
+// equivalent) with the returned offset, so no buffer is created per use.
+class UniformRingBuffer {
+public:
+  void init(VulkanContext *p_context, BufferManager *p_bufferManager,
+            uint32_t framesInFlight, VkDeviceSize bytesPerFrame);
+  void shutdown();
+
+  // After the frame's fence wait, rewinds that frame's region
+  void beginFrame(uint32_t frameIndex);
+
+  // Aligned for both uniform and storage buffer offsets. Throws when the
+  // frame's region is exhausted.
+  UniformAllocation allocate(VkDeviceSize size);
+
+  template <typename T> uint32_t push(const T &data) {
+    UniformAllocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.mapped, &data, sizeof(T));
+    return allocation.offset;
+  }
+
+  VkBuffer getBuffer() const { return m_buffer; }
+  // Bytes used in the current frame region, padding included
+  VkDeviceSize getFrameUsage() const { return m_head - m_frameBegin; }
+
+private:
+  VulkanContext *mp_context;
+  BufferManager *mp_bufferManager;
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  uint8_t *mp_mapped = nullptr;
+
+  VkDeviceSize m_bytesPerFrame = 0;
+  VkDeviceSize m_alignment = 1;
+  VkDeviceSize m_frameBegin = 0;
+  VkDeviceSize m_head = 0;
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Per-draw data sent with vkCmdPushConstants, matches the push_constant
+// block in shader.vert. Kept within the 128 bytes every device supports.
+struct DrawConstants {
+  alignas(16) glm::mat4 model;
+};
+static_assert(sizeof(DrawConstants) <= 128,
+              "DrawConstants must fit the guaranteed maxPushConstantsSize");
@@ -6,15 +6,16 @@
 void createImage(VulkanContext *p_context, uint32_t width, uint32_t height,
                  VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
                  VkMemoryPropertyFlags properties, VkImage &image,
-                 VkDeviceMemory &imageMemory) {
+                 VkDeviceMemory &imageMemory, uint32_t mipLevels,
+                 uint32_t arrayLayers) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
   imageInfo.extent.width = width;
   imageInfo.extent.height = height;
   imageInfo.extent.depth = 1;
-  imageInfo.mipLevels = 1;
-  imageInfo.arrayLayers = 1;
+  imageInfo.mipLevels = mipLevels;
+  imageInfo.arrayLayers = arrayLayers;
   imageInfo.format = format;
   imageInfo.tiling = tiling;
   imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -46,17 +47,20 @@ void createImage(VulkanContext *p_context, uint32_t width, uint32_t height,
 }
 
 VkImageView createImageView(VulkanContext *p_context, VkImage image,
-                            VkFormat format, VkImageAspectFlags aspectFlags) {
+                            VkFormat format, VkImageAspectFlags aspectFlags,
+                            uint32_t mipLevels, uint32_t baseArrayLayer,
+                            uint32_t layerCount) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
-  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.viewType =
+      layerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
   viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = aspectFlags;
   viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
-  viewInfo.subresourceRange.baseArrayLayer = 0;
-  viewInfo.subresourceRange.layerCount = 1;
+  viewInfo.subresourceRange.levelCount = mipLevels;
+  viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+  viewInfo.subresourceRange.layerCount = layerCount;
 
   VkImageView imageView;
   if (vkCreateImageView(p_context->getDevice(), &viewInfo, nullptr,
@@ -6,7 +6,11 @@
 void createImage(VulkanContext *p_context, uint32_t width, uint32_t height,
                  VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
                  VkMemoryPropertyFlags properties, VkImage &image,
-                 VkDeviceMemory &imageMemory);
+                 VkDeviceMemory &imageMemory, uint32_t mipLevels = 1,
+                 uint32_t arrayLayers = 1);
 
+// A 2D array view when layerCount is above 1
 VkImageView createImageView(VulkanContext *p_context, VkImage image,
-                            VkFormat format, VkImageAspectFlags aspectFlags);
+                            VkFormat format, VkImageAspectFlags aspectFlags,
+                            uint32_t mipLevels = 1, uint32_t baseArrayLayer = 0,
+                            uint32_t layerCount = 1);
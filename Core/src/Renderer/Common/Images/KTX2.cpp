@@ -0,0 +1,235 @@
+#include "KTX2.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58,
+                                            0x20, 0x32, 0x30, 0xBB,
+                                            0x0D, 0x0A, 0x1A, 0x0A};
+
+struct KTX2FileHeader {
+  uint8_t identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+static_assert(sizeof(KTX2FileHeader) == 80, "KTX2 header must be packed");
+
+struct KTX2BlockInfo {
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes;
+};
+
+// VkFormat values, spelled out to stay free of Vulkan headers. Zero bytes
+// for formats whose level sizes cannot be checked.
+static KTX2BlockInfo getBlockInfo(uint32_t vkFormat) {
+  switch (vkFormat) {
+  case 37: // R8G8B8A8_UNORM .. R8G8B8A8_SRGB
+  case 38:
+  case 39:
+  case 40:
+  case 41:
+  case 42:
+  case 43:
+  case 44: // B8G8R8A8_UNORM .. B8G8R8A8_SRGB
+  case 45:
+  case 46:
+  case 47:
+  case 48:
+  case 49:
+  case 50:
+    return {1, 1, 4};
+  case 97: // R16G16B16A16_SFLOAT
+    return {1, 1, 8};
+  case 109: // R32G32B32A32_SFLOAT
+    return {1, 1, 16};
+  case 131: // BC1 in all its variants
+  case 132:
+  case 133:
+  case 134:
+  case 139: // BC4
+  case 140:
+    return {4, 4, 8};
+  case 135: // BC2, BC3, BC5, BC6H and BC7 in all their variants
+  case 136:
+  case 137:
+  case 138:
+  case 141:
+  case 142:
+  case 143:
+  case 144:
+  case 145:
+  case 146:
+    return {4, 4, 16};
+  default:
+    return {1, 1, 0};
+  }
+}
+
+bool isKTX2Path(const std::string &path) {
+  const std::string extension = ".ktx2";
+  return path.size() >= extension.size() &&
+         path.compare(path.size() - extension.size(), extension.size(),
+                      extension) == 0;
+}
+
+void KTX2Reader::open(const std::string &path) {
+  m_path = path;
+  m_file = std::ifstream(path, std::ios::binary | std::ios::ate);
+  if (!m_file.is_open()) {
+    throw std::runtime_error("failed to open file! " + path);
+  }
+  uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+  m_file.seekg(0);
+
+  KTX2FileHeader header{};
+  m_file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!m_file || std::memcmp(header.identifier, KTX2_IDENTIFIER,
+                             sizeof(KTX2_IDENTIFIER)) != 0) {
+    throw std::runtime_error("not a KTX2 file! " + path);
+  }
+
+  if (header.vkFormat == 0 || header.supercompressionScheme != 0) {
+    throw std::runtime_error("unsupported KTX2 encoding (Basis or "
+                             "supercompressed)! " +
+                             path);
+  }
+  if (header.pixelDepth > 1 || header.layerCount > 1 ||
+      header.faceCount != 1) {
+    throw std::runtime_error("only single 2D KTX2 images are supported! " +
+                             path);
+  }
+  KTX2BlockInfo block = getBlockInfo(header.vkFormat);
+  if (block.bytes == 0) {
+    throw std::runtime_error("unsupported KTX2 format! " + path);
+  }
+  // A full chain has floor(log2(max(width, height))) + 1 levels, anything
+  // longer is a corrupt header and would shift the extent past 32 bits
+  uint32_t maxLevels =
+      std::bit_width(std::max(header.pixelWidth, header.pixelHeight));
+  if (header.pixelWidth == 0 || header.levelCount > maxLevels) {
+    throw std::runtime_error("invalid KTX2 extent or level count! " + path);
+  }
+
+  m_texture = {};
+  m_texture.vkFormat = header.vkFormat;
+  m_texture.typeSize = header.typeSize;
+  m_texture.width = header.pixelWidth;
+  m_texture.height = header.pixelHeight;
+  m_texture.levelCount = std::max(header.levelCount, 1u);
+
+  m_texture.levels.resize(m_texture.levelCount);
+  m_file.read(reinterpret_cast<char *>(m_texture.levels.data()),
+              m_texture.levels.size() * sizeof(KTX2Level));
+  if (!m_file) {
+    throw std::runtime_error("truncated KTX2 level index! " + path);
+  }
+
+  // Readers copy byteLength bytes into space sized from the format, both
+  // have to agree and the data has to lie inside the file
+  for (uint32_t level = 0; level < m_texture.levelCount; level++) {
+    const KTX2Level &info = m_texture.levels[level];
+    uint64_t width = std::max(m_texture.width >> level, 1u);
+    uint64_t height = std::max(m_texture.height >> level, 1u);
+    uint64_t expected = (width + block.width - 1) / block.width *
+                        ((height + block.height - 1) / block.height) *
+                        block.bytes;
+    if (info.byteLength != expected) {
+      throw std::runtime_error("KTX2 level size does not match its format! " +
+                               path);
+    }
+    if (info.byteOffset > fileSize ||
+        info.byteLength > fileSize - info.byteOffset) {
+      throw std::runtime_error("truncated KTX2 level data! " + path);
+    }
+  }
+}
+
+void KTX2Reader::readLevel(uint32_t level, void *dst) {
+  if (level >= m_texture.levels.size()) {
+    throw std::out_of_range("KTX2 level out of range");
+  }
+
+  const KTX2Level &info = m_texture.levels[level];
+  m_file.seekg(static_cast<std::streamoff>(info.byteOffset));
+  m_file.read(static_cast<char *>(dst),
+              static_cast<std::streamsize>(info.byteLength));
+  if (!m_file) {
+    throw std::runtime_error("truncated KTX2 level data! " + m_path);
+  }
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void writeKTX2(const std::string &path, const KTX2Texture &texture,
+               const std::vector<uint32_t> &dataFormatDescriptor,
+               const std::vector<std::vector<uint8_t>> &levelData,
+               uint32_t levelAlignment) {
+  KTX2FileHeader header{};
+  std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+  header.vkFormat = texture.vkFormat;
+  header.typeSize = texture.typeSize;
+  header.pixelWidth = texture.width;
+  header.pixelHeight = texture.height;
+  header.faceCount = 1;
+  header.levelCount = static_cast<uint32_t>(levelData.size());
+
+  uint64_t offset = sizeof(header) + levelData.size() * sizeof(KTX2Level);
+  header.dfdByteOffset = static_cast<uint32_t>(offset);
+  header.dfdByteLength =
+      static_cast<uint32_t>(dataFormatDescriptor.size() * sizeof(uint32_t));
+  offset += header.dfdByteLength;
+
+  // Mip levels are stored smallest first
+  std::vector<KTX2Level> levels(levelData.size());
+  for (size_t i = levelData.size(); i-- > 0;) {
+    offset = alignUp(offset, levelAlignment);
+    levels[i].byteOffset = offset;
+    levels[i].byteLength = levelData[i].size();
+    levels[i].uncompressedByteLength = levelData[i].size();
+    offset += levelData[i].size();
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file for writing! " + path);
+  }
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(levels.data()),
+             levels.size() * sizeof(KTX2Level));
+  file.write(reinterpret_cast<const char *>(dataFormatDescriptor.data()),
+             header.dfdByteLength);
+
+  uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+  const char padding[16] = {};
+  for (size_t i = levelData.size(); i-- > 0;) {
+    file.write(padding, static_cast<std::streamsize>(levels[i].byteOffset -
+                                                     written));
+    file.write(reinterpret_cast<const char *>(levelData[i].data()),
+               static_cast<std::streamsize>(levelData[i].size()));
+    written = levels[i].byteOffset + levels[i].byteLength;
+  }
+
+  if (!file) {
+    throw std::runtime_error("failed to write KTX2 file! " + path);
+  }
+}
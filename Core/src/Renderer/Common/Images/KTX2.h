@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal KTX2 container support: single 2D image, no supercompression.
+// Kept free of Vulkan headers so offline tools can share it.
+
+struct KTX2Level {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+struct KTX2Texture {
+  uint32_t vkFormat = 0;
+  uint32_t typeSize = 1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t levelCount = 0;
+
+  // Level 0 is the full resolution image
+  std::vector<KTX2Level> levels;
+};
+
+bool isKTX2Path(const std::string &path);
+
+// Keeps the file open from the header to the last level read. open() reads
+// the header and level index only and checks every level's size against
+// its format, level data stays on disk until readLevel().
+class KTX2Reader {
+public:
+  void open(const std::string &path);
+
+  const KTX2Texture &getTexture() const { return m_texture; }
+  // `dst` holds the level's byteLength
+  void readLevel(uint32_t level, void *dst);
+
+private:
+  std::string m_path;
+  std::ifstream m_file;
+  KTX2Texture m_texture;
+};
+
+void writeKTX2(const std::string &path, const KTX2Texture &texture,
+               const std::vector<uint32_t> &dataFormatDescriptor,
+               const std::vector<std::vector<uint8_t>> &levelData,
+               uint32_t levelAlignment);
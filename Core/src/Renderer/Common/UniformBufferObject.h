@@ -5,4 +5,22 @@ struct UniformBufferObject {
   alignas(16) glm::mat4 model;
   alignas(16) glm::mat4 view;
   alignas(16) glm::mat4 proj;
+  // xyz camera position, world space
+  alignas(16) glm::vec4 viewPos;
+  // Clustered lighting, see ClusteredLighting::fillUniforms
+  // x, y, z cluster counts, w light count
+  alignas(16) glm::uvec4 clusterGrid;
+  // Screen width and height, depth slice scale and bias
+  alignas(16) glm::vec4 clusterParams;
+  // Cascaded shadows, see CascadedShadowMaps::fillUniforms. One entry per
+  // cascade, SHADOW_CASCADE_COUNT.
+  alignas(16) glm::mat4 cascadeViewProj[4];
+  // View space distance each cascade ends at
+  alignas(16) glm::vec4 cascadeSplits;
+  // World space size of a shadow map texel
+  alignas(16) glm::vec4 cascadeTexelSizes;
+  // xyz direction the sun light travels, w 1 when there is one
+  alignas(16) glm::vec4 sunDirection;
+  // rgb color times intensity
+  alignas(16) glm::vec4 sunColor;
 };
@@ -51,6 +51,26 @@ struct Vertex {
 
     return attributeDescriptions;
   }
+
+  // Separate stream of positions only, for depth only passes
+  static VkVertexInputBindingDescription getPositionBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(glm::vec3);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+  }
+
+  static VkVertexInputAttributeDescription getPositionAttributeDescription() {
+    VkVertexInputAttributeDescription attributeDescription{};
+    attributeDescription.binding = 0;
+    attributeDescription.location = 0;
+    attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription.offset = 0;
+
+    return attributeDescription;
+  }
 };
 
 namespace std {
@@ -131,7 +131,8 @@ void VulkanContext::initVulkan(bool validationLayersEnabled,
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // synchronization2 for the render graph barriers
+  appInfo.apiVersion = VK_API_VERSION_1_3;
 
   VkInstanceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -188,6 +189,8 @@ void VulkanContext::pickPhysicalDevice() {
   if (m_physicalDevice == VK_NULL_HANDLE) {
     throw std::runtime_error("failed to find a suitable GPU!");
   }
+
+  vkGetPhysicalDeviceProperties(m_physicalDevice, &m_properties);
 }
 
 bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
@@ -206,8 +209,24 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(device, &properties);
+  bool vulkan13 = properties.apiVersion >= VK_API_VERSION_1_3;
+
+  VkPhysicalDeviceVulkan13Features features13{};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  features12.pNext = &features13;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &features12;
+  if (vulkan13)
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && vulkan13 &&
+         features13.synchronization2 && features12.timelineSemaphore;
 }
 
 void VulkanContext::createLogicalDevice() {
@@ -227,8 +246,19 @@ void VulkanContext::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures{};
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
+  VkPhysicalDeviceFeatures &deviceFeatures = m_enabledFeatures;
+  deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // Needed for offline-compressed (KTX2) textures, optional on mobile GPUs
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  // Wireframe pipeline variants
+  deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+  // Fragment invocation counts, see PipelineStatistics
+  deviceFeatures.pipelineStatisticsQuery =
+      supportedFeatures.pipelineStatisticsQuery;
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -239,9 +269,62 @@ void VulkanContext::createLogicalDevice() {
 
   createInfo.pEnabledFeatures = &deviceFeatures;
 
-  createInfo.enabledExtensionCount =
-      static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  bool presentWaitAvailable =
+      hasDeviceExtensions(m_physicalDevice, presentWaitExtensions);
+
+  VkPhysicalDeviceVulkan13Features supported13{};
+  supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId{};
+  supportedPresentId.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait{};
+  supportedPresentWait.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  if (presentWaitAvailable) {
+    supported13.pNext = &supportedPresentId;
+    supportedPresentId.pNext = &supportedPresentWait;
+  }
+  VkPhysicalDeviceFeatures2 supported2{};
+  supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supported2.pNext = &supported13;
+  vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supported2);
+
+  VkPhysicalDeviceVulkan13Features &features13 = m_enabledFeatures13;
+  features13 = {};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  features13.synchronization2 = VK_TRUE;
+  // Render graph skips render pass and framebuffer objects when available
+  features13.dynamicRendering = supported13.dynamicRendering;
+
+  VkPhysicalDeviceVulkan12Features &features12 = m_enabledFeatures12;
+  features12 = {};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  // Frame pacing
+  features12.timelineSemaphore = VK_TRUE;
+  features12.pNext = &features13;
+  createInfo.pNext = &features12;
+
+  // Input to display latency and waiting on presents, see PresentPacer
+  std::vector<const char *> extensions = deviceExtensions;
+  m_presentWait = presentWaitAvailable && supportedPresentId.presentId &&
+                  supportedPresentWait.presentWait;
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+  presentIdFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  presentIdFeatures.presentId = VK_TRUE;
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+  presentWaitFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  presentWaitFeatures.presentWait = VK_TRUE;
+  if (m_presentWait) {
+    extensions.insert(extensions.end(), presentWaitExtensions.begin(),
+                      presentWaitExtensions.end());
+    features13.pNext = &presentIdFeatures;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+  }
+
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   if (m_validationLayersEnabled) {
     createInfo.enabledLayerCount =
@@ -251,8 +334,13 @@ void VulkanContext::createLogicalDevice() {
     createInfo.enabledLayerCount = 0;
   }
 
-  if (vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) !=
-      VK_SUCCESS) {
+  VkResult result =
+      vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device);
+  // The enabled features are kept for queries, the chain through them ends in
+  // the present features on this stack frame
+  m_enabledFeatures12.pNext = nullptr;
+  m_enabledFeatures13.pNext = nullptr;
+  if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to create logical device!");
   }
 
@@ -295,6 +383,11 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
 }
 
 bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device) {
+  return hasDeviceExtensions(device, deviceExtensions);
+}
+
+bool VulkanContext::hasDeviceExtensions(
+    VkPhysicalDevice device, const std::vector<const char *> &extensions) {
   uint32_t extensionCount;
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
                                        nullptr);
@@ -303,8 +396,8 @@ bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
                                        availableExtensions.data());
 
-  std::set<std::string> requiredExtensions(deviceExtensions.begin(),
-                                           deviceExtensions.end());
+  std::set<std::string> requiredExtensions(extensions.begin(),
+                                           extensions.end());
 
   for (const auto &extension : availableExtensions) {
     requiredExtensions.erase(extension.extensionName);
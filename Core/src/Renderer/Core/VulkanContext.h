@@ -8,6 +8,10 @@
 const std::vector<const char *> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
+// Enabled when the device has them, see isPresentWaitEnabled()
+const std::vector<const char *> presentWaitExtensions = {
+    VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+
 const std::vector<const char *> validationLayers = {
     "VK_LAYER_KHRONOS_validation"};
 
@@ -47,6 +51,22 @@ public:
 
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const {
+    return m_enabledFeatures;
+  }
+  const VkPhysicalDeviceVulkan12Features &getEnabledVulkan12Features() const {
+    return m_enabledFeatures12;
+  }
+  const VkPhysicalDeviceVulkan13Features &getEnabledVulkan13Features() const {
+    return m_enabledFeatures13;
+  }
+  const VkPhysicalDeviceProperties &getProperties() const {
+    return m_properties;
+  }
+  // VK_KHR_present_id and VK_KHR_present_wait, presents can be tagged with
+  // an id and waited on until they reach the display
+  bool isPresentWaitEnabled() const { return m_presentWait; }
+
   const VkQueue &getGraphicsQueue() {
     assert(m_graphicsQueue != nullptr);
     return m_graphicsQueue;
@@ -85,6 +105,8 @@ private:
   void createLogicalDevice();
 
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool hasDeviceExtensions(VkPhysicalDevice device,
+                           const std::vector<const char *> &extensions);
 
 private:
   VkInstance m_instance;
@@ -96,8 +118,13 @@ private:
   VkSurfaceKHR m_surface;
 
   VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties m_properties{};
 
   VkDevice m_device;
+  VkPhysicalDeviceFeatures m_enabledFeatures{};
+  VkPhysicalDeviceVulkan12Features m_enabledFeatures12{};
+  VkPhysicalDeviceVulkan13Features m_enabledFeatures13{};
+  bool m_presentWait = false;
 
   VkQueue m_graphicsQueue;
 
@@ -0,0 +1,115 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Pools stop growing here, larger chains just get more of them
+const uint32_t MAX_SETS_PER_POOL = 4096;
+
+void DescriptorAllocator::init(VulkanContext *p_context, uint32_t initialSets,
+                               const std::vector<PoolSizeRatio> &ratios,
+                               VkDescriptorPoolCreateFlags flags) {
+  mp_context = p_context;
+  m_ratios = ratios;
+  m_flags = flags;
+  m_setsPerPool = initialSets;
+
+  m_readyPools.push_back(createPool(m_setsPerPool));
+}
+
+void DescriptorAllocator::shutdown() {
+  for (VkDescriptorPool pool : m_fullPools)
+    vkDestroyDescriptorPool(mp_context->getDevice(), pool, nullptr);
+  for (VkDescriptorPool pool : m_readyPools)
+    vkDestroyDescriptorPool(mp_context->getDevice(), pool, nullptr);
+  m_fullPools.clear();
+  m_readyPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout,
+                                              VkDescriptorPool *p_pool) {
+  VkDescriptorPool pool = getPool();
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet set;
+  VkResult result =
+      vkAllocateDescriptorSets(mp_context->getDevice(), &allocInfo, &set);
+
+  // Retire the pool and retry once with a fresh one
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+      result == VK_ERROR_FRAGMENTED_POOL) {
+    m_fullPools.push_back(pool);
+    m_readyPools.pop_back();
+
+    pool = getPool();
+    allocInfo.descriptorPool = pool;
+    result =
+        vkAllocateDescriptorSets(mp_context->getDevice(), &allocInfo, &set);
+  }
+
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate descriptor set!");
+  }
+
+  if (p_pool)
+    *p_pool = pool;
+  return set;
+}
+
+void DescriptorAllocator::free(VkDescriptorPool pool, VkDescriptorSet set) {
+  vkFreeDescriptorSets(mp_context->getDevice(), pool, 1, &set);
+
+  // The pool has room again
+  auto full = std::find(m_fullPools.begin(), m_fullPools.end(), pool);
+  if (full != m_fullPools.end()) {
+    m_fullPools.erase(full);
+    m_readyPools.insert(m_readyPools.begin(), pool);
+  }
+}
+
+void DescriptorAllocator::reset() {
+  for (VkDescriptorPool pool : m_readyPools)
+    vkResetDescriptorPool(mp_context->getDevice(), pool, 0);
+  for (VkDescriptorPool pool : m_fullPools) {
+    vkResetDescriptorPool(mp_context->getDevice(), pool, 0);
+    m_readyPools.push_back(pool);
+  }
+  m_fullPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::getPool() {
+  if (m_readyPools.empty()) {
+    m_setsPerPool = std::min(m_setsPerPool + m_setsPerPool / 2,
+                             MAX_SETS_PER_POOL);
+    m_readyPools.push_back(createPool(m_setsPerPool));
+  }
+  return m_readyPools.back();
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const PoolSizeRatio &ratio : m_ratios) {
+    poolSizes.push_back(
+        {ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio *
+                                                        setCount))});
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags = m_flags;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = setCount;
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(mp_context->getDevice(), &poolInfo, nullptr,
+                             &pool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+
+  return pool;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <vector>
+
+// Chain of descriptor pools. When the current pool runs out another one is
+// taken from the ready list or created, each new pool larger than the last.
+// reset() recycles every pool at once, individual sets are only freed when
+// the pools were created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT.
+class DescriptorAllocator {
+public:
+  // Descriptors of each type per set in a pool
+  struct PoolSizeRatio {
+    VkDescriptorType type;
+    float ratio;
+  };
+
+  void init(VulkanContext *p_context, uint32_t initialSets,
+            const std::vector<PoolSizeRatio> &ratios,
+            VkDescriptorPoolCreateFlags flags = 0);
+  void shutdown();
+
+  // `p_pool` receives the pool the set came from, for free()
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout,
+                           VkDescriptorPool *p_pool = nullptr);
+  void free(VkDescriptorPool pool, VkDescriptorSet set);
+
+  // Every set from this allocator must be out of use by the GPU
+  void reset();
+
+  size_t getPoolCount() const {
+    return m_fullPools.size() + m_readyPools.size();
+  }
+
+private:
+  VkDescriptorPool getPool();
+  VkDescriptorPool createPool(uint32_t setCount);
+
+private:
+  VulkanContext *mp_context;
+  std::vector<PoolSizeRatio> m_ratios;
+  VkDescriptorPoolCreateFlags m_flags = 0;
+  uint32_t m_setsPerPool = 0;
+
+  std::vector<VkDescriptorPool> m_fullPools;
+  std::vector<VkDescriptorPool> m_readyPools;
+};
@@ -1,98 +1,89 @@
 #include "DescriptorManager.h"
-#include "Common/UniformBufferObject.h"
-#include "Common/UniformBufferObject.h"
-#include "Renderer/BufferManager/UniformBufferManager.h"
-#include "Texture/Texture.h"
-#include <array>
 #include <stdexcept>
 #include <vector>
 
-void DescriptorManager::init(VulkanContext *p_context) {
-  mp_context = p_context;
-}
+// Longer than any number of frames in flight, so an evicted set is never
+// still referenced by a command buffer
+const uint64_t CACHED_SET_LIFETIME = 120;
 
-void DescriptorManager::createPool(uint32_t framesInFlight) {
+// Sized for the shaders we have, pools grow on demand
+const uint32_t INITIAL_SETS_PER_POOL = 64;
 
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(framesInFlight);
-  poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(framesInFlight);
+static const std::vector<DescriptorAllocator::PoolSizeRatio> POOL_RATIOS = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 0.5f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f},
+};
 
-  VkDescriptorPoolCreateInfo poolInfo{};
-  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-  poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = static_cast<uint32_t>(framesInFlight);
-
-  if (vkCreateDescriptorPool(mp_context->getDevice(), &poolInfo, nullptr,
-                             &m_pool) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create descriptor pool!");
-  }
-}
-// TODO: Hack Implementation
-std::vector<VkDescriptorSet>
-DescriptorManager::allocateSets(std::vector<VkDescriptorSetLayout> layouts,
-                                std::vector<UBOManager> &uniformBuffers,
-                                Texture &texutre, uint32_t framesInFlight) {
+void DescriptorManager::init(VulkanContext *p_context,
+                             uint32_t framesInFlight) {
+  mp_context = p_context;
 
-  std::vector<VkDescriptorSet> descriptorSets;
+  m_frameAllocators.resize(framesInFlight);
+  for (DescriptorAllocator &allocator : m_frameAllocators)
+    allocator.init(mp_context, INITIAL_SETS_PER_POOL, POOL_RATIOS);
 
-  VkDescriptorSetAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = m_pool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(framesInFlight);
-  allocInfo.pSetLayouts = layouts.data();
+  m_cachedAllocator.init(mp_context, INITIAL_SETS_PER_POOL, POOL_RATIOS,
+                         VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+}
 
-  descriptorSets.resize(framesInFlight);
-  if (vkAllocateDescriptorSets(mp_context->getDevice(), &allocInfo,
-                               descriptorSets.data()) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate descriptor sets!");
-  }
+void DescriptorManager::beginFrame(uint32_t frameIndex) {
+  m_frameIndex = frameIndex;
+  m_frame++;
 
-  for (size_t i = 0; i < framesInFlight; i++) {
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = uniformBuffers[i].getBuffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
+  m_frameAllocators[frameIndex].reset();
+  evictCached();
+}
 
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = texutre.getImageView();
-    imageInfo.sampler = texutre.getSampler();
+VkDescriptorSet
+DescriptorManager::allocateFrame(VkDescriptorSetLayout layout,
+                                 const DescriptorWriter &writer) {
+  VkDescriptorSet set = m_frameAllocators[m_frameIndex].allocate(layout);
+  writer.update(mp_context->getDevice(), set);
+  return set;
+}
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+VkDescriptorSet DescriptorManager::getCached(VkDescriptorSetLayout layout,
+                                             const DescriptorWriter &writer) {
+  CacheKey key{layout, writer};
+  auto it = m_cache.find(key);
+  if (it != m_cache.end()) {
+    it->second.lastUsedFrame = m_frame;
+    return it->second.set;
+  }
 
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = descriptorSets[i];
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
+  CachedSet cached{};
+  cached.set = m_cachedAllocator.allocate(layout, &cached.pool);
+  cached.lastUsedFrame = m_frame;
+  writer.update(mp_context->getDevice(), cached.set);
 
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = descriptorSets[i];
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType =
-        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
+  m_cache.emplace(std::move(key), cached);
+  return cached.set;
+}
 
-    vkUpdateDescriptorSets(mp_context->getDevice(),
-                           static_cast<uint32_t>(descriptorWrites.size()),
-                           descriptorWrites.data(), 0, nullptr);
+void DescriptorManager::evictCached() {
+  for (auto it = m_cache.begin(); it != m_cache.end();) {
+    if (m_frame - it->second.lastUsedFrame < CACHED_SET_LIFETIME) {
+      ++it;
+      continue;
+    }
+    m_cachedAllocator.free(it->second.pool, it->second.set);
+    it = m_cache.erase(it);
   }
-  return descriptorSets;
 }
 
-void DescriptorManager::update(std::vector<VkDescriptorSet> &sets,
-                               const std::vector<VkBuffer> &uniformBuffers,
-                               VkImageView textureView,
-                               VkSampler textureSampler) {}
+size_t DescriptorManager::CacheKeyHash::operator()(const CacheKey &key) const {
+  return key.writer.hash() ^
+         (reinterpret_cast<uint64_t>(key.layout) * 1099511628211ull);
+}
 
 void DescriptorManager::shutdown() {
-
-  vkDestroyDescriptorPool(mp_context->getDevice(), m_pool, nullptr);
+  m_cache.clear();
+  m_cachedAllocator.shutdown();
+  for (DescriptorAllocator &allocator : m_frameAllocators)
+    allocator.shutdown();
+  m_frameAllocators.clear();
 }
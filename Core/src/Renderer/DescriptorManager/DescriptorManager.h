@@ -1,28 +1,59 @@
 #pragma once
 
-#include "BufferManager/UniformBufferManager.h"
+#include "DescriptorManager/DescriptorAllocator.h"
+#include "DescriptorManager/DescriptorWriter.h"
 #include "Swapchain/Swapchain.h"
-#include "Texture/Texture.h"
 #include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
+// Hands out descriptor sets two ways:
+//  - allocateFrame: from a pool chain owned by the frame in flight, all of
+//    it reset in bulk once that frame's fence has signaled
+//  - getCached: long lived sets keyed by layout and contents, reused as long
+//    as they keep being requested
 class DescriptorManager {
 public:
-  void init(VulkanContext *p_context);
+  void init(VulkanContext *p_context, uint32_t framesInFlight);
 
-  void createPool(uint32_t framesInFlight);
+  // After the frame's fence wait, its transient sets are recycled
+  void beginFrame(uint32_t frameIndex);
 
-  std::vector<VkDescriptorSet>
-  allocateSets(std::vector<VkDescriptorSetLayout> layouts,
-               std::vector<UBOManager> &uniformBuffers, Texture &texutre,
-               uint32_t framesInFlight);
+  // Valid until this frame slot comes around again
+  VkDescriptorSet allocateFrame(VkDescriptorSetLayout layout,
+                                const DescriptorWriter &writer);
 
-  void update(std::vector<VkDescriptorSet> &sets,
-              const std::vector<VkBuffer> &uniformBuffers,
-              VkImageView textureView, VkSampler textureSampler);
+  // The resources written must outlive the entry. Entries not requested for
+  // CACHED_SET_LIFETIME frames are freed.
+  VkDescriptorSet getCached(VkDescriptorSetLayout layout,
+                            const DescriptorWriter &writer);
 
   void shutdown();
 
+private:
+  struct CacheKey {
+    VkDescriptorSetLayout layout;
+    DescriptorWriter writer;
+    bool operator==(const CacheKey &other) const = default;
+  };
+  struct CacheKeyHash {
+    size_t operator()(const CacheKey &key) const;
+  };
+  struct CachedSet {
+    VkDescriptorSet set;
+    VkDescriptorPool pool;
+    uint64_t lastUsedFrame;
+  };
+
+  void evictCached();
+
 private:
   VulkanContext *mp_context;
-  VkDescriptorPool m_pool;
+  uint32_t m_frameIndex = 0;
+  uint64_t m_frame = 0;
+
+  std::vector<DescriptorAllocator> m_frameAllocators;
+  DescriptorAllocator m_cachedAllocator;
+  std::unordered_map<CacheKey, CachedSet, CacheKeyHash> m_cache;
 };
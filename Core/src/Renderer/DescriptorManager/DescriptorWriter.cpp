@@ -0,0 +1,101 @@
+#include "DescriptorWriter.h"
+
+static bool isImageDescriptor(VkDescriptorType type) {
+  return type == VK_DESCRIPTOR_TYPE_SAMPLER ||
+         type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+         type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+         type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+         type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+DescriptorWriter &DescriptorWriter::writeBuffer(uint32_t binding,
+                                                VkDescriptorType type,
+                                                VkBuffer buffer,
+                                                VkDeviceSize offset,
+                                                VkDeviceSize range) {
+  Write write{};
+  write.binding = binding;
+  write.type = type;
+  write.buffer = {buffer, offset, range};
+  m_writes.push_back(write);
+  return *this;
+}
+
+DescriptorWriter &DescriptorWriter::writeImage(uint32_t binding,
+                                               VkDescriptorType type,
+                                               VkImageView imageView,
+                                               VkSampler sampler,
+                                               VkImageLayout layout) {
+  Write write{};
+  write.binding = binding;
+  write.type = type;
+  write.image = {sampler, imageView, layout};
+  m_writes.push_back(write);
+  return *this;
+}
+
+void DescriptorWriter::update(VkDevice device, VkDescriptorSet set) const {
+  std::vector<VkWriteDescriptorSet> descriptorWrites(m_writes.size());
+  for (size_t i = 0; i < m_writes.size(); i++) {
+    const Write &write = m_writes[i];
+    VkWriteDescriptorSet &descriptorWrite = descriptorWrites[i];
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = write.binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = write.type;
+    descriptorWrite.descriptorCount = 1;
+    if (isImageDescriptor(write.type))
+      descriptorWrite.pImageInfo = &write.image;
+    else
+      descriptorWrite.pBufferInfo = &write.buffer;
+  }
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()),
+                         descriptorWrites.data(), 0, nullptr);
+}
+
+size_t DescriptorWriter::hash() const {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t word) {
+    hash ^= word;
+    hash *= 1099511628211ull;
+  };
+
+  for (const Write &write : m_writes) {
+    mix((uint64_t(write.binding) << 32) | uint32_t(write.type));
+    if (isImageDescriptor(write.type)) {
+      mix(reinterpret_cast<uint64_t>(write.image.imageView));
+      mix(reinterpret_cast<uint64_t>(write.image.sampler));
+      mix(write.image.imageLayout);
+    } else {
+      mix(reinterpret_cast<uint64_t>(write.buffer.buffer));
+      mix(write.buffer.offset);
+      mix(write.buffer.range);
+    }
+  }
+  return static_cast<size_t>(hash);
+}
+
+bool DescriptorWriter::operator==(const DescriptorWriter &other) const {
+  if (m_writes.size() != other.m_writes.size())
+    return false;
+
+  for (size_t i = 0; i < m_writes.size(); i++) {
+    const Write &a = m_writes[i];
+    const Write &b = other.m_writes[i];
+    if (a.binding != b.binding || a.type != b.type)
+      return false;
+    if (isImageDescriptor(a.type)) {
+      if (a.image.imageView != b.image.imageView ||
+          a.image.sampler != b.image.sampler ||
+          a.image.imageLayout != b.image.imageLayout)
+        return false;
+    } else if (a.buffer.buffer != b.buffer.buffer ||
+               a.buffer.offset != b.buffer.offset ||
+               a.buffer.range != b.buffer.range) {
+      return false;
+    }
+  }
+  return true;
+}
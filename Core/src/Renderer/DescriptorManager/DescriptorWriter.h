@@ -0,0 +1,34 @@
+#pragma once
+
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Collects the contents of a descriptor set, applied with update(). Also
+// the cache key for DescriptorManager::getCached.
+class DescriptorWriter {
+public:
+  DescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorType type,
+                                VkBuffer buffer, VkDeviceSize offset,
+                                VkDeviceSize range);
+  DescriptorWriter &writeImage(uint32_t binding, VkDescriptorType type,
+                               VkImageView imageView, VkSampler sampler,
+                               VkImageLayout layout);
+
+  void update(VkDevice device, VkDescriptorSet set) const;
+  void clear() { m_writes.clear(); }
+
+  size_t hash() const;
+  bool operator==(const DescriptorWriter &other) const;
+
+private:
+  struct Write {
+    uint32_t binding;
+    VkDescriptorType type;
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+  };
+
+  std::vector<Write> m_writes;
+};
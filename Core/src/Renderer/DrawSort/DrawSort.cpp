@@ -0,0 +1,87 @@
+#include "DrawSort.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+
+const uint32_t RADIX_BITS = 8;
+const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+uint64_t clampField(uint32_t value, uint32_t bits) {
+  return std::min<uint64_t>(value, (uint64_t(1) << bits) - 1);
+}
+
+// Bit patterns of non negative floats sort like the floats themselves, the
+// top 24 bits keep the exponent and 15 bits of mantissa
+uint64_t depthField(float viewDepth) {
+  return std::bit_cast<uint32_t>(std::max(viewDepth, 0.0f)) >>
+         (32 - DRAW_SORT_DEPTH_BITS);
+}
+
+} // namespace
+
+uint64_t makeDrawSortKey(DrawLayer layer, uint32_t pipeline, uint32_t material,
+                         float viewDepth) {
+  uint64_t pipelineField = clampField(pipeline, DRAW_SORT_PIPELINE_BITS);
+  uint64_t materialField = clampField(material, DRAW_SORT_MATERIAL_BITS);
+  uint64_t depth = depthField(viewDepth);
+  uint64_t key = static_cast<uint64_t>(layer) << 62;
+
+  if (layer == DrawLayer::Opaque) {
+    key |= pipelineField << 50;
+    key |= materialField << 38;
+    key |= depth << 14;
+  } else {
+    uint64_t reversed = ((uint64_t(1) << DRAW_SORT_DEPTH_BITS) - 1) - depth;
+    key |= reversed << 38;
+    key |= pipelineField << 26;
+    key |= materialField << 14;
+  }
+  return key;
+}
+
+void DrawSorter::sort(const std::vector<uint64_t> &keys,
+                      std::vector<uint32_t> &order) {
+  uint32_t count = static_cast<uint32_t>(keys.size());
+  order.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  if (count < 2)
+    return;
+
+  // Histograms of every digit in one pass over the keys
+  std::array<std::array<uint32_t, RADIX_SIZE>, RADIX_PASSES> histograms{};
+  for (uint64_t key : keys) {
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+      histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+  }
+
+  m_keys.assign(keys.begin(), keys.end());
+  m_keysScratch.resize(count);
+  m_orderScratch.resize(count);
+  for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+    std::array<uint32_t, RADIX_SIZE> &histogram = histograms[pass];
+    uint32_t shift = pass * RADIX_BITS;
+    if (histogram[(m_keys[0] >> shift) & (RADIX_SIZE - 1)] == count)
+      continue;
+
+    uint32_t offset = 0;
+    for (uint32_t &bucket : histogram) {
+      uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t destination =
+          histogram[(m_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+      m_keysScratch[destination] = m_keys[i];
+      m_orderScratch[destination] = order[i];
+    }
+    m_keys.swap(m_keysScratch);
+    order.swap(m_orderScratch);
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Draws are ordered by one 64 bit key per frame. The top bits pick the
+// layer, opaque draws come before blended ones. Opaque draws are grouped by
+// pipeline, then material, and go front to back within a group so early
+// depth testing rejects what is hidden. Blended draws have to go back to
+// front, state only groups draws at the same depth.
+//
+//   opaque   layer:2 | pipeline:12 | material:12 | depth:24 | 0:14
+//   blended  layer:2 | far:24      | pipeline:12 | material:12 | 0:14
+enum class DrawLayer : uint32_t {
+  Opaque,
+  Blended,
+};
+
+const uint32_t DRAW_SORT_PIPELINE_BITS = 12;
+const uint32_t DRAW_SORT_MATERIAL_BITS = 12;
+const uint32_t DRAW_SORT_DEPTH_BITS = 24;
+
+// `pipeline` and `material` are small per-frame ids, larger ones are
+// clamped and only cost some binds. `viewDepth` is the distance in front
+// of the camera.
+uint64_t makeDrawSortKey(DrawLayer layer, uint32_t pipeline, uint32_t material,
+                         float viewDepth);
+
+// Stable LSD radix sort of 64 bit keys, 8 bits per pass. Passes whose
+// digit is the same for every key are skipped, so the unused low bits of
+// draw keys cost nothing.
+class DrawSorter {
+public:
+  // Indices into `keys` in ascending key order, ties keep their order
+  void sort(const std::vector<uint64_t> &keys, std::vector<uint32_t> &order);
+
+private:
+  // Reused across frames
+  std::vector<uint64_t> m_keys;
+  std::vector<uint64_t> m_keysScratch;
+  std::vector<uint32_t> m_orderScratch;
+};
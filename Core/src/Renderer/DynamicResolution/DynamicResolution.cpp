@@ -0,0 +1,60 @@
+#include "DynamicResolution/DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float MIN_SCALE = 0.1f;
+const float MAX_SCALE = 2.0f;
+
+VkExtent2D scaleExtent(VkExtent2D extent, float scale) {
+  auto scaled = [scale](uint32_t size) {
+    return std::max(1u, static_cast<uint32_t>(std::lround(size * scale)));
+  };
+  return {scaled(extent.width), scaled(extent.height)};
+}
+
+} // namespace
+
+void DynamicResolution::setSettings(
+    const DynamicResolutionSettings &settings) {
+  m_settings = settings;
+  m_settings.maxScale = std::clamp(m_settings.maxScale, MIN_SCALE, MAX_SCALE);
+  m_settings.minScale =
+      std::clamp(m_settings.minScale, MIN_SCALE, m_settings.maxScale);
+  m_settings.targetFrameMs = std::max(m_settings.targetFrameMs, 0.1f);
+
+  m_scale = std::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+  m_lastHeadroom = 0.0f;
+}
+
+void DynamicResolution::update(double gpuFrameMs) {
+  if (!m_settings.enabled)
+    return;
+
+  float headroom = 1.0f - static_cast<float>(gpuFrameMs) /
+                              m_settings.targetFrameMs;
+  if (std::abs(headroom) < m_settings.deadband)
+    headroom = 0.0f;
+
+  // Velocity form, clamping the output is all the anti windup it needs
+  float delta = m_settings.proportionalGain * (headroom - m_lastHeadroom) +
+                m_settings.integralGain * headroom;
+  m_lastHeadroom = headroom;
+
+  m_scale =
+      std::clamp(m_scale + delta, m_settings.minScale, m_settings.maxScale);
+}
+
+VkExtent2D
+DynamicResolution::getTargetExtent(VkExtent2D swapchainExtent) const {
+  return scaleExtent(swapchainExtent, m_settings.maxScale);
+}
+
+VkExtent2D
+DynamicResolution::getRenderExtent(VkExtent2D swapchainExtent) const {
+  VkExtent2D target = getTargetExtent(swapchainExtent);
+  VkExtent2D extent = scaleExtent(swapchainExtent, m_scale);
+  return {std::min(extent.width, target.width),
+          std::min(extent.height, target.height)};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+
+struct DynamicResolutionSettings {
+  // Off renders straight into the swapchain image at full resolution
+  bool enabled = false;
+  // GPU time a frame should fit in
+  float targetFrameMs = 16.0f;
+  // Bounds of the scale applied to both axes of the swapchain extent. The
+  // offscreen target is sized for maxScale, up to 2 for supersampling.
+  float minScale = 0.5f;
+  float maxScale = 1.0f;
+  // Velocity form PI controller on the relative headroom,
+  // 1 - gpuTime / target. Scale change per frame for a change in headroom
+  // and for the headroom itself.
+  float proportionalGain = 0.2f;
+  float integralGain = 0.05f;
+  // Headroom this close to zero counts as on target, keeps the scale from
+  // hunting around it
+  float deadband = 0.03f;
+};
+
+// Picks the fraction of the swapchain resolution the scene is rendered at
+// from measured GPU frame times. The scene goes into the top left of an
+// offscreen target sized for the largest scale, so the target itself never
+// changes size as the scale moves.
+//
+// Timings arrive frames in flight late and were rendered at an older
+// scale, the gains should stay small enough for that delay.
+class DynamicResolution {
+public:
+  // Bounds are clamped to [0.1, 2], the scale into them
+  void setSettings(const DynamicResolutionSettings &settings);
+  const DynamicResolutionSettings &getSettings() const { return m_settings; }
+
+  bool isEnabled() const { return m_settings.enabled; }
+
+  // One measured GPU frame time
+  void update(double gpuFrameMs);
+
+  // 1 while disabled
+  float getScale() const { return m_settings.enabled ? m_scale : 1.0f; }
+
+  // Size of the offscreen target, and of the part of it rendered this frame
+  VkExtent2D getTargetExtent(VkExtent2D swapchainExtent) const;
+  VkExtent2D getRenderExtent(VkExtent2D swapchainExtent) const;
+
+private:
+  DynamicResolutionSettings m_settings;
+  float m_scale = 1.0f;
+  float m_lastHeadroom = 0.0f;
+};
@@ -0,0 +1,297 @@
+#include "Lighting/CascadedShadowMaps.h"
+#include "Common/Images/CreateImage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iterator>
+#include <stdexcept>
+
+// Blend between uniform (0) and logarithmic (1) cascade splits
+const float SHADOW_SPLIT_LAMBDA = 0.85f;
+// Cached cascades cover this much more than their frustum slice, how far
+// the camera can move before they are rendered again
+const float SHADOW_CACHE_MARGIN = 1.5f;
+// Cosine between the old and new light direction below which cached
+// cascades are rendered again
+const float SHADOW_LIGHT_TURN_COS = 0.99999f;
+
+// Whether light space bounds throw shadows into the square of half extent
+// `radius` around `center`, whose receivers end at `farDepth`
+static bool castsInto(const ShadowCaster &bounds, const glm::vec3 &center,
+                      float radius, float farDepth) {
+  if (bounds.boundsMax.x < center.x - radius ||
+      bounds.boundsMin.x > center.x + radius ||
+      bounds.boundsMax.y < center.y - radius ||
+      bounds.boundsMin.y > center.y + radius)
+    return false;
+  // Behind every receiver
+  return -bounds.boundsMax.z <= farDepth;
+}
+
+static bool boundsLess(const ShadowCaster &a, const ShadowCaster &b) {
+  return std::memcmp(&a, &b, sizeof(ShadowCaster)) < 0;
+}
+
+void CascadedShadowMaps::init(VulkanContext *p_context) {
+  mp_context = p_context;
+
+  // Linear filtering turns the compare sampler into 2x2 PCF for free
+  VkFormatFeatureFlags required =
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  bool linearFilter = false;
+  for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM}) {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(mp_context->getPhysicalDevice(),
+                                        format, &properties);
+    if ((properties.optimalTilingFeatures & required) == required) {
+      m_format = format;
+      linearFilter = properties.optimalTilingFeatures &
+                     VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+      break;
+    }
+  }
+  if (m_format == VK_FORMAT_UNDEFINED) {
+    throw std::runtime_error("failed to find a shadow map format!");
+  }
+
+  createImage(mp_context, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, m_format,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                  VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_memory, 1,
+              SHADOW_CASCADE_COUNT);
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    m_cascadeViews[i] = createImageView(mp_context, m_image, m_format,
+                                        VK_IMAGE_ASPECT_DEPTH_BIT, 1, i, 1);
+  }
+  m_arrayView =
+      createImageView(mp_context, m_image, m_format, VK_IMAGE_ASPECT_DEPTH_BIT,
+                      1, 0, SHADOW_CASCADE_COUNT);
+
+  // Outside the cascade is lit
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = linearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+  samplerInfo.minFilter = samplerInfo.magFilter;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  samplerInfo.compareEnable = VK_TRUE;
+  samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = 0.0f;
+
+  if (vkCreateSampler(mp_context->getDevice(), &samplerInfo, nullptr,
+                      &m_sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shadow map sampler!");
+  }
+}
+
+void CascadedShadowMaps::shutdown() {
+  VkDevice device = mp_context->getDevice();
+  vkDestroySampler(device, m_sampler, nullptr);
+  vkDestroyImageView(device, m_arrayView, nullptr);
+  for (VkImageView view : m_cascadeViews) {
+    vkDestroyImageView(device, view, nullptr);
+  }
+  vkDestroyImage(device, m_image, nullptr);
+  vkFreeMemory(device, m_memory, nullptr);
+  m_image = VK_NULL_HANDLE;
+  m_memory = VK_NULL_HANDLE;
+}
+
+void CascadedShadowMaps::beginFrame() { m_hasLight = false; }
+
+void CascadedShadowMaps::setLight(const Light &light) {
+  m_hasLight = true;
+  m_direction = glm::normalize(light.direction);
+  m_color = light.color * light.intensity;
+
+  glm::vec3 up = std::abs(m_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                                 : glm::vec3(0.0f, 1.0f, 0.0f);
+  m_lightView = glm::lookAt(glm::vec3(0.0f), m_direction, up);
+}
+
+void CascadedShadowMaps::setDepthRange(float nearPlane, float farPlane) {
+  m_near = nearPlane;
+  m_far = farPlane;
+}
+
+void CascadedShadowMaps::update(const glm::mat4 &view, const glm::mat4 &proj,
+                                const std::vector<ShadowCaster> &casters) {
+  m_stats = {};
+  for (Cascade &cascade : m_cascades) {
+    cascade.render = false;
+    cascade.casters.clear();
+  }
+  if (!m_hasLight)
+    return;
+
+  // Light space bounds of every caster, shared by the cascades
+  glm::mat3 rotation(m_lightView);
+  glm::mat3 absRotation;
+  for (int column = 0; column < 3; column++) {
+    absRotation[column] = glm::abs(rotation[column]);
+  }
+  auto toLightSpace = [&](const ShadowCaster &caster) -> ShadowCaster {
+    glm::vec3 center =
+        rotation * ((caster.boundsMin + caster.boundsMax) * 0.5f);
+    glm::vec3 extent =
+        absRotation * ((caster.boundsMax - caster.boundsMin) * 0.5f);
+    return {center - extent, center + extent};
+  };
+  m_lightSpaceCasters.clear();
+  for (const ShadowCaster &caster : casters) {
+    m_lightSpaceCasters.push_back(toLightSpace(caster));
+  }
+
+  // World bounds only in this frame's set or only in last frame's are
+  // casters that moved, appeared or went away. Cached cascades are rendered
+  // again when one of those, old place or new, throws shadows into them.
+  std::vector<ShadowCaster> sortedCasters = casters;
+  std::sort(sortedCasters.begin(), sortedCasters.end(), boundsLess);
+  m_changedCasters.clear();
+  std::set_symmetric_difference(
+      sortedCasters.begin(), sortedCasters.end(), m_previousCasters.begin(),
+      m_previousCasters.end(), std::back_inserter(m_changedCasters),
+      boundsLess);
+  m_previousCasters.swap(sortedCasters);
+  for (ShadowCaster &bounds : m_changedCasters) {
+    bounds = toLightSpace(bounds);
+  }
+
+  bool lightTurned =
+      glm::dot(m_direction, m_cachedDirection) < SHADOW_LIGHT_TURN_COS;
+  if (lightTurned)
+    m_cachedDirection = m_direction;
+  for (uint32_t i = SHADOW_FIRST_CACHED_CASCADE; i < SHADOW_CASCADE_COUNT;
+       i++) {
+    Cascade &cascade = m_cascades[i];
+    if (cascade.dirty)
+      continue;
+    cascade.dirty =
+        lightTurned ||
+        std::any_of(m_changedCasters.begin(), m_changedCasters.end(),
+                    [&](const ShadowCaster &bounds) {
+                      return castsInto(bounds, cascade.center, cascade.radius,
+                                       -cascade.center.z + cascade.radius);
+                    });
+  }
+
+  // Practical split scheme, a blend of uniform and logarithmic splits
+  float nearPlane = m_near;
+  float farPlane = std::min(m_far, SHADOW_MAX_DISTANCE);
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    float p = static_cast<float>(i + 1) / SHADOW_CASCADE_COUNT;
+    float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+    float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+    m_splits[i] =
+        uniformSplit + (logSplit - uniformSplit) * SHADOW_SPLIT_LAMBDA;
+  }
+
+  // The corners of a frustum slice lie on the view space corner rays
+  glm::mat4 invView = glm::inverse(view);
+  float tanX = 1.0f / proj[0][0];
+  float tanY = 1.0f / std::abs(proj[1][1]);
+
+  float sliceNear = nearPlane;
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    float sliceFar = m_splits[i];
+
+    glm::vec3 corners[8];
+    uint32_t corner = 0;
+    for (float depth : {sliceNear, sliceFar}) {
+      for (float x : {-1.0f, 1.0f}) {
+        for (float y : {-1.0f, 1.0f}) {
+          corners[corner++] = glm::vec3(
+              invView *
+              glm::vec4(x * depth * tanX, y * depth * tanY, -depth, 1.0f));
+        }
+      }
+    }
+    sliceNear = sliceFar;
+
+    glm::vec3 center(0.0f);
+    for (const glm::vec3 &point : corners) {
+      center += point / 8.0f;
+    }
+    float radius = 0.0f;
+    for (const glm::vec3 &point : corners) {
+      radius = std::max(radius, glm::length(point - center));
+    }
+    // Quantized so float noise does not change the cascade's size
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    glm::vec3 lightCenter = glm::vec3(m_lightView * glm::vec4(center, 1.0f));
+
+    Cascade &cascade = m_cascades[i];
+    if (i < SHADOW_FIRST_CACHED_CASCADE) {
+      fitCascade(cascade, lightCenter, radius);
+    } else {
+      glm::vec3 offset = glm::abs(lightCenter - cascade.center);
+      bool covered = offset.x + radius <= cascade.radius &&
+                     offset.y + radius <= cascade.radius &&
+                     offset.z + radius <= cascade.radius;
+      if (!cascade.dirty && covered)
+        continue;
+      fitCascade(cascade, lightCenter, radius * SHADOW_CACHE_MARGIN);
+    }
+
+    cascade.render = true;
+    m_stats.renderedCascades++;
+    m_stats.casterDraws += static_cast<uint32_t>(cascade.casters.size());
+  }
+}
+
+void CascadedShadowMaps::fitCascade(Cascade &cascade, const glm::vec3 &center,
+                                    float radius) {
+  // Moves in whole texels only, keeps the shadow edges from shimmering
+  float texelSize = 2.0f * radius / SHADOW_MAP_SIZE;
+  glm::vec3 snapped = center;
+  snapped.x = std::floor(center.x / texelSize) * texelSize;
+  snapped.y = std::floor(center.y / texelSize) * texelSize;
+
+  // Light space looks down -z. Receivers end at the sphere, casters in
+  // front of it still throw shadows into it.
+  float nearDepth = -snapped.z - radius;
+  float farDepth = -snapped.z + radius;
+  cascade.casters.clear();
+  for (uint32_t i = 0; i < m_lightSpaceCasters.size(); i++) {
+    const ShadowCaster &bounds = m_lightSpaceCasters[i];
+    if (!castsInto(bounds, snapped, radius, farDepth))
+      continue;
+
+    nearDepth = std::min(nearDepth, -bounds.boundsMax.z);
+    cascade.casters.push_back(i);
+  }
+
+  glm::mat4 lightProj =
+      glm::orthoRH_ZO(snapped.x - radius, snapped.x + radius,
+                      snapped.y - radius, snapped.y + radius, nearDepth,
+                      farDepth);
+  lightProj[1][1] *= -1; // Vulkan Y, same winding as the camera
+
+  cascade.viewProj = lightProj * m_lightView;
+  cascade.center = snapped;
+  cascade.radius = radius;
+  cascade.texelSize = texelSize;
+}
+
+void CascadedShadowMaps::markRendered(uint32_t cascade, bool complete) {
+  if (complete)
+    m_cascades[cascade].dirty = false;
+}
+
+void CascadedShadowMaps::fillUniforms(UniformBufferObject &ubo) const {
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    ubo.cascadeViewProj[i] = m_cascades[i].viewProj;
+    ubo.cascadeSplits[i] = m_splits[i];
+    ubo.cascadeTexelSizes[i] = m_cascades[i].texelSize;
+  }
+  ubo.sunDirection = glm::vec4(m_direction, m_hasLight ? 1.0f : 0.0f);
+  ubo.sunColor = glm::vec4(m_hasLight ? m_color : glm::vec3(0.0f), 0.0f);
+}
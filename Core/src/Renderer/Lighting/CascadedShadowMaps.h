@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Common/UniformBufferObject.h"
+#include "Lighting/Light.h"
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Matches the cascade arrays of UniformBufferObject and shader.frag
+const uint32_t SHADOW_CASCADE_COUNT = 4;
+const uint32_t SHADOW_MAP_SIZE = 2048;
+// Cascades from this one on are cached. They are fitted with some margin
+// and only rendered again when the light turns, a caster moves, appears or
+// goes away inside them, or the camera leaves the area they were rendered
+// for.
+const uint32_t SHADOW_FIRST_CACHED_CASCADE = 2;
+// Shadows end this far from the camera, or at its far plane if closer
+const float SHADOW_MAX_DISTANCE = 150.0f;
+
+// World space bounds of a shadow caster
+struct ShadowCaster {
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+};
+
+// Cascaded shadow maps for the directional light. The cascades split the
+// camera frustum between its near plane and SHADOW_MAX_DISTANCE and live in
+// the layers of one depth array image, which persists across frames so
+// cached cascades keep their contents.
+//
+// Each cascade is fitted with a bounding sphere of its frustum slice, so its
+// size does not change as the camera turns, and is snapped to its texels to
+// keep the shadows from shimmering.
+class CascadedShadowMaps {
+public:
+  struct Stats {
+    uint32_t renderedCascades = 0;
+    // Casters drawn into the rendered cascades
+    uint32_t casterDraws = 0;
+  };
+
+  void init(VulkanContext *p_context);
+  void shutdown();
+
+  // Drops last frame's light, frames without one have no sun
+  void beginFrame();
+  // The last one set in a frame wins
+  void setLight(const Light &light);
+  bool hasLight() const { return m_hasLight; }
+
+  void setDepthRange(float nearPlane, float farPlane);
+
+  // Fits the cascades to the camera, decides which ones are rendered this
+  // frame and culls the casters for those
+  void update(const glm::mat4 &view, const glm::mat4 &proj,
+              const std::vector<ShadowCaster> &casters);
+
+  bool needsRender(uint32_t cascade) const {
+    return m_cascades[cascade].render;
+  }
+  // Indices into the casters given to update() overlapping the cascade
+  const std::vector<uint32_t> &getCasters(uint32_t cascade) const {
+    return m_cascades[cascade].casters;
+  }
+  // Once its pass is recorded. A cached cascade missing some of its casters,
+  // e.g. while their pipelines compile, is rendered again next frame.
+  void markRendered(uint32_t cascade, bool complete);
+
+  void fillUniforms(UniformBufferObject &ubo) const;
+
+  VkFormat getFormat() const { return m_format; }
+  VkExtent2D getExtent() const { return {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE}; }
+  VkImage getImage() const { return m_image; }
+  // One layer, what the cascade is rendered into
+  VkImageView getCascadeView(uint32_t cascade) const {
+    return m_cascadeViews[cascade];
+  }
+  // Every layer, sampled with getSampler() as a sampler2DArrayShadow
+  VkImageView getArrayView() const { return m_arrayView; }
+  VkSampler getSampler() const { return m_sampler; }
+
+  // How the image is left at the end of a frame, UNDEFINED until the first
+  // one has used it
+  VkImageLayout getLayout() const { return m_layout; }
+  void setLayout(VkImageLayout layout) { m_layout = layout; }
+
+  const Stats &getStats() const { return m_stats; }
+
+private:
+  struct Cascade {
+    glm::mat4 viewProj{1.0f};
+    // Light space center and half extent it was rendered with
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+    float texelSize = 0.0f;
+    // Cached cascades only, contents out of date
+    bool dirty = true;
+
+    // This frame
+    bool render = false;
+    std::vector<uint32_t> casters;
+  };
+
+  // Sets the cascade's matrix for a sphere around `center` in light space,
+  // near plane pulled back to the casters in front of it
+  void fitCascade(Cascade &cascade, const glm::vec3 &center, float radius);
+
+private:
+  VulkanContext *mp_context;
+
+  VkFormat m_format = VK_FORMAT_UNDEFINED;
+  VkImage m_image = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  std::array<VkImageView, SHADOW_CASCADE_COUNT> m_cascadeViews{};
+  VkImageView m_arrayView = VK_NULL_HANDLE;
+  VkSampler m_sampler = VK_NULL_HANDLE;
+  VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  bool m_hasLight = false;
+  glm::vec3 m_direction{0.0f, -1.0f, 0.0f};
+  glm::vec3 m_color{0.0f};
+  // Rotation only, light space looks down -z along the light
+  glm::mat4 m_lightView{1.0f};
+
+  float m_near = 0.1f;
+  float m_far = 1000.0f;
+  // View space distance each cascade ends at
+  std::array<float, SHADOW_CASCADE_COUNT> m_splits{};
+  std::array<Cascade, SHADOW_CASCADE_COUNT> m_cascades;
+
+  // Light direction the cached cascades were rendered with
+  glm::vec3 m_cachedDirection{0.0f};
+  // Light space bounds of this frame's casters
+  std::vector<ShadowCaster> m_lightSpaceCasters;
+  // Last frame's world bounds, sorted, and in light space the ones in only
+  // one of the two sets
+  std::vector<ShadowCaster> m_previousCasters;
+  std::vector<ShadowCaster> m_changedCasters;
+
+  Stats m_stats;
+};
+static_assert(SHADOW_CASCADE_COUNT == 4,
+              "UniformBufferObject and shader.frag hold 4 cascades");
@@ -0,0 +1,85 @@
+#include "Lighting/ClusteredLighting.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void ClusteredLighting::init(VulkanContext *p_context,
+                             BufferManager *p_bufferManager,
+                             uint32_t framesInFlight) {
+  mp_context = p_context;
+  mp_bufferManager = p_bufferManager;
+  m_lights.reserve(MAX_LIGHTS);
+
+  VkDeviceSize alignment = std::max<VkDeviceSize>(
+      mp_context->getProperties().limits.minStorageBufferOffsetAlignment, 1);
+  m_clusterBytes =
+      CLUSTER_COUNT * (1 + MAX_LIGHTS_PER_CLUSTER) * sizeof(uint32_t);
+  m_clusterSliceSize = (m_clusterBytes + alignment - 1) / alignment * alignment;
+
+  // Only ever written and read by the GPU
+  mp_bufferManager->createBuffer(m_clusterSliceSize * framesInFlight,
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 m_clusterBuffer, m_clusterMemory);
+}
+
+void ClusteredLighting::shutdown() {
+  vkDestroyBuffer(mp_context->getDevice(), m_clusterBuffer, nullptr);
+  vkFreeMemory(mp_context->getDevice(), m_clusterMemory, nullptr);
+  m_clusterBuffer = VK_NULL_HANDLE;
+  m_clusterMemory = VK_NULL_HANDLE;
+}
+
+void ClusteredLighting::beginFrame() { m_lights.clear(); }
+
+void ClusteredLighting::addLight(const Light &light) {
+  if (m_lights.size() >= MAX_LIGHTS)
+    return;
+
+  // Point lights get a cone every direction is fully inside of, the
+  // smoothstep in shader.frag is 1 for any cosine >= -1
+  bool spot = light.type == LightType::Spot;
+  float cosInner = spot ? std::cos(light.innerAngle) : -1.0f;
+  float cosOuter = spot ? std::cos(light.outerAngle) : -2.0f;
+  // Unused by point lights, which may leave it zero
+  glm::vec3 direction(0.0f, -1.0f, 0.0f);
+  if (spot && glm::dot(light.direction, light.direction) > 0.0f)
+    direction = glm::normalize(light.direction);
+
+  GpuLight gpuLight;
+  gpuLight.positionRange = glm::vec4(light.position, light.range);
+  gpuLight.colorCosInner = glm::vec4(light.color * light.intensity, cosInner);
+  gpuLight.directionCosOuter = glm::vec4(direction, cosOuter);
+  m_lights.push_back(gpuLight);
+}
+
+void ClusteredLighting::setDepthRange(float nearPlane, float farPlane) {
+  m_near = nearPlane;
+  m_far = farPlane;
+}
+
+void ClusteredLighting::fillUniforms(UniformBufferObject &ubo,
+                                     VkExtent2D extent) const {
+  ubo.clusterGrid = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z,
+                               static_cast<uint32_t>(m_lights.size()));
+
+  // slice = log(viewDepth) * scale + bias, 0 at the near plane and
+  // CLUSTER_GRID_Z at the far plane
+  float scale = CLUSTER_GRID_Z / std::log(m_far / m_near);
+  float bias = -scale * std::log(m_near);
+  ubo.clusterParams = glm::vec4(static_cast<float>(extent.width),
+                                static_cast<float>(extent.height), scale, bias);
+}
+
+LightBufferRange
+ClusteredLighting::uploadLights(UniformRingBuffer &ring) const {
+  // A storage buffer binding may not be empty
+  VkDeviceSize size =
+      std::max<size_t>(m_lights.size(), 1) * sizeof(GpuLight);
+  UniformAllocation allocation = ring.allocate(size);
+  if (!m_lights.empty()) {
+    std::memcpy(allocation.mapped, m_lights.data(),
+                m_lights.size() * sizeof(GpuLight));
+  }
+  return {allocation.offset, size};
+}
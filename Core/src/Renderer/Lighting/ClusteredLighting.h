@@ -0,0 +1,75 @@
+#pragma once
+
+#include "BufferManager/BufferManager.h"
+#include "BufferManager/UniformRingBuffer.h"
+#include "Common/UniformBufferObject.h"
+#include "Lighting/Light.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <vector>
+
+// Froxel grid, matches cluster_lights.comp and shader.frag. Slices are
+// spaced exponentially between the camera's near and far planes.
+const uint32_t CLUSTER_GRID_X = 16;
+const uint32_t CLUSTER_GRID_Y = 9;
+const uint32_t CLUSTER_GRID_Z = 24;
+const uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+// Lights past this in one cluster are dropped, matches the shaders
+const uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+// Lights past this in one frame are dropped
+const uint32_t MAX_LIGHTS = 4096;
+
+// Where this frame's lights went in the uniform ring, bound as a storage
+// buffer
+struct LightBufferRange {
+  VkDeviceSize offset = 0;
+  VkDeviceSize range = 0;
+};
+
+// Clustered forward lighting. Lights are submitted every frame and copied
+// to the uniform ring, a compute pass (cluster_lights.comp) then bins them
+// into the froxels of the view frustum and the fragment shader only loops
+// over the lights of its own cluster.
+//
+// The per-cluster light lists live in a device local buffer with one slice
+// per frame in flight, each cluster holding a count followed by up to
+// MAX_LIGHTS_PER_CLUSTER light indices.
+class ClusteredLighting {
+public:
+  void init(VulkanContext *p_context, BufferManager *p_bufferManager,
+            uint32_t framesInFlight);
+  void shutdown();
+
+  // Drops last frame's lights
+  void beginFrame();
+  void addLight(const Light &light);
+
+  void setDepthRange(float nearPlane, float farPlane);
+  // The cluster grid and slice parameters the shaders read
+  void fillUniforms(UniformBufferObject &ubo, VkExtent2D extent) const;
+
+  LightBufferRange uploadLights(UniformRingBuffer &ring) const;
+
+  VkBuffer getClusterBuffer() const { return m_clusterBuffer; }
+  VkDeviceSize getClusterOffset(uint32_t frameIndex) const {
+    return m_clusterSliceSize * frameIndex;
+  }
+  VkDeviceSize getClusterRange() const { return m_clusterBytes; }
+  uint32_t getLightCount() const {
+    return static_cast<uint32_t>(m_lights.size());
+  }
+
+private:
+  VulkanContext *mp_context;
+  BufferManager *mp_bufferManager;
+
+  std::vector<GpuLight> m_lights;
+  float m_near = 0.1f;
+  float m_far = 1000.0f;
+
+  VkBuffer m_clusterBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_clusterMemory = VK_NULL_HANDLE;
+  VkDeviceSize m_clusterBytes = 0;
+  // m_clusterBytes rounded up to the storage buffer offset alignment
+  VkDeviceSize m_clusterSliceSize = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <glm/glm.hpp>
+
+enum class LightType {
+  Point,
+  Spot,
+  // Sun, shadowed by CascadedShadowMaps, one per frame
+  Directional,
+};
+
+struct Light {
+  LightType type = LightType::Point;
+  glm::vec3 position{0.0f};
+  // Distance at which the light fades out, also what it is culled by
+  float range = 10.0f;
+  glm::vec3 color{1.0f};
+  float intensity = 1.0f;
+  // Spot and directional lights, the direction the light travels. Spot
+  // lights only, radians from the direction.
+  glm::vec3 direction{0.0f, -1.0f, 0.0f};
+  float innerAngle = 0.3f;
+  float outerAngle = 0.5f;
+};
+
+// std430 layout of a light in the shaders' Lights buffer
+struct GpuLight {
+  // xyz world space position, w range
+  glm::vec4 positionRange;
+  // rgb color times intensity, w cosine of the inner cone angle, -1 for
+  // point lights
+  glm::vec4 colorCosInner;
+  // xyz direction, w cosine of the outer cone angle, -2 for point lights
+  glm::vec4 directionCosOuter;
+};
+static_assert(sizeof(GpuLight) == 48, "GpuLight must match the shaders");
@@ -0,0 +1,135 @@
+#include "DescriptorLayoutCache.h"
+#include <algorithm>
+#include <stdexcept>
+
+static uint64_t hashWords(const uint64_t *words, size_t count,
+                          uint64_t hash = 14695981039346656037ull) {
+  for (size_t i = 0; i < count; i++) {
+    hash ^= words[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool DescriptorLayoutCache::SetLayoutKey::operator==(
+    const SetLayoutKey &other) const {
+  return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(),
+                    other.bindings.end(),
+                    [](const VkDescriptorSetLayoutBinding &a,
+                       const VkDescriptorSetLayoutBinding &b) {
+                      return a.binding == b.binding &&
+                             a.descriptorType == b.descriptorType &&
+                             a.descriptorCount == b.descriptorCount &&
+                             a.stageFlags == b.stageFlags;
+                    });
+}
+
+size_t DescriptorLayoutCache::SetLayoutKeyHash::operator()(
+    const SetLayoutKey &key) const {
+  uint64_t hash = 14695981039346656037ull;
+  for (const VkDescriptorSetLayoutBinding &binding : key.bindings) {
+    uint64_t words[] = {
+        (uint64_t(binding.binding) << 32) | uint32_t(binding.descriptorType),
+        (uint64_t(binding.descriptorCount) << 32) | binding.stageFlags,
+    };
+    hash = hashWords(words, 2, hash);
+  }
+  return static_cast<size_t>(hash);
+}
+
+bool DescriptorLayoutCache::PipelineLayoutKey::operator==(
+    const PipelineLayoutKey &other) const {
+  return setLayouts == other.setLayouts &&
+         std::equal(pushConstants.begin(), pushConstants.end(),
+                    other.pushConstants.begin(), other.pushConstants.end(),
+                    [](const VkPushConstantRange &a,
+                       const VkPushConstantRange &b) {
+                      return a.stageFlags == b.stageFlags &&
+                             a.offset == b.offset && a.size == b.size;
+                    });
+}
+
+size_t DescriptorLayoutCache::PipelineLayoutKeyHash::operator()(
+    const PipelineLayoutKey &key) const {
+  uint64_t hash = 14695981039346656037ull;
+  for (VkDescriptorSetLayout layout : key.setLayouts) {
+    uint64_t word = reinterpret_cast<uint64_t>(layout);
+    hash = hashWords(&word, 1, hash);
+  }
+  for (const VkPushConstantRange &range : key.pushConstants) {
+    uint64_t words[] = {(uint64_t(range.stageFlags) << 32) | range.offset,
+                        range.size};
+    hash = hashWords(words, 2, hash);
+  }
+  return static_cast<size_t>(hash);
+}
+
+void DescriptorLayoutCache::init(VulkanContext *p_context) {
+  mp_context = p_context;
+}
+
+void DescriptorLayoutCache::shutdown() {
+  for (auto &[key, layout] : m_pipelineLayouts)
+    vkDestroyPipelineLayout(mp_context->getDevice(), layout, nullptr);
+  m_pipelineLayouts.clear();
+
+  for (auto &[key, layout] : m_setLayouts)
+    vkDestroyDescriptorSetLayout(mp_context->getDevice(), layout, nullptr);
+  m_setLayouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getSetLayout(
+    std::vector<VkDescriptorSetLayoutBinding> bindings) {
+  std::sort(bindings.begin(), bindings.end(),
+            [](const VkDescriptorSetLayoutBinding &a,
+               const VkDescriptorSetLayoutBinding &b) {
+              return a.binding < b.binding;
+            });
+  for (VkDescriptorSetLayoutBinding &binding : bindings)
+    binding.pImmutableSamplers = nullptr;
+
+  SetLayoutKey key{std::move(bindings)};
+  auto it = m_setLayouts.find(key);
+  if (it != m_setLayouts.end())
+    return it->second;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+  layoutInfo.pBindings = key.bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(mp_context->getDevice(), &layoutInfo, nullptr,
+                                  &layout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor set layout!");
+  }
+
+  m_setLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+VkPipelineLayout DescriptorLayoutCache::getPipelineLayout(
+    const std::vector<VkDescriptorSetLayout> &setLayouts,
+    const std::vector<VkPushConstantRange> &pushConstants) {
+  PipelineLayoutKey key{setLayouts, pushConstants};
+  auto it = m_pipelineLayouts.find(key);
+  if (it != m_pipelineLayouts.end())
+    return it->second;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount =
+      static_cast<uint32_t>(pushConstants.size());
+  pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+  VkPipelineLayout layout;
+  if (vkCreatePipelineLayout(mp_context->getDevice(), &pipelineLayoutInfo,
+                             nullptr, &layout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  m_pipelineLayouts.emplace(std::move(key), layout);
+  return layout;
+}
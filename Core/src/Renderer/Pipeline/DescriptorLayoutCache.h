@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Deduplicates descriptor set layouts and pipeline layouts by content, so
+// shaders declaring the same resources share one layout and their descriptor
+// sets stay compatible. Main thread only.
+class DescriptorLayoutCache {
+public:
+  void init(VulkanContext *p_context);
+  void shutdown();
+
+  // Bindings in any order, ignoring pImmutableSamplers
+  VkDescriptorSetLayout
+  getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+
+  VkPipelineLayout
+  getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                    const std::vector<VkPushConstantRange> &pushConstants);
+
+  size_t getSetLayoutCount() const { return m_setLayouts.size(); }
+
+private:
+  struct SetLayoutKey {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    bool operator==(const SetLayoutKey &other) const;
+  };
+  struct SetLayoutKeyHash {
+    size_t operator()(const SetLayoutKey &key) const;
+  };
+
+  struct PipelineLayoutKey {
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstants;
+    bool operator==(const PipelineLayoutKey &other) const;
+  };
+  struct PipelineLayoutKeyHash {
+    size_t operator()(const PipelineLayoutKey &key) const;
+  };
+
+private:
+  VulkanContext *mp_context;
+
+  std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKeyHash>
+      m_setLayouts;
+  std::unordered_map<PipelineLayoutKey, VkPipelineLayout,
+                     PipelineLayoutKeyHash>
+      m_pipelineLayouts;
+};
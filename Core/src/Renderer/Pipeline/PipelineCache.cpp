@@ -0,0 +1,156 @@
+#include "PipelineCache.h"
+#include "Common/Files/readFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <vector>
+
+static const uint32_t CACHE_FILE_MAGIC = 0x43505256; // "VRPC"
+static const uint32_t CACHE_FILE_VERSION = 1;
+
+struct PipelineCacheFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint32_t driverVersion;
+  uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  uint64_t dataSize;
+  uint64_t dataHash;
+};
+
+// FNV-1a, only guards against truncated or damaged files
+static uint64_t hashData(const char *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+void PipelineCache::init(VulkanContext *p_context, const std::string &path) {
+  mp_context = p_context;
+  m_path = path;
+  vkGetPhysicalDeviceProperties(mp_context->getPhysicalDevice(),
+                                &m_deviceProperties);
+
+  std::vector<char> data;
+  m_warm = loadFromDisk(data);
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = m_warm ? data.size() : 0;
+  cacheInfo.pInitialData = m_warm ? data.data() : nullptr;
+
+  if (vkCreatePipelineCache(mp_context->getDevice(), &cacheInfo, nullptr,
+                            &m_cache) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+
+  std::println("Pipeline cache: {} ({})", m_path,
+               m_warm ? "warm" : "cold");
+}
+
+void PipelineCache::shutdown() {
+  save();
+  vkDestroyPipelineCache(mp_context->getDevice(), m_cache, nullptr);
+  m_cache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::loadFromDisk(std::vector<char> &data) {
+  std::vector<char> file;
+  try {
+    file = readFile(m_path);
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+
+  PipelineCacheFileHeader header{};
+  if (file.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, file.data(), sizeof(header));
+
+  if (header.magic != CACHE_FILE_MAGIC ||
+      header.version != CACHE_FILE_VERSION ||
+      header.vendorID != m_deviceProperties.vendorID ||
+      header.deviceID != m_deviceProperties.deviceID ||
+      header.driverVersion != m_deviceProperties.driverVersion ||
+      std::memcmp(header.pipelineCacheUUID,
+                  m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    std::println("Pipeline cache: {} is for another device or driver",
+                 m_path);
+    return false;
+  }
+
+  if (header.dataSize != file.size() - sizeof(header) ||
+      hashData(file.data() + sizeof(header), header.dataSize) !=
+          header.dataHash) {
+    std::println("Pipeline cache: {} is corrupt", m_path);
+    return false;
+  }
+
+  data.assign(file.begin() + sizeof(header), file.end());
+
+  // The driver validates its own header too, but a mismatch there means the
+  // blob is useless, so check it before handing it over
+  VkPipelineCacheHeaderVersionOne vkHeader{};
+  if (data.size() < sizeof(vkHeader))
+    return false;
+  std::memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+
+  return vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         vkHeader.vendorID == m_deviceProperties.vendorID &&
+         vkHeader.deviceID == m_deviceProperties.deviceID &&
+         std::memcmp(vkHeader.pipelineCacheUUID,
+                     m_deviceProperties.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() {
+  size_t dataSize = 0;
+  vkGetPipelineCacheData(mp_context->getDevice(), m_cache, &dataSize, nullptr);
+
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(mp_context->getDevice(), m_cache, &dataSize,
+                             data.data()) != VK_SUCCESS) {
+    std::println("Pipeline cache: failed to read cache data");
+    return;
+  }
+  data.resize(dataSize);
+
+  PipelineCacheFileHeader header{};
+  header.magic = CACHE_FILE_MAGIC;
+  header.version = CACHE_FILE_VERSION;
+  header.vendorID = m_deviceProperties.vendorID;
+  header.deviceID = m_deviceProperties.deviceID;
+  header.driverVersion = m_deviceProperties.driverVersion;
+  std::memcpy(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  header.dataSize = data.size();
+  header.dataHash = hashData(data.data(), data.size());
+
+  // Write next to the target and rename, a crash never leaves half a file
+  std::string tempPath = m_path + ".tmp";
+  std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::println("Pipeline cache: failed to write {}", tempPath);
+    return;
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(data.data(), static_cast<std::streamsize>(data.size()));
+  // A short write (full disk) must not replace the previous good cache
+  file.close();
+  if (file.fail()) {
+    std::println("Pipeline cache: failed to write {}", tempPath);
+    std::remove(tempPath.c_str());
+    return;
+  }
+  if (std::rename(tempPath.c_str(), m_path.c_str()) != 0) {
+    std::println("Pipeline cache: failed to replace {}", m_path);
+    std::remove(tempPath.c_str());
+  }
+}
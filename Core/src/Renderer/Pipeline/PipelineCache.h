@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <string>
+
+// VkPipelineCache backed by a file on disk. The file carries its own header
+// keyed by the device's pipelineCacheUUID, vendor/device IDs and driver
+// version, a stale or corrupt file is ignored and the cache starts empty.
+class PipelineCache {
+public:
+  void init(VulkanContext *p_context, const std::string &path);
+  // Saves the cache back to disk before destroying it
+  void shutdown();
+
+  void save();
+
+  VkPipelineCache getCache() const { return m_cache; }
+
+  // True when pipelines are created from a cache loaded from disk
+  bool isWarm() const { return m_warm; }
+
+private:
+  bool loadFromDisk(std::vector<char> &data);
+
+private:
+  VulkanContext *mp_context;
+  VkPipelineCache m_cache = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties m_deviceProperties{};
+
+  std::string m_path;
+  bool m_warm = false;
+};
@@ -0,0 +1,650 @@
+#include "PipelineManager.h"
+#include "Common/Files/readFile.h"
+#include "Common/Vertex.h"
+#include "Pipeline/ShaderCompiler.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void PipelineManager::init(VulkanContext *p_context,
+                           PipelineCache *p_pipelineCache,
+                           Core::ThreadPool *p_threadPool,
+                           DeletionQueue *p_deletionQueue) {
+  mp_context = p_context;
+  mp_pipelineCache = p_pipelineCache;
+  mp_threadPool = p_threadPool;
+  mp_deletionQueue = p_deletionQueue;
+
+  m_layoutCache.init(p_context);
+}
+
+void PipelineManager::shutdown() {
+  // Workers may still be compiling, their results land in m_built. No
+  // reloads are polled or applied, they would start new jobs.
+  mp_threadPool->waitIdle();
+  publishBuilt();
+  destroyRetiredModules(true);
+
+  if (mp_fileWatcher)
+    mp_fileWatcher->shutdown();
+  mp_fileWatcher.reset();
+
+  for (auto &[key, pipeline] : m_pipelines)
+    vkDestroyPipeline(mp_context->getDevice(), pipeline, nullptr);
+  m_pipelines.clear();
+  for (auto &[shader, pipeline] : m_computePipelines)
+    vkDestroyPipeline(mp_context->getDevice(), pipeline, nullptr);
+  m_computePipelines.clear();
+
+  for (Shader &shader : m_shaders)
+    vkDestroyShaderModule(mp_context->getDevice(), shader.module, nullptr);
+  m_shaders.clear();
+
+  m_programLayouts.clear();
+  m_computeLayouts.clear();
+  m_layoutCache.shutdown();
+}
+
+ShaderId PipelineManager::registerShader(const std::string &path) {
+  for (ShaderId id = 0; id < m_shaders.size(); id++) {
+    if (m_shaders[id].path == path)
+      return id;
+  }
+
+  std::vector<uint32_t> spirv = loadShader(path);
+  ShaderReflection reflection = reflectShader(spirv);
+  m_shaders.push_back({path, createShaderModule(spirv), reflection});
+  if (mp_fileWatcher && !isSpirvFile(path))
+    mp_fileWatcher->watch(path);
+  return static_cast<ShaderId>(m_shaders.size() - 1);
+}
+
+void PipelineManager::enableHotReload() {
+  if (mp_fileWatcher)
+    return;
+
+  mp_fileWatcher = std::make_unique<Core::FileWatcher>();
+  mp_fileWatcher->init();
+  for (const Shader &shader : m_shaders) {
+    if (!isSpirvFile(shader.path))
+      mp_fileWatcher->watch(shader.path);
+  }
+}
+
+VkPipeline PipelineManager::getOrCreate(const PipelineKey &key) {
+  auto it = m_pipelines.find(key);
+  if (it != m_pipelines.end())
+    return it->second;
+
+  const ShaderProgramLayout &layout =
+      getProgramLayout(key.vertShader, key.fragShader);
+  auto start = std::chrono::steady_clock::now();
+  VkPipeline pipeline =
+      createGraphicsPipeline(key, m_shaders[key.vertShader].module,
+                             fragmentModule(key.fragShader), layout);
+  m_creationTimeMs += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+
+  m_pipelines.emplace(key, pipeline);
+  return pipeline;
+}
+
+VkPipeline PipelineManager::getOrCreateCompute(ShaderId shader) {
+  auto it = m_computePipelines.find(shader);
+  if (it != m_computePipelines.end())
+    return it->second;
+
+  auto start = std::chrono::steady_clock::now();
+  VkPipeline pipeline = createComputePipeline(m_shaders[shader].module,
+                                              getComputeLayout(shader));
+  m_creationTimeMs += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+
+  m_computePipelines.emplace(shader, pipeline);
+  return pipeline;
+}
+
+VkPipeline PipelineManager::request(const PipelineKey &key) {
+  auto it = m_pipelines.find(key);
+  if (it != m_pipelines.end())
+    return it->second;
+
+  {
+    std::lock_guard lock(m_buildMutex);
+    if (!m_pending.insert(key).second)
+      return VK_NULL_HANDLE;
+  }
+
+  submitBuild(key);
+  return VK_NULL_HANDLE;
+}
+
+void PipelineManager::submitBuild(const PipelineKey &key) {
+  {
+    std::lock_guard lock(m_buildMutex);
+    m_buildsInFlight++;
+  }
+
+  // Modules are captured by value, m_shaders may grow or reload meanwhile
+  VkShaderModule vertModule = m_shaders[key.vertShader].module;
+  VkShaderModule fragModule = fragmentModule(key.fragShader);
+  const ShaderProgramLayout *p_layout =
+      &getProgramLayout(key.vertShader, key.fragShader);
+  uint64_t buildGeneration = generation(key);
+  mp_threadPool->submit([this, key, vertModule, fragModule, p_layout,
+                         buildGeneration] {
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    try {
+      pipeline = createGraphicsPipeline(key, vertModule, fragModule, *p_layout);
+    } catch (const std::exception &e) {
+      std::println("Pipeline build failed: {}", e.what());
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    std::lock_guard lock(m_buildMutex);
+    m_built.push_back({key, pipeline, buildGeneration, ms});
+    m_buildsInFlight--;
+  });
+}
+
+uint64_t PipelineManager::generation(const PipelineKey &key) const {
+  uint32_t fragVersion =
+      key.fragShader != NULL_SHADER ? m_shaders[key.fragShader].version : 0;
+  return (uint64_t(m_shaders[key.vertShader].version) << 32) | fragVersion;
+}
+
+VkShaderModule PipelineManager::fragmentModule(ShaderId fragShader) const {
+  return fragShader != NULL_SHADER ? m_shaders[fragShader].module
+                                   : VK_NULL_HANDLE;
+}
+
+void PipelineManager::update() {
+  pollShaderChanges();
+  applyShaderReloads();
+  publishBuilt();
+  destroyRetiredModules(false);
+}
+
+void PipelineManager::publishBuilt() {
+  std::vector<BuiltPipeline> built;
+  {
+    std::lock_guard lock(m_buildMutex);
+    built = std::move(m_built);
+    m_built.clear();
+    // Failed builds are dropped from pending too and retried on request
+    for (const BuiltPipeline &result : built)
+      m_pending.erase(result.key);
+  }
+
+  for (const BuiltPipeline &result : built) {
+    if (result.pipeline == VK_NULL_HANDLE)
+      continue;
+
+    // A shader was reloaded while this was building, a newer build is
+    // queued or will be on the next request. Never bound, safe to destroy.
+    if (result.generation != generation(result.key)) {
+      vkDestroyPipeline(mp_context->getDevice(), result.pipeline, nullptr);
+      continue;
+    }
+
+    m_creationTimeMs += result.creationTimeMs;
+    auto [it, inserted] = m_pipelines.emplace(result.key, result.pipeline);
+    if (!inserted) {
+      // Rebuild after a reload, frames in flight may still use the old one
+      mp_deletionQueue->destroyPipeline(it->second);
+      it->second = result.pipeline;
+    }
+  }
+}
+
+void PipelineManager::pollShaderChanges() {
+  if (!mp_fileWatcher)
+    return;
+
+  for (const std::string &path : mp_fileWatcher->poll()) {
+    for (ShaderId id = 0; id < m_shaders.size(); id++) {
+      if (m_shaders[id].path != path)
+        continue;
+
+      std::println("Recompiling {}", path);
+      mp_threadPool->submit([this, id, path] {
+        CompiledShader result{id, false, {}, {}, {}};
+        result.success = compileShader(path, result.spirv, result.log);
+        if (result.success) {
+          try {
+            result.reflection = reflectShader(result.spirv);
+          } catch (const std::exception &e) {
+            result.success = false;
+            result.log = e.what();
+          }
+        }
+
+        std::lock_guard lock(m_buildMutex);
+        m_compiled.push_back(std::move(result));
+      });
+    }
+  }
+}
+
+void PipelineManager::applyShaderReloads() {
+  std::vector<CompiledShader> compiled;
+  {
+    std::lock_guard lock(m_buildMutex);
+    compiled = std::move(m_compiled);
+    m_compiled.clear();
+  }
+
+  for (const CompiledShader &result : compiled) {
+    Shader &shader = m_shaders[result.id];
+    if (!result.success) {
+      // Keep drawing with the last good module
+      std::println("Shader reload failed: {}\n{}", shader.path, result.log);
+      continue;
+    }
+
+    // Layouts and the descriptor sets allocated from them are shared, a
+    // changed resource interface needs a restart
+    if (!result.reflection.sameInterface(shader.reflection)) {
+      std::println("Shader reload skipped: {} changed its resource interface, "
+                   "restart to apply",
+                   shader.path);
+      continue;
+    }
+
+    VkShaderModule module;
+    try {
+      module = createShaderModule(result.spirv);
+    } catch (const std::exception &e) {
+      std::println("Shader reload failed: {}: {}", shader.path, e.what());
+      continue;
+    }
+
+    m_retiredModules.push_back(shader.module);
+    shader.module = module;
+    shader.version++;
+
+    // The current pipelines keep drawing until their replacements land
+    for (const auto &[key, pipeline] : m_pipelines) {
+      if (key.vertShader == result.id || key.fragShader == result.id)
+        submitBuild(key);
+    }
+
+    // A single pipeline, not worth a worker
+    auto compute = m_computePipelines.find(result.id);
+    if (compute != m_computePipelines.end()) {
+      try {
+        VkPipeline pipeline =
+            createComputePipeline(module, getComputeLayout(result.id));
+        mp_deletionQueue->destroyPipeline(compute->second);
+        compute->second = pipeline;
+      } catch (const std::exception &e) {
+        std::println("Pipeline build failed: {}", e.what());
+      }
+    }
+  }
+}
+
+void PipelineManager::destroyRetiredModules(bool all) {
+  if (!all) {
+    std::lock_guard lock(m_buildMutex);
+    if (m_buildsInFlight > 0)
+      return;
+  }
+
+  for (VkShaderModule module : m_retiredModules)
+    vkDestroyShaderModule(mp_context->getDevice(), module, nullptr);
+  m_retiredModules.clear();
+}
+
+const ShaderProgramLayout &
+PipelineManager::getProgramLayout(ShaderId vertShader, ShaderId fragShader) {
+  uint64_t programKey = (uint64_t(vertShader) << 32) | fragShader;
+  auto it = m_programLayouts.find(programKey);
+  if (it != m_programLayouts.end())
+    return it->second;
+
+  ShaderProgramLayout layout;
+  if (fragShader != NULL_SHADER)
+    mergeStageLayouts(layout, {vertShader, fragShader});
+  else
+    mergeStageLayouts(layout, {vertShader});
+
+  const ShaderReflection &vert = m_shaders[vertShader].reflection;
+
+  // VertexLayout::Standard is the only layout so far, it provides offsets
+  // and formats for the locations the shader reads
+  auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  for (const VkVertexInputAttributeDescription &input : vert.vertexInputs) {
+    auto attribute = std::find_if(
+        attributeDescriptions.begin(), attributeDescriptions.end(),
+        [&](const VkVertexInputAttributeDescription &a) {
+          return a.location == input.location;
+        });
+    if (attribute == attributeDescriptions.end()) {
+      throw std::runtime_error("failed to match vertex input! " +
+                               m_shaders[vertShader].path + " location " +
+                               std::to_string(input.location));
+    }
+    layout.vertexAttributes.push_back(*attribute);
+  }
+
+  return m_programLayouts.emplace(programKey, std::move(layout)).first->second;
+}
+
+const ShaderProgramLayout &PipelineManager::getComputeLayout(ShaderId shader) {
+  auto it = m_computeLayouts.find(shader);
+  if (it != m_computeLayouts.end())
+    return it->second;
+
+  ShaderProgramLayout layout;
+  mergeStageLayouts(layout, {shader});
+  return m_computeLayouts.emplace(shader, std::move(layout)).first->second;
+}
+
+void PipelineManager::mergeStageLayouts(ShaderProgramLayout &layout,
+                                        const std::vector<ShaderId> &stages) {
+  // Stages may declare the same binding, they must agree on type
+  for (ShaderId id : stages) {
+    const ShaderReflection &reflection = m_shaders[id].reflection;
+    for (const ReflectedBinding &reflected : reflection.bindings) {
+      if (layout.sets.size() <= reflected.set)
+        layout.sets.resize(reflected.set + 1);
+      std::vector<VkDescriptorSetLayoutBinding> &set =
+          layout.sets[reflected.set];
+
+      // Uniform buffers are fed from the UniformRingBuffer, so every one is
+      // bound with a dynamic offset
+      VkDescriptorSetLayoutBinding binding = reflected.binding;
+      if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
+      auto existing = std::find_if(
+          set.begin(), set.end(), [&](const VkDescriptorSetLayoutBinding &b) {
+            return b.binding == binding.binding;
+          });
+      if (existing == set.end()) {
+        set.push_back(binding);
+        continue;
+      }
+      if (existing->descriptorType != binding.descriptorType ||
+          existing->descriptorCount != binding.descriptorCount) {
+        throw std::runtime_error(
+            "failed to merge shader bindings! " + m_shaders[id].path +
+            " disagrees with an earlier stage on set " +
+            std::to_string(reflected.set) + " binding " +
+            std::to_string(reflected.binding.binding));
+      }
+      existing->stageFlags |= binding.stageFlags;
+    }
+  }
+
+  for (const std::vector<VkDescriptorSetLayoutBinding> &set : layout.sets)
+    layout.setLayouts.push_back(m_layoutCache.getSetLayout(set));
+
+  uint32_t maxPushConstantsSize =
+      mp_context->getProperties().limits.maxPushConstantsSize;
+  for (ShaderId id : stages) {
+    const VkPushConstantRange &range = m_shaders[id].reflection.pushConstants;
+    if (range.size == 0)
+      continue;
+    // Such data has to go through the uniform ring instead
+    if (range.offset + range.size > maxPushConstantsSize) {
+      throw std::runtime_error(
+          "push constant block exceeds maxPushConstantsSize! " +
+          m_shaders[id].path);
+    }
+    layout.pushConstants.push_back(range);
+  }
+
+  layout.pipelineLayout =
+      m_layoutCache.getPipelineLayout(layout.setLayouts, layout.pushConstants);
+}
+
+VkPipeline
+PipelineManager::createGraphicsPipeline(const PipelineKey &key,
+                                        VkShaderModule vertModule,
+                                        VkShaderModule fragModule,
+                                        const ShaderProgramLayout &layout) const {
+  const PipelineState &state = key.state;
+
+  VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+  vertShaderStageInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+  vertShaderStageInfo.module = vertModule;
+  vertShaderStageInfo.pName = "main";
+
+  VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+  fragShaderStageInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  fragShaderStageInfo.module = fragModule;
+  fragShaderStageInfo.pName = "main";
+
+  VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo,
+                                                    fragShaderStageInfo};
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+  vertexInputInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  auto bindingDescription = Vertex::getBindingDescription();
+  std::vector<VkVertexInputAttributeDescription> attributes =
+      layout.vertexAttributes;
+  if (key.vertexLayout == VertexLayout::PositionOnly) {
+    bindingDescription = Vertex::getPositionBindingDescription();
+    for (VkVertexInputAttributeDescription &attribute : attributes) {
+      if (attribute.location != 0) {
+        throw std::runtime_error(
+            "position only vertex layout only provides location 0!");
+      }
+      attribute = Vertex::getPositionAttributeDescription();
+    }
+  }
+
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.vertexAttributeDescriptionCount =
+      static_cast<uint32_t>(attributes.size());
+  vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+  vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+  inputAssembly.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = static_cast<VkPrimitiveTopology>(state.topology);
+  inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+  VkPipelineViewportStateCreateInfo viewportState{};
+  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount = 1;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer{};
+  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.depthClampEnable = VK_FALSE;
+  rasterizer.rasterizerDiscardEnable = VK_FALSE;
+  rasterizer.polygonMode = static_cast<VkPolygonMode>(state.polygonMode);
+  // Line and point fill need fillModeNonSolid, fall back to solid
+  if (!mp_context->getEnabledFeatures().fillModeNonSolid)
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth = 1.0f;
+  rasterizer.cullMode = state.cullMode;
+  rasterizer.frontFace = static_cast<VkFrontFace>(state.frontFace);
+  rasterizer.depthBiasEnable = VK_FALSE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling{};
+  multisampling.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.sampleShadingEnable = VK_FALSE;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = state.depthTest;
+  depthStencil.depthWriteEnable = state.depthWrite;
+  depthStencil.depthCompareOp = static_cast<VkCompareOp>(state.depthCompare);
+  depthStencil.depthBoundsTestEnable = VK_FALSE;
+  depthStencil.stencilTestEnable = VK_FALSE;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+  colorBlendAttachment.colorWriteMask =
+      state.colorWrite
+          ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+          : 0;
+  switch (state.blend) {
+  case BlendMode::Opaque:
+    colorBlendAttachment.blendEnable = VK_FALSE;
+    break;
+  case BlendMode::Alpha:
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor =
+        VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor =
+        VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    break;
+  case BlendMode::Additive:
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    break;
+  }
+
+  VkPipelineColorBlendStateCreateInfo colorBlending{};
+  colorBlending.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable = VK_FALSE;
+  colorBlending.logicOp = VK_LOGIC_OP_COPY;
+  colorBlending.attachmentCount =
+      key.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+  colorBlending.pAttachments = &colorBlendAttachment;
+  colorBlending.blendConstants[0] = 0.0f;
+  colorBlending.blendConstants[1] = 0.0f;
+  colorBlending.blendConstants[2] = 0.0f;
+  colorBlending.blendConstants[3] = 0.0f;
+
+  std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT,
+                                               VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState{};
+  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+  dynamicState.pDynamicStates = dynamicStates.data();
+
+  VkGraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  // Depth only pipelines run without a fragment shader
+  pipelineInfo.stageCount = fragModule != VK_NULL_HANDLE ? 2 : 1;
+  pipelineInfo.pStages = shaderStages;
+  pipelineInfo.pVertexInputState = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = layout.pipelineLayout;
+  pipelineInfo.renderPass = key.renderPass;
+  pipelineInfo.subpass = key.subpass;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  // Dynamic rendering, the attachment formats stand in for the render pass
+  VkPipelineRenderingCreateInfo renderingInfo{};
+  if (key.renderPass == VK_NULL_HANDLE) {
+    bool hasColor = key.colorFormat != VK_FORMAT_UNDEFINED;
+    bool hasStencil = key.depthFormat == VK_FORMAT_D16_UNORM_S8_UINT ||
+                      key.depthFormat == VK_FORMAT_D24_UNORM_S8_UINT ||
+                      key.depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT;
+
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = hasColor ? 1 : 0;
+    renderingInfo.pColorAttachmentFormats = &key.colorFormat;
+    renderingInfo.depthAttachmentFormat = key.depthFormat;
+    renderingInfo.stencilAttachmentFormat =
+        hasStencil ? key.depthFormat : VK_FORMAT_UNDEFINED;
+    pipelineInfo.pNext = &renderingInfo;
+  }
+
+  VkPipeline pipeline;
+  if (vkCreateGraphicsPipelines(mp_context->getDevice(),
+                                mp_pipelineCache->getCache(), 1, &pipelineInfo,
+                                nullptr, &pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create graphics pipeline!");
+  }
+
+  return pipeline;
+}
+
+VkPipeline
+PipelineManager::createComputePipeline(VkShaderModule module,
+                                       const ShaderProgramLayout &layout) const {
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = module;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = layout.pipelineLayout;
+
+  VkPipeline pipeline;
+  if (vkCreateComputePipelines(mp_context->getDevice(),
+                               mp_pipelineCache->getCache(), 1, &pipelineInfo,
+                               nullptr, &pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline!");
+  }
+
+  return pipeline;
+}
+
+std::vector<uint32_t> PipelineManager::loadShader(const std::string &path) {
+  std::vector<uint32_t> spirv;
+  if (isSpirvFile(path)) {
+    std::vector<char> code = readFile(path);
+    spirv.resize(code.size() / sizeof(uint32_t));
+    std::memcpy(spirv.data(), code.data(), spirv.size() * sizeof(uint32_t));
+    return spirv;
+  }
+
+  std::string log;
+  if (!compileShader(path, spirv, log)) {
+    throw std::runtime_error("failed to compile shader! " + path + "\n" +
+                             log);
+  }
+  return spirv;
+}
+
+VkShaderModule
+PipelineManager::createShaderModule(const std::vector<uint32_t> &code) {
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size() * sizeof(uint32_t);
+  createInfo.pCode = code.data();
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(mp_context->getDevice(), &createInfo, nullptr,
+                           &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module!");
+  }
+
+  return shaderModule;
+}
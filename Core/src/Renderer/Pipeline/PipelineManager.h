@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Core/FileWatcher.h"
+#include "Core/ThreadPool.h"
+#include "Pipeline/DescriptorLayoutCache.h"
+#include "Pipeline/PipelineCache.h"
+#include "Pipeline/PipelineState.h"
+#include "Pipeline/ShaderReflection.h"
+#include "Swapchain/Swapchain.h"
+#include "VulkanSyncObjects/DeletionQueue.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Everything a vertex/fragment shader pair needs bound, derived from SPIR-V
+// reflection. Layouts come from the DescriptorLayoutCache and are shared by
+// every pair declaring the same resources.
+struct ShaderProgramLayout {
+  // Indexed by set number, gaps hold empty sets
+  std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+  std::vector<VkDescriptorSetLayout> setLayouts;
+  std::vector<VkPushConstantRange> pushConstants;
+  VkPipelineLayout pipelineLayout;
+  // The vertex layout attributes the vertex shader actually reads
+  std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+};
+
+// Owns every graphics and compute pipeline. Graphics pipelines are looked up
+// by PipelineKey and built on demand, either immediately or on the thread
+// pool. Compute pipelines are keyed by their shader alone.
+//
+// With hot reload enabled, edited GLSL sources are recompiled on the thread
+// pool and every pipeline using them is rebuilt in the background. The new
+// pipelines replace the old ones in update(), the old ones are destroyed once
+// the frames that may still reference them have finished.
+class PipelineManager {
+public:
+  void init(VulkanContext *p_context, PipelineCache *p_pipelineCache,
+            Core::ThreadPool *p_threadPool,
+            DeletionQueue *p_deletionQueue);
+  void shutdown();
+
+  // Loads SPIR-V, or compiles GLSL, the returned id goes into PipelineKey
+  ShaderId registerShader(const std::string &path);
+
+  // Watches the GLSL sources of registered shaders, current and future
+  void enableHotReload();
+
+  // Builds the pipeline on the calling thread if it is not cached yet
+  VkPipeline getOrCreate(const PipelineKey &key);
+
+  // Returns VK_NULL_HANDLE and queues the build on a worker when the
+  // pipeline is not ready yet
+  VkPipeline request(const PipelineKey &key);
+
+  // Built on the calling thread on first use. Rebuilt in place when the
+  // shader is reloaded.
+  VkPipeline getOrCreateCompute(ShaderId shader);
+
+  // Main thread, once per frame after the frame timeline wait: publishes
+  // pipelines finished by workers and applies shader reloads
+  void update();
+
+  // Built on first use, stays valid until shutdown
+  const ShaderProgramLayout &getProgramLayout(ShaderId vertShader,
+                                              ShaderId fragShader);
+  const ShaderProgramLayout &getComputeLayout(ShaderId shader);
+
+  size_t getPipelineCount() const { return m_pipelines.size(); }
+  // Total time spent in vkCreateGraphicsPipelines, workers included
+  double getCreationTimeMs() const { return m_creationTimeMs; }
+
+private:
+  struct Shader {
+    std::string path;
+    VkShaderModule module;
+    ShaderReflection reflection;
+    // Bumped on every reload, builds started from an older module are stale
+    uint32_t version = 0;
+  };
+
+  struct BuiltPipeline {
+    PipelineKey key;
+    VkPipeline pipeline;
+    uint64_t generation;
+    double creationTimeMs;
+  };
+
+  struct CompiledShader {
+    ShaderId id;
+    bool success;
+    std::vector<uint32_t> spirv;
+    ShaderReflection reflection;
+    std::string log;
+  };
+
+  std::vector<uint32_t> loadShader(const std::string &path);
+  VkShaderModule createShaderModule(const std::vector<uint32_t> &code);
+
+  void submitBuild(const PipelineKey &key);
+  // Versions of both shaders, compared when a build is published
+  uint64_t generation(const PipelineKey &key) const;
+  // VK_NULL_HANDLE for NULL_SHADER
+  VkShaderModule fragmentModule(ShaderId fragShader) const;
+
+  void pollShaderChanges();
+  void applyShaderReloads();
+  // Moves the pipelines workers finished into m_pipelines
+  void publishBuilt();
+  void destroyRetiredModules(bool all);
+
+  // Descriptor sets and push constants of all stages, merged into one layout
+  void mergeStageLayouts(ShaderProgramLayout &layout,
+                         const std::vector<ShaderId> &stages);
+
+  // Thread safe, only reads immutable state
+  VkPipeline createGraphicsPipeline(const PipelineKey &key,
+                                    VkShaderModule vertModule,
+                                    VkShaderModule fragModule,
+                                    const ShaderProgramLayout &layout) const;
+  VkPipeline createComputePipeline(VkShaderModule module,
+                                   const ShaderProgramLayout &layout) const;
+
+private:
+  VulkanContext *mp_context;
+  PipelineCache *mp_pipelineCache;
+  Core::ThreadPool *mp_threadPool;
+  DeletionQueue *mp_deletionQueue;
+
+  DescriptorLayoutCache m_layoutCache;
+  // (vertShader << 32) | fragShader -> layout, nodes are never erased so
+  // workers may hold pointers into it
+  std::unordered_map<uint64_t, ShaderProgramLayout> m_programLayouts;
+  std::unordered_map<ShaderId, ShaderProgramLayout> m_computeLayouts;
+
+  std::vector<Shader> m_shaders;
+  std::unordered_map<PipelineKey, VkPipeline, PipelineKeyHash> m_pipelines;
+  std::unordered_map<ShaderId, VkPipeline> m_computePipelines;
+  double m_creationTimeMs = 0.0;
+
+  // Keys handed to workers and their results, guarded by m_buildMutex
+  std::mutex m_buildMutex;
+  std::unordered_set<PipelineKey, PipelineKeyHash> m_pending;
+  std::vector<BuiltPipeline> m_built;
+  std::vector<CompiledShader> m_compiled;
+  // Builds still holding a shader module, retired modules outlive them
+  uint32_t m_buildsInFlight = 0;
+
+  std::unique_ptr<Core::FileWatcher> mp_fileWatcher;
+  // Never referenced by command buffers, only by builds that may have
+  // captured them. Replaced pipelines go to the deletion queue.
+  std::vector<VkShaderModule> m_retiredModules;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+#include <cstdint>
+
+using ShaderId = uint32_t;
+// Fragment shader of depth only pipelines
+const ShaderId NULL_SHADER = UINT32_MAX;
+
+enum class BlendMode : uint32_t {
+  Opaque,
+  Alpha,
+  Additive,
+};
+
+enum class VertexLayout : uint32_t {
+  Standard,     // Vertex: pos, color, texCoord, normal
+  PositionOnly, // vec3 position stream, see ObjManager::getPositionBuffer
+};
+
+// Fixed function state that varies between pipeline permutations, packed
+// into 32 bits so keys stay cheap to hash and compare
+struct PipelineState {
+  uint32_t topology : 4 = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  uint32_t polygonMode : 2 = VK_POLYGON_MODE_FILL;
+  uint32_t cullMode : 2 = VK_CULL_MODE_BACK_BIT;
+  uint32_t frontFace : 1 = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  BlendMode blend : 2 = BlendMode::Opaque;
+  uint32_t depthTest : 1 = VK_TRUE;
+  uint32_t depthWrite : 1 = VK_TRUE;
+  uint32_t depthCompare : 3 = VK_COMPARE_OP_LESS;
+  uint32_t colorWrite : 1 = VK_TRUE;
+
+  bool operator==(const PipelineState &other) const {
+    return pack() == other.pack();
+  }
+
+  uint32_t pack() const {
+    return topology | polygonMode << 4 | cullMode << 6 | frontFace << 8 |
+           static_cast<uint32_t>(blend) << 9 | depthTest << 11 |
+           depthWrite << 12 | depthCompare << 13 | colorWrite << 16;
+  }
+
+  // Common permutations
+  static PipelineState opaque() { return PipelineState(); }
+  static PipelineState transparent() {
+    PipelineState state;
+    state.blend = BlendMode::Alpha;
+    state.depthWrite = VK_FALSE;
+    return state;
+  }
+  static PipelineState wireframe() {
+    PipelineState state;
+    state.polygonMode = VK_POLYGON_MODE_LINE;
+    state.cullMode = VK_CULL_MODE_NONE;
+    return state;
+  }
+  static PipelineState doubleSided() {
+    PipelineState state;
+    state.cullMode = VK_CULL_MODE_NONE;
+    return state;
+  }
+  static PipelineState depthPrepass() {
+    PipelineState state;
+    state.colorWrite = VK_FALSE;
+    return state;
+  }
+};
+static_assert(sizeof(PipelineState) == sizeof(uint32_t),
+              "PipelineState must stay packed");
+
+struct PipelineKey {
+  ShaderId vertShader = 0;
+  ShaderId fragShader = 0;
+  VertexLayout vertexLayout = VertexLayout::Standard;
+  PipelineState state;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  uint32_t subpass = 0;
+  // Attachment formats, what the pipeline is built against when renderPass
+  // is VK_NULL_HANDLE (dynamic rendering). VK_FORMAT_UNDEFINED color for
+  // passes without a color attachment.
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+  bool operator==(const PipelineKey &other) const = default;
+};
+
+struct PipelineKeyHash {
+  size_t operator()(const PipelineKey &key) const {
+    uint64_t words[] = {
+        (uint64_t(key.vertShader) << 32) | key.fragShader,
+        (uint64_t(key.vertexLayout) << 32) | key.state.pack(),
+        reinterpret_cast<uint64_t>(key.renderPass),
+        key.subpass,
+        (uint64_t(key.colorFormat) << 32) | key.depthFormat,
+    };
+
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t word : words) {
+      hash ^= word;
+      hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
@@ -0,0 +1,162 @@
+#include "ShaderCompiler.h"
+#include "Common/Files/readFile.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef VULKANRENDERER_SHADERC
+#include <shaderc/shaderc.hpp>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+extern char **environ;
+#endif
+
+#ifndef GLSLC_EXECUTABLE
+#define GLSLC_EXECUTABLE "glslc"
+#endif
+
+bool isSpirvFile(const std::string &path) {
+  return std::filesystem::path(path).extension() == ".spv";
+}
+
+#ifdef VULKANRENDERER_SHADERC
+
+static bool shaderKind(const std::string &path, shaderc_shader_kind &kind) {
+  std::string extension = std::filesystem::path(path).extension().string();
+  if (extension == ".vert")
+    kind = shaderc_glsl_vertex_shader;
+  else if (extension == ".frag")
+    kind = shaderc_glsl_fragment_shader;
+  else if (extension == ".comp")
+    kind = shaderc_glsl_compute_shader;
+  else
+    return false;
+  return true;
+}
+
+bool compileShader(const std::string &path, std::vector<uint32_t> &spirv,
+                   std::string &log) {
+  shaderc_shader_kind kind;
+  if (!shaderKind(path, kind)) {
+    log = "unknown shader stage: " + path;
+    return false;
+  }
+
+  std::vector<char> source;
+  try {
+    source = readFile(path);
+  } catch (const std::exception &e) {
+    log = e.what();
+    return false;
+  }
+
+  // Compiler objects are cheap and not shareable between threads
+  shaderc::Compiler compiler;
+  shaderc::CompileOptions options;
+  options.SetTargetEnvironment(shaderc_target_env_vulkan,
+                               shaderc_env_version_vulkan_1_0);
+  options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+  shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+      source.data(), source.size(), kind, path.c_str(), options);
+  if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+    log = result.GetErrorMessage();
+    return false;
+  }
+
+  spirv.assign(result.cbegin(), result.cend());
+  log = result.GetErrorMessage(); // Warnings
+  return true;
+}
+
+#else
+
+// Creates an empty file with a unique name in the temp directory, several
+// workers and several running instances may compile at once
+static bool makeTempFile(std::string &path) {
+  path = (std::filesystem::temp_directory_path() / "shader_XXXXXX").string();
+  int fd = mkstemp(path.data());
+  if (fd == -1)
+    return false;
+  close(fd);
+  return true;
+}
+
+// Runs glslc directly, without a shell, with stdout and stderr in `logPath`
+static int runGlslc(const std::string &path, const std::string &output,
+                    const std::string &logPath) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath.c_str(),
+                                   O_WRONLY | O_TRUNC, 0);
+  posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+  std::string executable = GLSLC_EXECUTABLE;
+  std::string optimize = "-O";
+  std::string outputFlag = "-o";
+  std::string input = path;
+  std::string outputPath = output;
+  char *argv[] = {executable.data(), optimize.data(), input.data(),
+                  outputFlag.data(), outputPath.data(), nullptr};
+
+  pid_t pid;
+  int status = posix_spawnp(&pid, argv[0], &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (status != 0)
+    return -1;
+
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR)
+      return -1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool compileShader(const std::string &path, std::vector<uint32_t> &spirv,
+                   std::string &log) {
+  std::string output;
+  std::string logPath;
+  if (!makeTempFile(output) || !makeTempFile(logPath)) {
+    log = "failed to create a temporary file for glslc";
+    std::error_code error;
+    std::filesystem::remove(output, error);
+    return false;
+  }
+
+  int status = runGlslc(path, output, logPath);
+
+  std::ifstream logFile(logPath);
+  std::stringstream logStream;
+  logStream << logFile.rdbuf();
+  log = logStream.str();
+  logFile.close();
+  if (status == -1)
+    log += "failed to run " + std::string(GLSLC_EXECUTABLE);
+
+  bool success = false;
+  if (status == 0) {
+    try {
+      std::vector<char> code = readFile(output);
+      spirv.resize(code.size() / sizeof(uint32_t));
+      std::memcpy(spirv.data(), code.data(), spirv.size() * sizeof(uint32_t));
+      success = !spirv.empty();
+    } catch (const std::exception &e) {
+      log += e.what();
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::remove(output, error);
+  std::filesystem::remove(logPath, error);
+  return success;
+}
+
+#endif
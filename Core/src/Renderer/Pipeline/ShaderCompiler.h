@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GLSL -> SPIR-V. Uses shaderc in process when built with
+// VULKANRENDERER_SHADERC, otherwise runs glslc from the Vulkan SDK. The stage
+// is taken from the extension (.vert, .frag, .comp). Thread safe.
+// Returns false and fills `log` with the compiler output on failure.
+bool compileShader(const std::string &path, std::vector<uint32_t> &spirv,
+                   std::string &log);
+
+// .spv files are loaded as is, anything else goes through compileShader
+bool isSpirvFile(const std::string &path);
@@ -0,0 +1,456 @@
+#include "ShaderReflection.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// The subset of the SPIR-V grammar needed for the resource interface
+enum Op : uint32_t {
+  OpEntryPoint = 15,
+  OpTypeBool = 20,
+  OpTypeInt = 21,
+  OpTypeFloat = 22,
+  OpTypeVector = 23,
+  OpTypeMatrix = 24,
+  OpTypeImage = 25,
+  OpTypeSampler = 26,
+  OpTypeSampledImage = 27,
+  OpTypeArray = 28,
+  OpTypeRuntimeArray = 29,
+  OpTypeStruct = 30,
+  OpTypePointer = 32,
+  OpConstant = 43,
+  OpVariable = 59,
+  OpDecorate = 71,
+  OpMemberDecorate = 72,
+};
+
+enum Decoration : uint32_t {
+  DecorationBlock = 2,
+  DecorationBufferBlock = 3,
+  DecorationArrayStride = 6,
+  DecorationMatrixStride = 7,
+  DecorationBuiltIn = 11,
+  DecorationLocation = 30,
+  DecorationBinding = 33,
+  DecorationDescriptorSet = 34,
+  DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+  StorageUniformConstant = 0,
+  StorageInput = 1,
+  StorageUniform = 2,
+  StoragePushConstant = 9,
+  StorageStorageBuffer = 12,
+};
+
+enum Dim : uint32_t {
+  DimBuffer = 5,
+  DimSubpassData = 6,
+};
+
+struct Id {
+  uint32_t opcode = 0;
+  // Type operands: scalar width, component/column/element type and count
+  uint32_t width = 0;
+  bool isSigned = false;
+  uint32_t elementType = 0;
+  uint32_t count = 0;
+  // OpTypeImage
+  uint32_t dim = 0;
+  uint32_t sampled = 0;
+  // OpTypeStruct
+  std::vector<uint32_t> members;
+  std::vector<uint32_t> memberOffsets;
+  std::vector<uint32_t> memberMatrixStrides;
+  uint32_t arrayStride = 0;
+  // OpTypePointer / OpVariable
+  uint32_t storageClass = 0;
+  uint32_t pointee = 0;
+  // OpConstant, low word is enough for array lengths
+  uint32_t value = 0;
+  // Decorations
+  bool block = false;
+  bool bufferBlock = false;
+  bool builtIn = false;
+  uint32_t location = UINT32_MAX;
+  uint32_t set = 0;
+  uint32_t binding = UINT32_MAX;
+};
+
+class Reflector {
+public:
+  explicit Reflector(const std::vector<uint32_t> &spirv) : m_spirv(spirv) {}
+
+  ShaderReflection reflect();
+
+private:
+  void parse();
+  uint32_t typeSize(uint32_t typeId) const;
+  VkFormat inputFormat(uint32_t typeId) const;
+  bool descriptorType(uint32_t typeId, VkDescriptorType &type,
+                      uint32_t &count) const;
+
+  Id &id(uint32_t index) {
+    if (index >= m_ids.size())
+      throw std::runtime_error("failed to reflect shader! id out of range");
+    return m_ids[index];
+  }
+  const Id &id(uint32_t index) const {
+    if (index >= m_ids.size())
+      throw std::runtime_error("failed to reflect shader! id out of range");
+    return m_ids[index];
+  }
+
+private:
+  const std::vector<uint32_t> &m_spirv;
+  std::vector<Id> m_ids;
+  uint32_t m_executionModel = 0;
+  // Decorations on struct members, applied once all types are known
+  struct MemberDecoration {
+    uint32_t structId, member, decoration, value;
+  };
+  std::vector<MemberDecoration> m_memberDecorations;
+};
+
+void Reflector::parse() {
+  if (m_spirv.size() < 5 || m_spirv[0] != 0x07230203)
+    throw std::runtime_error("failed to reflect shader! not SPIR-V");
+
+  m_ids.resize(m_spirv[3]);
+
+  for (size_t pos = 5; pos < m_spirv.size();) {
+    uint32_t wordCount = m_spirv[pos] >> 16;
+    uint32_t opcode = m_spirv[pos] & 0xFFFF;
+    if (wordCount == 0 || pos + wordCount > m_spirv.size())
+      throw std::runtime_error("failed to reflect shader! truncated module");
+    const uint32_t *ops = m_spirv.data() + pos + 1;
+
+    switch (opcode) {
+    case OpEntryPoint:
+      m_executionModel = ops[0];
+      break;
+    case OpTypeBool:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).width = 32;
+      break;
+    case OpTypeInt:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).width = ops[1];
+      id(ops[0]).isSigned = ops[2] != 0;
+      break;
+    case OpTypeFloat:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).width = ops[1];
+      break;
+    case OpTypeVector:
+    case OpTypeMatrix:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).elementType = ops[1];
+      id(ops[0]).count = ops[2];
+      break;
+    case OpTypeImage:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).dim = ops[2];
+      id(ops[0]).sampled = ops[6];
+      break;
+    case OpTypeSampler:
+      id(ops[0]).opcode = opcode;
+      break;
+    case OpTypeSampledImage:
+    case OpTypeRuntimeArray:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).elementType = ops[1];
+      break;
+    case OpTypeArray:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).elementType = ops[1];
+      id(ops[0]).count = ops[2]; // Constant id, resolved on use
+      break;
+    case OpTypeStruct: {
+      Id &type = id(ops[0]);
+      type.opcode = opcode;
+      type.members.assign(ops + 1, ops + wordCount - 1);
+      type.memberOffsets.resize(type.members.size(), 0);
+      type.memberMatrixStrides.resize(type.members.size(), 0);
+      break;
+    }
+    case OpTypePointer:
+      id(ops[0]).opcode = opcode;
+      id(ops[0]).storageClass = ops[1];
+      id(ops[0]).pointee = ops[2];
+      break;
+    case OpConstant:
+      id(ops[1]).opcode = opcode;
+      id(ops[1]).value = ops[2];
+      break;
+    case OpVariable:
+      id(ops[1]).opcode = opcode;
+      id(ops[1]).pointee = ops[0];
+      id(ops[1]).storageClass = ops[2];
+      break;
+    case OpDecorate: {
+      Id &target = id(ops[0]);
+      switch (ops[1]) {
+      case DecorationBlock:
+        target.block = true;
+        break;
+      case DecorationBufferBlock:
+        target.bufferBlock = true;
+        break;
+      case DecorationArrayStride:
+        target.arrayStride = ops[2];
+        break;
+      case DecorationBuiltIn:
+        target.builtIn = true;
+        break;
+      case DecorationLocation:
+        target.location = ops[2];
+        break;
+      case DecorationBinding:
+        target.binding = ops[2];
+        break;
+      case DecorationDescriptorSet:
+        target.set = ops[2];
+        break;
+      }
+      break;
+    }
+    case OpMemberDecorate:
+      if (wordCount > 4)
+        m_memberDecorations.push_back({ops[0], ops[1], ops[2], ops[3]});
+      break;
+    }
+
+    pos += wordCount;
+  }
+
+  for (const MemberDecoration &decoration : m_memberDecorations) {
+    Id &type = id(decoration.structId);
+    if (decoration.member >= type.members.size())
+      continue;
+    if (decoration.decoration == DecorationOffset)
+      type.memberOffsets[decoration.member] = decoration.value;
+    else if (decoration.decoration == DecorationMatrixStride)
+      type.memberMatrixStrides[decoration.member] = decoration.value;
+  }
+}
+
+uint32_t Reflector::typeSize(uint32_t typeId) const {
+  const Id &type = id(typeId);
+  switch (type.opcode) {
+  case OpTypeBool:
+  case OpTypeInt:
+  case OpTypeFloat:
+    return type.width / 8;
+  case OpTypeVector:
+    return type.count * typeSize(type.elementType);
+  case OpTypeMatrix:
+    return type.count * typeSize(type.elementType);
+  case OpTypeArray: {
+    uint32_t length = id(type.count).value;
+    uint32_t stride =
+        type.arrayStride ? type.arrayStride : typeSize(type.elementType);
+    return length * stride;
+  }
+  case OpTypeStruct: {
+    uint32_t size = 0;
+    for (size_t i = 0; i < type.members.size(); i++) {
+      const Id &member = id(type.members[i]);
+      // std140/std430 matrices are padded to the declared stride
+      uint32_t stride = type.memberMatrixStrides[i];
+      uint32_t memberSize = member.opcode == OpTypeMatrix && stride
+                                ? member.count * stride
+                                : typeSize(type.members[i]);
+      size = std::max(size, type.memberOffsets[i] + memberSize);
+    }
+    return size;
+  }
+  }
+  return 0;
+}
+
+VkFormat Reflector::inputFormat(uint32_t typeId) const {
+  const Id &type = id(typeId);
+  uint32_t components = 1;
+  const Id *scalar = &type;
+  if (type.opcode == OpTypeVector) {
+    components = type.count;
+    scalar = &id(type.elementType);
+  }
+
+  static const VkFormat floats[] = {
+      VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+      VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+  static const VkFormat sints[] = {
+      VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT,
+      VK_FORMAT_R32G32B32A32_SINT};
+  static const VkFormat uints[] = {
+      VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT,
+      VK_FORMAT_R32G32B32A32_UINT};
+
+  if (components < 1 || components > 4 || scalar->width != 32)
+    return VK_FORMAT_UNDEFINED;
+  if (scalar->opcode == OpTypeFloat)
+    return floats[components - 1];
+  if (scalar->opcode == OpTypeInt)
+    return scalar->isSigned ? sints[components - 1] : uints[components - 1];
+  return VK_FORMAT_UNDEFINED;
+}
+
+bool Reflector::descriptorType(uint32_t typeId, VkDescriptorType &type,
+                               uint32_t &count) const {
+  count = 1;
+  const Id *resource = &id(typeId);
+  if (resource->opcode == OpTypeArray) {
+    count = id(resource->count).value;
+    resource = &id(resource->elementType);
+  } else if (resource->opcode == OpTypeRuntimeArray) {
+    // Unsized arrays would need descriptor indexing, bind one element
+    resource = &id(resource->elementType);
+  }
+
+  switch (resource->opcode) {
+  case OpTypeSampledImage:
+    type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    return true;
+  case OpTypeSampler:
+    type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    return true;
+  case OpTypeImage:
+    if (resource->dim == DimBuffer)
+      type = resource->sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                    : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    else if (resource->dim == DimSubpassData)
+      type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    else
+      type = resource->sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                                    : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    return true;
+  case OpTypeStruct:
+    if (resource->bufferBlock) {
+      type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      return true;
+    }
+    if (resource->block) {
+      type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+ShaderReflection Reflector::reflect() {
+  parse();
+
+  ShaderReflection reflection;
+  switch (m_executionModel) {
+  case 0:
+    reflection.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    break;
+  case 4:
+    reflection.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    break;
+  case 5:
+    reflection.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    break;
+  default:
+    throw std::runtime_error("failed to reflect shader! unsupported stage " +
+                             std::to_string(m_executionModel));
+  }
+
+  for (const Id &variable : m_ids) {
+    if (variable.opcode != OpVariable)
+      continue;
+    const Id &pointer = id(variable.pointee);
+    uint32_t typeId = pointer.pointee;
+
+    switch (variable.storageClass) {
+    case StorageInput: {
+      if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn ||
+          variable.location == UINT32_MAX)
+        break;
+      VkVertexInputAttributeDescription input{};
+      input.location = variable.location;
+      input.format = inputFormat(typeId);
+      reflection.vertexInputs.push_back(input);
+      break;
+    }
+    case StoragePushConstant: {
+      const Id &block = id(typeId);
+      uint32_t offset = UINT32_MAX;
+      for (uint32_t memberOffset : block.memberOffsets)
+        offset = std::min(offset, memberOffset);
+      if (offset == UINT32_MAX)
+        offset = 0;
+      reflection.pushConstants.stageFlags = reflection.stage;
+      reflection.pushConstants.offset = offset;
+      reflection.pushConstants.size = typeSize(typeId) - offset;
+      break;
+    }
+    case StorageUniformConstant:
+    case StorageUniform:
+    case StorageStorageBuffer: {
+      if (variable.binding == UINT32_MAX)
+        break;
+      ReflectedBinding binding{};
+      binding.set = variable.set;
+      binding.binding.binding = variable.binding;
+      binding.binding.stageFlags = reflection.stage;
+      if (!descriptorType(typeId, binding.binding.descriptorType,
+                          binding.binding.descriptorCount))
+        break;
+      if (variable.storageClass == StorageStorageBuffer)
+        binding.binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      reflection.bindings.push_back(binding);
+      break;
+    }
+    }
+  }
+
+  std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+            [](const ReflectedBinding &a, const ReflectedBinding &b) {
+              return a.set != b.set ? a.set < b.set
+                                    : a.binding.binding < b.binding.binding;
+            });
+  std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+            [](const VkVertexInputAttributeDescription &a,
+               const VkVertexInputAttributeDescription &b) {
+              return a.location < b.location;
+            });
+  return reflection;
+}
+
+} // namespace
+
+bool ShaderReflection::sameInterface(const ShaderReflection &other) const {
+  if (stage != other.stage || bindings.size() != other.bindings.size() ||
+      vertexInputs.size() != other.vertexInputs.size() ||
+      pushConstants.offset != other.pushConstants.offset ||
+      pushConstants.size != other.pushConstants.size)
+    return false;
+
+  for (size_t i = 0; i < bindings.size(); i++) {
+    const ReflectedBinding &a = bindings[i];
+    const ReflectedBinding &b = other.bindings[i];
+    if (a.set != b.set || a.binding.binding != b.binding.binding ||
+        a.binding.descriptorType != b.binding.descriptorType ||
+        a.binding.descriptorCount != b.binding.descriptorCount)
+      return false;
+  }
+
+  for (size_t i = 0; i < vertexInputs.size(); i++) {
+    if (vertexInputs[i].location != other.vertexInputs[i].location ||
+        vertexInputs[i].format != other.vertexInputs[i].format)
+      return false;
+  }
+  return true;
+}
+
+ShaderReflection reflectShader(const std::vector<uint32_t> &spirv) {
+  return Reflector(spirv).reflect();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <vector>
+
+struct ReflectedBinding {
+  uint32_t set;
+  VkDescriptorSetLayoutBinding binding;
+};
+
+// Resource interface of one SPIR-V module
+struct ShaderReflection {
+  VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+  std::vector<ReflectedBinding> bindings;
+  // size == 0 when the stage has no push constant block
+  VkPushConstantRange pushConstants{};
+  // Vertex stage only, binding and offset are left for the vertex layout
+  std::vector<VkVertexInputAttributeDescription> vertexInputs;
+
+  // Pipeline layouts and descriptor sets only stay compatible across a
+  // reload when this holds
+  bool sameInterface(const ShaderReflection &other) const;
+};
+
+// Walks the module once, throws on malformed SPIR-V
+ShaderReflection reflectShader(const std::vector<uint32_t> &spirv);
@@ -0,0 +1,78 @@
+#include "Queries/GpuTimer.h"
+#include <stdexcept>
+
+void GpuTimer::init(VulkanContext *p_context, uint32_t framesInFlight) {
+  mp_context = p_context;
+  m_pending.assign(framesInFlight, false);
+
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(mp_context->getPhysicalDevice(),
+                                           &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(mp_context->getPhysicalDevice(),
+                                           &familyCount, families.data());
+  uint32_t graphicsFamily =
+      mp_context->findQueueFamilies(mp_context->getPhysicalDevice())
+          .graphicsFamily.value();
+
+  uint32_t validBits = families[graphicsFamily].timestampValidBits;
+  if (validBits == 0)
+    return;
+  m_timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+  m_timestampPeriod = mp_context->getProperties().limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = framesInFlight * 2;
+
+  if (vkCreateQueryPool(mp_context->getDevice(), &poolInfo, nullptr,
+                        &m_queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+}
+
+void GpuTimer::shutdown() {
+  if (m_queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(mp_context->getDevice(), m_queryPool, nullptr);
+    m_queryPool = VK_NULL_HANDLE;
+  }
+}
+
+void GpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!isSupported())
+    return;
+
+  // After the work already on the queue, overlap with the previous frame
+  // is not counted
+  vkCmdResetQueryPool(commandBuffer, m_queryPool, frameIndex * 2, 2);
+  vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                       m_queryPool, frameIndex * 2);
+}
+
+void GpuTimer::end(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!isSupported())
+    return;
+
+  vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                       m_queryPool, frameIndex * 2 + 1);
+  m_pending[frameIndex] = true;
+}
+
+bool GpuTimer::collect(uint32_t frameIndex) {
+  if (!isSupported() || !m_pending[frameIndex])
+    return false;
+  m_pending[frameIndex] = false;
+
+  // No wait flag, the frame timeline has already been waited on
+  uint64_t timestamps[2] = {};
+  if (vkGetQueryPoolResults(mp_context->getDevice(), m_queryPool,
+                            frameIndex * 2, 2, sizeof(timestamps), timestamps,
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    return false;
+
+  uint64_t ticks = (timestamps[1] - timestamps[0]) & m_timestampMask;
+  m_frameMs = ticks * m_timestampPeriod * 1e-6;
+  return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// GPU time of each frame, from timestamps written at the start and end of
+// the frame's command buffer. One pair of queries per frame in flight, read
+// back once the frame timeline says the frame is done.
+//
+// Every call is a no-op when the graphics queue has no timestamps.
+class GpuTimer {
+public:
+  void init(VulkanContext *p_context, uint32_t framesInFlight);
+  void shutdown();
+
+  // Outside any render pass, around everything the frame records
+  void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+  void end(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  // After the frame timeline wait for `frameIndex`. True when a new frame
+  // time was read.
+  bool collect(uint32_t frameIndex);
+
+  bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+  // Of the last frame collected, empty until one has been
+  std::optional<double> getFrameMs() const { return m_frameMs; }
+
+private:
+  VulkanContext *mp_context;
+  VkQueryPool m_queryPool = VK_NULL_HANDLE;
+  // Nanoseconds per tick, and the bits of a timestamp that count
+  double m_timestampPeriod = 1.0;
+  uint64_t m_timestampMask = 0;
+  // Queries recorded and not collected yet, indexed by frame
+  std::vector<bool> m_pending;
+  std::optional<double> m_frameMs;
+};
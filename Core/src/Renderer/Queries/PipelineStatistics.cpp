@@ -0,0 +1,63 @@
+#include "Queries/PipelineStatistics.h"
+#include <stdexcept>
+
+void PipelineStatistics::init(VulkanContext *p_context,
+                              uint32_t framesInFlight) {
+  mp_context = p_context;
+  m_pending.assign(framesInFlight, false);
+
+  if (!mp_context->getEnabledFeatures().pipelineStatisticsQuery)
+    return;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  poolInfo.queryCount = framesInFlight;
+  poolInfo.pipelineStatistics =
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+  if (vkCreateQueryPool(mp_context->getDevice(), &poolInfo, nullptr,
+                        &m_queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline statistics pool!");
+  }
+}
+
+void PipelineStatistics::shutdown() {
+  if (m_queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(mp_context->getDevice(), m_queryPool, nullptr);
+    m_queryPool = VK_NULL_HANDLE;
+  }
+}
+
+void PipelineStatistics::begin(VkCommandBuffer commandBuffer,
+                               uint32_t frameIndex) {
+  if (!isSupported())
+    return;
+
+  vkCmdResetQueryPool(commandBuffer, m_queryPool, frameIndex, 1);
+  vkCmdBeginQuery(commandBuffer, m_queryPool, frameIndex, 0);
+}
+
+void PipelineStatistics::end(VkCommandBuffer commandBuffer,
+                             uint32_t frameIndex) {
+  if (!isSupported())
+    return;
+
+  vkCmdEndQuery(commandBuffer, m_queryPool, frameIndex);
+  m_pending[frameIndex] = true;
+}
+
+void PipelineStatistics::collect(uint32_t frameIndex) {
+  if (!isSupported() || !m_pending[frameIndex])
+    return;
+  m_pending[frameIndex] = false;
+
+  // No wait flag, the frame timeline has already been waited on
+  uint64_t invocations = 0;
+  if (vkGetQueryPoolResults(mp_context->getDevice(), m_queryPool, frameIndex,
+                            1, sizeof(invocations), &invocations,
+                            sizeof(invocations),
+                            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+    m_fragmentInvocations = invocations;
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Fragment shader invocations of each frame, counted by a pipeline
+// statistics query around the frame's command buffer. One query per frame
+// in flight, read back once the frame timeline says the frame is done.
+//
+// Every call is a no-op when the device lacks pipelineStatisticsQuery.
+class PipelineStatistics {
+public:
+  void init(VulkanContext *p_context, uint32_t framesInFlight);
+  void shutdown();
+
+  // Outside any render pass, around everything the frame records
+  void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+  void end(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  // After the frame timeline wait for `frameIndex`
+  void collect(uint32_t frameIndex);
+
+  bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+  // Of the last frame collected, empty until one has been
+  std::optional<uint64_t> getFragmentInvocations() const {
+    return m_fragmentInvocations;
+  }
+
+private:
+  VulkanContext *mp_context;
+  VkQueryPool m_queryPool = VK_NULL_HANDLE;
+  // Queries recorded and not collected yet, indexed by frame
+  std::vector<bool> m_pending;
+  std::optional<uint64_t> m_fragmentInvocations;
+};
@@ -0,0 +1,973 @@
+#include "RenderGraph.h"
+#include "Common/Images/CreateImage.h"
+#include "Common/MemoryType/MemoryType.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+struct UsageInfo {
+  VkImageLayout layout;
+  VkAccessFlags2 access;
+  VkImageUsageFlags imageUsage;
+  bool write;
+};
+
+UsageInfo getUsageInfo(RGUsage usage, VkAttachmentLoadOp loadOp) {
+  switch (usage) {
+  case RGUsage::ColorAttachment:
+    return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD
+                     ? VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT
+                     : VK_ACCESS_2_NONE),
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true};
+  case RGUsage::DepthAttachment:
+    return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true};
+  case RGUsage::DepthRead:
+    return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false};
+  case RGUsage::Sampled:
+    return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT,
+            false};
+  case RGUsage::StorageRead:
+    return {VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT, false};
+  case RGUsage::StorageWrite:
+    return {VK_IMAGE_LAYOUT_GENERAL,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT, true};
+  case RGUsage::TransferSrc:
+    return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false};
+  case RGUsage::TransferDst:
+    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            true};
+  }
+  throw std::runtime_error("unknown render graph usage!");
+}
+
+const VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+    VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+// Whether the pass depends on the previous contents of the image
+bool readsPrevious(const UsageInfo &info, RGUsage usage,
+                   VkAttachmentLoadOp loadOp) {
+  if (!info.write || usage == RGUsage::StorageWrite)
+    return true;
+  return loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+bool isDepthFormat(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_D16_UNORM:
+  case VK_FORMAT_X8_D24_UNORM_PACK32:
+  case VK_FORMAT_D32_SFLOAT:
+  case VK_FORMAT_D16_UNORM_S8_UINT:
+  case VK_FORMAT_D24_UNORM_S8_UINT:
+  case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+VkImageAspectFlags getAspect(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_D16_UNORM_S8_UINT:
+  case VK_FORMAT_D24_UNORM_S8_UINT:
+  case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  default:
+    return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                 : VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+void hashWord(uint64_t &hash, uint64_t word) {
+  hash ^= word;
+  hash *= 1099511628211ull;
+}
+
+} // namespace
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::use(RGResource resource, RGUsage usage,
+                              VkPipelineStageFlags2 stages,
+                              VkAttachmentLoadOp loadOp, VkClearValue clear) {
+  if (resource >= m_graph.m_resources.size()) {
+    throw std::runtime_error("invalid render graph resource!");
+  }
+  if (m_graph.m_resources[resource].buffer != VK_NULL_HANDLE &&
+      usage != RGUsage::StorageRead && usage != RGUsage::StorageWrite) {
+    throw std::runtime_error("render graph buffers only take storage usages!");
+  }
+  m_graph.m_passes[m_pass].uses.push_back(
+      {resource, usage, stages, loadOp, clear});
+  return *this;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::writeColor(RGResource resource,
+                                     VkAttachmentLoadOp loadOp,
+                                     VkClearColorValue clear) {
+  VkClearValue value{};
+  value.color = clear;
+  return use(resource, RGUsage::ColorAttachment,
+             VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, loadOp, value);
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::writeDepth(RGResource resource,
+                                     VkAttachmentLoadOp loadOp,
+                                     VkClearDepthStencilValue clear) {
+  VkClearValue value{};
+  value.depthStencil = clear;
+  return use(resource, RGUsage::DepthAttachment,
+             VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                 VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+             loadOp, value);
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::readDepth(RGResource resource) {
+  return use(resource, RGUsage::DepthRead,
+             VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                 VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+             VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::renderArea(VkExtent2D extent) {
+  m_graph.m_passes[m_pass].renderArea = extent;
+  return *this;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::sampled(RGResource resource,
+                                  VkPipelineStageFlags2 stages) {
+  return use(resource, RGUsage::Sampled, stages, VK_ATTACHMENT_LOAD_OP_LOAD,
+             {});
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::storageRead(RGResource resource,
+                                      VkPipelineStageFlags2 stages) {
+  return use(resource, RGUsage::StorageRead, stages,
+             VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::storageWrite(RGResource resource,
+                                       VkPipelineStageFlags2 stages) {
+  return use(resource, RGUsage::StorageWrite, stages,
+             VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::transferSrc(RGResource resource,
+                                      VkPipelineStageFlags2 stages) {
+  return use(resource, RGUsage::TransferSrc, stages,
+             VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::transferDst(RGResource resource,
+                                      VkPipelineStageFlags2 stages) {
+  return use(resource, RGUsage::TransferDst, stages,
+             VK_ATTACHMENT_LOAD_OP_DONT_CARE, {});
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffect() {
+  m_graph.m_passes[m_pass].sideEffect = true;
+  return *this;
+}
+
+size_t RenderGraph::FramebufferKeyHash::operator()(
+    const FramebufferKey &key) const {
+  uint64_t hash = 14695981039346656037ull;
+  hashWord(hash, reinterpret_cast<uint64_t>(key.renderPass));
+  for (VkImageView view : key.views) {
+    hashWord(hash, reinterpret_cast<uint64_t>(view));
+  }
+  hashWord(hash, (uint64_t(key.width) << 32) | key.height);
+  return static_cast<size_t>(hash);
+}
+
+void RenderGraph::init(VulkanContext *p_context,
+                       DeletionQueue *p_deletionQueue) {
+  mp_context = p_context;
+  mp_deletionQueue = p_deletionQueue;
+  m_dynamicRendering =
+      p_context->getEnabledVulkan13Features().dynamicRendering;
+}
+
+void RenderGraph::shutdown() {
+  VkDevice device = mp_context->getDevice();
+
+  destroyTransients(m_transients, false);
+
+  for (auto &[key, framebuffer] : m_framebuffers) {
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+  }
+  m_framebuffers.clear();
+
+  for (auto &[attachments, renderPass] : m_renderPasses) {
+    vkDestroyRenderPass(device, renderPass, nullptr);
+  }
+  m_renderPasses.clear();
+
+  m_resources.clear();
+  m_passes.clear();
+}
+
+void RenderGraph::reset() {
+  m_resources.clear();
+  m_passes.clear();
+  m_finalBarriers.clear();
+  m_stats = {};
+}
+
+RGResource RenderGraph::importImage(const std::string &name, VkImage image,
+                                    VkImageView view, VkFormat format,
+                                    VkExtent2D extent, VkImageLayout layout,
+                                    VkPipelineStageFlags2 stages,
+                                    uint32_t baseArrayLayer,
+                                    uint32_t layerCount) {
+  Resource resource;
+  resource.name = name;
+  resource.imported = true;
+  resource.desc = {format, extent};
+  resource.image = image;
+  resource.view = view;
+  resource.baseArrayLayer = baseArrayLayer;
+  resource.layerCount = layerCount;
+  resource.state.layout = layout;
+  resource.state.writeStages = stages;
+
+  m_resources.push_back(resource);
+  return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::createImage(const std::string &name,
+                                    const RGImageDesc &desc) {
+  Resource resource;
+  resource.name = name;
+  resource.desc = desc;
+
+  m_resources.push_back(resource);
+  return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::importBuffer(const std::string &name, VkBuffer buffer,
+                                     VkDeviceSize offset, VkDeviceSize size,
+                                     VkPipelineStageFlags2 stages) {
+  Resource resource;
+  resource.name = name;
+  resource.imported = true;
+  resource.buffer = buffer;
+  resource.offset = offset;
+  resource.size = size;
+  // Storage usages are GENERAL, so buffers never see a transition
+  resource.state.layout = VK_IMAGE_LAYOUT_GENERAL;
+  resource.state.writeStages = stages;
+  resource.state.writeAccess =
+      stages != VK_PIPELINE_STAGE_2_NONE ? VK_ACCESS_2_MEMORY_WRITE_BIT
+                                         : VK_ACCESS_2_NONE;
+
+  m_resources.push_back(resource);
+  return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::present(RGResource resource) {
+  if (!m_resources.at(resource).imported ||
+      m_resources[resource].buffer != VK_NULL_HANDLE) {
+    throw std::runtime_error("only imported images can be presented!");
+  }
+  m_resources[resource].presented = true;
+}
+
+RGPass RenderGraph::addPass(const std::string &name, RGPassType type,
+                            const SetupFn &setup, ExecuteFn execute) {
+  Pass pass;
+  pass.name = name;
+  pass.type = type;
+  pass.execute = std::move(execute);
+  m_passes.push_back(std::move(pass));
+
+  RGPass handle = static_cast<RGPass>(m_passes.size() - 1);
+  PassBuilder builder(*this, handle);
+  setup(builder);
+  return handle;
+}
+
+void RenderGraph::compile() {
+  cullPasses();
+  computeLifetimes();
+  allocateTransients();
+  buildBarriers();
+  buildRenderPasses();
+}
+
+void RenderGraph::cullPasses() {
+  // Walk backwards tracking which images still have a consumer. A pass
+  // survives if it writes one of them, and then its own inputs are needed.
+  // Imported images are visible outside the graph, so always consumed.
+  std::vector<bool> needed(m_resources.size());
+  for (size_t i = 0; i < m_resources.size(); i++) {
+    needed[i] = m_resources[i].imported;
+  }
+
+  for (size_t i = m_passes.size(); i-- > 0;) {
+    Pass &pass = m_passes[i];
+
+    bool alive = pass.sideEffect;
+    for (const ResourceUse &use : pass.uses) {
+      if (getUsageInfo(use.usage, use.loadOp).write && needed[use.resource])
+        alive = true;
+    }
+
+    pass.culled = !alive;
+    if (!alive) {
+      m_stats.culledPassCount++;
+      continue;
+    }
+    m_stats.passCount++;
+
+    for (const ResourceUse &use : pass.uses) {
+      UsageInfo info = getUsageInfo(use.usage, use.loadOp);
+      if (info.write && !m_resources[use.resource].imported)
+        needed[use.resource] = false;
+    }
+    for (const ResourceUse &use : pass.uses) {
+      UsageInfo info = getUsageInfo(use.usage, use.loadOp);
+      if (readsPrevious(info, use.usage, use.loadOp))
+        needed[use.resource] = true;
+    }
+  }
+}
+
+void RenderGraph::computeLifetimes() {
+  for (uint32_t i = 0; i < m_passes.size(); i++) {
+    if (m_passes[i].culled)
+      continue;
+
+    for (const ResourceUse &use : m_passes[i].uses) {
+      Resource &resource = m_resources[use.resource];
+      resource.firstPass = std::min(resource.firstPass, i);
+      resource.lastPass = std::max(resource.lastPass, i);
+      if (resource.buffer == VK_NULL_HANDLE)
+        resource.usage |= getUsageInfo(use.usage, use.loadOp).imageUsage;
+    }
+  }
+}
+
+void RenderGraph::allocateTransients() {
+  std::vector<RGResource> transients;
+  uint64_t signature = 14695981039346656037ull;
+  for (RGResource i = 0; i < m_resources.size(); i++) {
+    const Resource &resource = m_resources[i];
+    if (resource.imported || resource.firstPass == UINT32_MAX)
+      continue;
+
+    transients.push_back(i);
+    hashWord(signature, resource.desc.format);
+    hashWord(signature, (uint64_t(resource.desc.extent.width) << 32) |
+                            resource.desc.extent.height);
+    hashWord(signature, resource.usage);
+  }
+  // Images sharing memory only need disjoint lifetimes, so which pairs
+  // overlap is all a placement depends on. Passes coming and going around
+  // them, e.g. cached shadow cascades or the depth prepass, shift their pass
+  // indices but keep the images.
+  for (uint32_t a = 0; a < transients.size(); a++) {
+    const Resource &first = m_resources[transients[a]];
+    for (uint32_t b = a + 1; b < transients.size(); b++) {
+      const Resource &second = m_resources[transients[b]];
+      hashWord(signature, first.firstPass <= second.lastPass &&
+                              second.firstPass <= first.lastPass);
+    }
+  }
+
+  bool reuse = signature == m_transients.signature &&
+               transients.size() == m_transients.images.size();
+  if (!reuse) {
+    // Frames in flight may still use the old images
+    for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+      bool usesOld = false;
+      for (const TransientImage &image : m_transients.images) {
+        usesOld |= std::find(it->first.views.begin(), it->first.views.end(),
+                             image.view) != it->first.views.end();
+      }
+      if (usesOld) {
+        mp_deletionQueue->destroyFramebuffer(it->second);
+        it = m_framebuffers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    destroyTransients(m_transients, true);
+    m_transients.signature = signature;
+
+    VkDevice device = mp_context->getDevice();
+
+    // Greedy placement in first use order, each image goes into the
+    // smallest block whose previous user is done before it starts
+    std::vector<uint32_t> order(transients.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return m_resources[transients[a]].firstPass <
+             m_resources[transients[b]].firstPass;
+    });
+
+    m_transients.images.resize(transients.size());
+    std::vector<uint32_t> blockFreeAfter;
+    for (uint32_t index : order) {
+      const Resource &resource = m_resources[transients[index]];
+      TransientImage &transient = m_transients.images[index];
+      transient.desc = resource.desc;
+      transient.usage = resource.usage;
+
+      VkImageCreateInfo imageInfo{};
+      imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      imageInfo.imageType = VK_IMAGE_TYPE_2D;
+      imageInfo.extent = {resource.desc.extent.width,
+                          resource.desc.extent.height, 1};
+      imageInfo.mipLevels = 1;
+      imageInfo.arrayLayers = 1;
+      imageInfo.format = resource.desc.format;
+      imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+      imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      imageInfo.usage = resource.usage;
+      imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create transient image!");
+      }
+
+      VkMemoryRequirements requirements;
+      vkGetImageMemoryRequirements(device, transient.image, &requirements);
+      uint32_t memoryType =
+          findMemoryType(mp_context->getPhysicalDevice(),
+                         requirements.memoryTypeBits,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      m_transients.unaliasedSize += requirements.size;
+
+      uint32_t block = UINT32_MAX;
+      for (uint32_t b = 0; b < m_transients.blocks.size(); b++) {
+        const MemoryBlock &candidate = m_transients.blocks[b];
+        if (blockFreeAfter[b] >= resource.firstPass ||
+            candidate.memoryType != memoryType ||
+            candidate.size < requirements.size)
+          continue;
+        if (block == UINT32_MAX ||
+            candidate.size < m_transients.blocks[block].size)
+          block = b;
+      }
+
+      if (block == UINT32_MAX) {
+        MemoryBlock newBlock{};
+        newBlock.size = requirements.size;
+        newBlock.memoryType = memoryType;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &newBlock.memory) !=
+            VK_SUCCESS) {
+          throw std::runtime_error("failed to allocate transient memory!");
+        }
+
+        m_transients.blocks.push_back(newBlock);
+        blockFreeAfter.push_back(0);
+        block = static_cast<uint32_t>(m_transients.blocks.size() - 1);
+      }
+
+      vkBindImageMemory(device, transient.image,
+                        m_transients.blocks[block].memory, 0);
+      blockFreeAfter[block] = resource.lastPass;
+      transient.block = block;
+      transient.view =
+          createImageView(mp_context, transient.image, resource.desc.format,
+                          getAspect(resource.desc.format), 1);
+    }
+  }
+
+  for (uint32_t i = 0; i < transients.size(); i++) {
+    Resource &resource = m_resources[transients[i]];
+    const TransientImage &transient = m_transients.images[i];
+    resource.image = transient.image;
+    resource.view = transient.view;
+    resource.transient = i;
+    // Contents never survive, what it waits on is only known once the
+    // barriers reach its first use, see buildBarriers()
+    resource.state = {};
+  }
+
+  for (const MemoryBlock &block : m_transients.blocks) {
+    m_stats.transientBytes += block.size;
+  }
+  m_stats.unaliasedBytes = m_transients.unaliasedSize;
+}
+
+bool RenderGraph::updateState(ResourceState &state, VkImageLayout layout,
+                              VkPipelineStageFlags2 stages,
+                              VkAccessFlags2 access, bool write,
+                              VkPipelineStageFlags2 &srcStages,
+                              VkAccessFlags2 &srcAccess) {
+  bool transition = state.layout != layout;
+
+  srcStages = VK_PIPELINE_STAGE_2_NONE;
+  srcAccess = VK_ACCESS_2_NONE;
+  if (transition || write) {
+    // Wait for the last write and every read since
+    srcStages = state.writeStages | state.readStages;
+    srcAccess = state.writeAccess;
+  } else if ((stages & ~state.readStages) != 0) {
+    // Read after read in the same layout needs nothing, only stages that
+    // have not seen the last write yet
+    srcStages = state.writeStages;
+    srcAccess = state.writeAccess;
+  }
+
+  if (write) {
+    state = {layout, stages, access & WRITE_ACCESS_MASK,
+             VK_PIPELINE_STAGE_2_NONE};
+  } else if (transition) {
+    // Later reads in other stages have to wait for the transition
+    state = {layout, stages, VK_ACCESS_2_NONE, stages};
+  } else {
+    state.readStages |= stages;
+  }
+
+  return transition || srcStages != VK_PIPELINE_STAGE_2_NONE;
+}
+
+void RenderGraph::addBarrier(std::vector<VkImageMemoryBarrier2> &barriers,
+                             Resource &resource, VkImageLayout layout,
+                             VkPipelineStageFlags2 stages,
+                             VkAccessFlags2 access, bool write) {
+  VkImageLayout oldLayout = resource.state.layout;
+  VkPipelineStageFlags2 srcStages;
+  VkAccessFlags2 srcAccess;
+  if (!updateState(resource.state, layout, stages, access, write, srcStages,
+                   srcAccess))
+    return;
+
+  VkImageMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = stages;
+  barrier.dstAccessMask = access;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = resource.image;
+  barrier.subresourceRange.aspectMask = getAspect(resource.desc.format);
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  barrier.subresourceRange.baseArrayLayer = resource.baseArrayLayer;
+  barrier.subresourceRange.layerCount = resource.layerCount;
+  barriers.push_back(barrier);
+  m_stats.barrierCount++;
+}
+
+void RenderGraph::addBufferBarrier(
+    std::vector<VkBufferMemoryBarrier2> &barriers, Resource &resource,
+    VkPipelineStageFlags2 stages, VkAccessFlags2 access, bool write) {
+  VkPipelineStageFlags2 srcStages;
+  VkAccessFlags2 srcAccess;
+  if (!updateState(resource.state, VK_IMAGE_LAYOUT_GENERAL, stages, access,
+                   write, srcStages, srcAccess))
+    return;
+
+  VkBufferMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = stages;
+  barrier.dstAccessMask = access;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = resource.buffer;
+  barrier.offset = resource.offset;
+  barrier.size = resource.size;
+  barriers.push_back(barrier);
+  m_stats.barrierCount++;
+}
+
+void RenderGraph::buildBarriers() {
+  for (Pass &pass : m_passes) {
+    if (pass.culled)
+      continue;
+
+    for (const ResourceUse &use : pass.uses) {
+      Resource &resource = m_resources[use.resource];
+      UsageInfo info = getUsageInfo(use.usage, use.loadOp);
+      if (resource.buffer != VK_NULL_HANDLE) {
+        addBufferBarrier(pass.bufferBarriers, resource, use.stages,
+                         info.access, info.write);
+        continue;
+      }
+      if (resource.transient == UINT32_MAX) {
+        addBarrier(pass.barriers, resource, info.layout, use.stages,
+                   info.access, info.write);
+        continue;
+      }
+
+      // The memory may still be in use by whoever had it last, an earlier
+      // alias in this frame or the last one of an earlier frame. Every use
+      // leaves a layout other than UNDEFINED, so this is the first.
+      MemoryBlock &block =
+          m_transients.blocks[m_transients.images[resource.transient].block];
+      if (resource.state.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+        resource.state.writeStages = block.lastStages;
+        resource.state.writeAccess = block.lastAccess;
+        resource.state.readStages = VK_PIPELINE_STAGE_2_NONE;
+      }
+      addBarrier(pass.barriers, resource, info.layout, use.stages,
+                 info.access, info.write);
+      block.lastStages =
+          resource.state.writeStages | resource.state.readStages;
+      block.lastAccess = resource.state.writeAccess;
+    }
+  }
+
+  for (Resource &resource : m_resources) {
+    if (!resource.presented)
+      continue;
+
+    // The present engine waits on the submit semaphore, nothing to wait
+    // for on the destination side
+    addBarrier(m_finalBarriers, resource, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+               VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, false);
+  }
+}
+
+void RenderGraph::buildRenderPasses() {
+  for (uint32_t i = 0; i < m_passes.size(); i++) {
+    Pass &pass = m_passes[i];
+    if (pass.culled || pass.type != RGPassType::Raster)
+      continue;
+
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkClearValue> clearValues;
+    std::vector<VkRenderingAttachmentInfo> renderingAttachments;
+    FramebufferKey key{};
+    const ResourceUse *p_depth = nullptr;
+
+    auto addAttachment = [&](const ResourceUse &use) {
+      const Resource &resource = m_resources[use.resource];
+      UsageInfo info = getUsageInfo(use.usage, use.loadOp);
+
+      VkAttachmentDescription attachment{};
+      attachment.format = resource.desc.format;
+      attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+      attachment.loadOp = use.loadOp;
+      if (!info.write)
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+      else if (resource.imported || resource.lastPass > i)
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+      else
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      // The graph's barriers do the transitions
+      attachment.initialLayout = info.layout;
+      attachment.finalLayout = info.layout;
+      attachments.push_back(attachment);
+      clearValues.push_back(use.clear);
+
+      VkRenderingAttachmentInfo renderingAttachment{};
+      renderingAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+      renderingAttachment.imageView = resource.view;
+      renderingAttachment.imageLayout = info.layout;
+      renderingAttachment.loadOp = attachment.loadOp;
+      renderingAttachment.storeOp = attachment.storeOp;
+      renderingAttachment.clearValue = use.clear;
+      renderingAttachments.push_back(renderingAttachment);
+
+      if (key.views.empty()) {
+        pass.extent = resource.desc.extent;
+      } else if (pass.extent.width != resource.desc.extent.width ||
+                 pass.extent.height != resource.desc.extent.height) {
+        throw std::runtime_error("render graph attachments of pass " +
+                                 pass.name + " differ in size!");
+      }
+      key.views.push_back(resource.view);
+    };
+
+    for (const ResourceUse &use : pass.uses) {
+      if (use.usage == RGUsage::ColorAttachment)
+        addAttachment(use);
+      else if (use.usage == RGUsage::DepthAttachment ||
+               use.usage == RGUsage::DepthRead)
+        p_depth = &use;
+    }
+    uint32_t colorCount = static_cast<uint32_t>(attachments.size());
+    if (p_depth)
+      addAttachment(*p_depth);
+
+    if (attachments.empty()) {
+      throw std::runtime_error("render graph raster pass " + pass.name +
+                               " has no attachments!");
+    }
+    if (pass.renderArea.width == 0 || pass.renderArea.height == 0) {
+      pass.renderArea = pass.extent;
+    } else {
+      pass.renderArea.width = std::min(pass.renderArea.width,
+                                       pass.extent.width);
+      pass.renderArea.height = std::min(pass.renderArea.height,
+                                        pass.extent.height);
+    }
+
+    if (m_dynamicRendering) {
+      pass.colorAttachments.assign(renderingAttachments.begin(),
+                                   renderingAttachments.begin() + colorCount);
+      pass.hasDepth = p_depth != nullptr;
+      if (pass.hasDepth) {
+        pass.depthAttachment = renderingAttachments.back();
+        pass.hasStencil =
+            getAspect(attachments.back().format) & VK_IMAGE_ASPECT_STENCIL_BIT;
+      }
+      continue;
+    }
+
+    pass.renderPass = getRenderPass(attachments, colorCount, p_depth);
+    pass.clearValues = std::move(clearValues);
+
+    key.renderPass = pass.renderPass;
+    key.width = pass.extent.width;
+    key.height = pass.extent.height;
+    pass.framebuffer = getFramebuffer(key);
+  }
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+  auto emitBarriers =
+      [&](const std::vector<VkImageMemoryBarrier2> &barriers,
+          const std::vector<VkBufferMemoryBarrier2> &bufferBarriers) {
+        if (barriers.empty() && bufferBarriers.empty())
+          return;
+
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependencyInfo.imageMemoryBarrierCount =
+            static_cast<uint32_t>(barriers.size());
+        dependencyInfo.pImageMemoryBarriers = barriers.data();
+        dependencyInfo.bufferMemoryBarrierCount =
+            static_cast<uint32_t>(bufferBarriers.size());
+        dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+      };
+
+  for (Pass &pass : m_passes) {
+    if (pass.culled)
+      continue;
+
+    emitBarriers(pass.barriers, pass.bufferBarriers);
+
+    if (pass.type == RGPassType::Raster && m_dynamicRendering) {
+      VkRenderingInfo renderingInfo{};
+      renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+      renderingInfo.renderArea.offset = {0, 0};
+      renderingInfo.renderArea.extent = pass.renderArea;
+      renderingInfo.layerCount = 1;
+      renderingInfo.colorAttachmentCount =
+          static_cast<uint32_t>(pass.colorAttachments.size());
+      renderingInfo.pColorAttachments = pass.colorAttachments.data();
+      renderingInfo.pDepthAttachment =
+          pass.hasDepth ? &pass.depthAttachment : nullptr;
+      renderingInfo.pStencilAttachment =
+          pass.hasStencil ? &pass.depthAttachment : nullptr;
+
+      vkCmdBeginRendering(commandBuffer, &renderingInfo);
+      pass.execute(commandBuffer);
+      vkCmdEndRendering(commandBuffer);
+    } else if (pass.type == RGPassType::Raster) {
+      VkRenderPassBeginInfo renderPassInfo{};
+      renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+      renderPassInfo.renderPass = pass.renderPass;
+      renderPassInfo.framebuffer = pass.framebuffer;
+      renderPassInfo.renderArea.offset = {0, 0};
+      renderPassInfo.renderArea.extent = pass.renderArea;
+      renderPassInfo.clearValueCount =
+          static_cast<uint32_t>(pass.clearValues.size());
+      renderPassInfo.pClearValues = pass.clearValues.data();
+
+      vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                           VK_SUBPASS_CONTENTS_INLINE);
+      pass.execute(commandBuffer);
+      vkCmdEndRenderPass(commandBuffer);
+    } else {
+      pass.execute(commandBuffer);
+    }
+  }
+
+  emitBarriers(m_finalBarriers, {});
+}
+
+VkRenderPass
+RenderGraph::getCompatibleRenderPass(const std::vector<VkFormat> &colorFormats,
+                                     VkFormat depthFormat) {
+  if (m_dynamicRendering)
+    return VK_NULL_HANDLE;
+
+  std::vector<VkAttachmentDescription> attachments;
+  for (VkFormat format : colorFormats) {
+    VkAttachmentDescription attachment{};
+    attachment.format = format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachments.push_back(attachment);
+  }
+
+  bool hasDepth = depthFormat != VK_FORMAT_UNDEFINED;
+  if (hasDepth) {
+    VkAttachmentDescription attachment{};
+    attachment.format = depthFormat;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachments.push_back(attachment);
+  }
+
+  return getRenderPass(attachments,
+                       static_cast<uint32_t>(colorFormats.size()), hasDepth);
+}
+
+VkRenderPass RenderGraph::getRenderPass(
+    const std::vector<VkAttachmentDescription> &attachments,
+    uint32_t colorCount, bool hasDepth) {
+  for (const auto &[cached, renderPass] : m_renderPasses) {
+    if (cached.size() == attachments.size() &&
+        std::memcmp(cached.data(), attachments.data(),
+                    attachments.size() * sizeof(VkAttachmentDescription)) ==
+            0)
+      return renderPass;
+  }
+
+  std::vector<VkAttachmentReference> colorRefs(colorCount);
+  for (uint32_t i = 0; i < colorCount; i++) {
+    colorRefs[i] = {i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  }
+  VkAttachmentReference depthRef{};
+  if (hasDepth) {
+    depthRef = {colorCount, attachments.back().initialLayout};
+  }
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = colorCount;
+  subpass.pColorAttachments = colorRefs.data();
+  subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+
+  VkRenderPass renderPass;
+  if (vkCreateRenderPass(mp_context->getDevice(), &renderPassInfo, nullptr,
+                         &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render pass!");
+  }
+
+  m_renderPasses.emplace_back(attachments, renderPass);
+  return renderPass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(const FramebufferKey &key) {
+  auto it = m_framebuffers.find(key);
+  if (it != m_framebuffers.end())
+    return it->second;
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = key.renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(key.views.size());
+  framebufferInfo.pAttachments = key.views.data();
+  framebufferInfo.width = key.width;
+  framebufferInfo.height = key.height;
+  framebufferInfo.layers = 1;
+
+  VkFramebuffer framebuffer;
+  if (vkCreateFramebuffer(mp_context->getDevice(), &framebufferInfo, nullptr,
+                          &framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create framebuffer!");
+  }
+
+  m_framebuffers.emplace(key, framebuffer);
+  return framebuffer;
+}
+
+VkImage RenderGraph::getImage(RGResource resource) const {
+  return m_resources.at(resource).image;
+}
+
+VkImageView RenderGraph::getImageView(RGResource resource) const {
+  return m_resources.at(resource).view;
+}
+
+VkExtent2D RenderGraph::getExtent(RGResource resource) const {
+  return m_resources.at(resource).desc.extent;
+}
+
+const std::vector<VkImageMemoryBarrier2> &
+RenderGraph::getBarriers(RGPass pass) const {
+  return m_passes.at(pass).barriers;
+}
+
+void RenderGraph::invalidateFramebuffers() {
+  for (auto &[key, framebuffer] : m_framebuffers) {
+    mp_deletionQueue->destroyFramebuffer(framebuffer);
+  }
+  m_framebuffers.clear();
+}
+
+void RenderGraph::destroyTransients(TransientSet &transients, bool deferred) {
+  VkDevice device = mp_context->getDevice();
+  for (TransientImage &image : transients.images) {
+    if (deferred) {
+      mp_deletionQueue->destroyImageView(image.view);
+      mp_deletionQueue->destroyImage(image.image);
+    } else {
+      vkDestroyImageView(device, image.view, nullptr);
+      vkDestroyImage(device, image.image, nullptr);
+    }
+  }
+  for (MemoryBlock &block : transients.blocks) {
+    if (deferred)
+      mp_deletionQueue->freeMemory(block.memory);
+    else
+      vkFreeMemory(device, block.memory, nullptr);
+  }
+  transients = {};
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "VulkanSyncObjects/DeletionQueue.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using RGResource = uint32_t;
+using RGPass = uint32_t;
+
+struct RGImageDesc {
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  VkExtent2D extent{};
+};
+
+enum class RGPassType { Raster, Compute, Transfer };
+
+// How a pass touches an image, decides layout, stages and access. Buffers
+// only take the storage usages.
+enum class RGUsage {
+  ColorAttachment,
+  DepthAttachment,
+  DepthRead,
+  Sampled,
+  StorageRead,
+  StorageWrite,
+  TransferSrc,
+  TransferDst,
+};
+
+// Frame graph rebuilt every frame. Passes declare the images and buffers
+// they read and write, compile() then:
+//  - culls passes whose results nobody consumes
+//  - places transient images in memory shared by images whose lifetimes do
+//    not overlap
+//  - derives the barriers between passes (vkCmdPipelineBarrier2), skipping
+//    read after read in the same layout
+// Transient images and their memory are kept across frames for as long as
+// the graph keeps the same shape. Raster passes use dynamic rendering when
+// the device has it, render pass and framebuffer objects otherwise.
+class RenderGraph {
+public:
+  class PassBuilder {
+  public:
+    // Attachments, raster passes only. Order of writeColor calls is the
+    // attachment order.
+    PassBuilder &writeColor(RGResource resource, VkAttachmentLoadOp loadOp,
+                            VkClearColorValue clear = {});
+    PassBuilder &writeDepth(RGResource resource, VkAttachmentLoadOp loadOp,
+                            VkClearDepthStencilValue clear = {1.0f, 0});
+    PassBuilder &readDepth(RGResource resource);
+    // Rendering is limited to the top left `extent` of the attachments,
+    // what lies outside is left untouched
+    PassBuilder &renderArea(VkExtent2D extent);
+
+    PassBuilder &sampled(
+        RGResource resource,
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+    PassBuilder &storageRead(
+        RGResource resource,
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    PassBuilder &storageWrite(
+        RGResource resource,
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+    // Copies and blits. The destination is overwritten as a whole, its
+    // previous contents are dropped.
+    PassBuilder &transferSrc(
+        RGResource resource,
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    PassBuilder &transferDst(
+        RGResource resource,
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+    // Never culled, for passes with effects outside the graph
+    PassBuilder &sideEffect();
+
+  private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph &graph, RGPass pass)
+        : m_graph(graph), m_pass(pass) {}
+    PassBuilder &use(RGResource resource, RGUsage usage,
+                     VkPipelineStageFlags2 stages, VkAttachmentLoadOp loadOp,
+                     VkClearValue clear);
+
+    RenderGraph &m_graph;
+    RGPass m_pass;
+  };
+
+  using SetupFn = std::function<void(PassBuilder &)>;
+  using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+  struct Stats {
+    uint32_t passCount = 0;
+    uint32_t culledPassCount = 0;
+    uint32_t barrierCount = 0;
+    // Memory backing transient images, and what it would be without
+    // aliasing
+    VkDeviceSize transientBytes = 0;
+    VkDeviceSize unaliasedBytes = 0;
+  };
+
+  void init(VulkanContext *p_context, DeletionQueue *p_deletionQueue);
+  void shutdown();
+
+  // Starts a new frame, previous resource and pass handles become invalid
+  void reset();
+
+  // `layout` and `stages` describe the image as the graph receives it, e.g.
+  // UNDEFINED after the acquire semaphore wait at color attachment output.
+  // Layers of one image imported separately are tracked separately, `view`
+  // has to cover exactly those layers.
+  RGResource importImage(
+      const std::string &name, VkImage image, VkImageView view,
+      VkFormat format, VkExtent2D extent, VkImageLayout layout,
+      VkPipelineStageFlags2 stages, uint32_t baseArrayLayer = 0,
+      uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS);
+  RGResource createImage(const std::string &name, const RGImageDesc &desc);
+  // A range of a buffer owned outside the graph, `stages` being its last
+  // use before the graph, VK_PIPELINE_STAGE_2_NONE when it is fresh
+  RGResource importBuffer(
+      const std::string &name, VkBuffer buffer, VkDeviceSize offset,
+      VkDeviceSize size,
+      VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE);
+
+  // Transitions to PRESENT_SRC_KHR after the last pass and keeps its
+  // producers alive
+  void present(RGResource resource);
+
+  RGPass addPass(const std::string &name, RGPassType type,
+                 const SetupFn &setup, ExecuteFn execute);
+
+  void compile();
+  void execute(VkCommandBuffer commandBuffer);
+
+  // Pipelines built against it can be used in every raster pass with the
+  // same attachment formats. VK_NULL_HANDLE with dynamic rendering,
+  // pipelines take the formats directly then.
+  VkRenderPass getCompatibleRenderPass(const std::vector<VkFormat> &colorFormats,
+                                       VkFormat depthFormat);
+
+  // Valid after compile()
+  VkImage getImage(RGResource resource) const;
+  VkImageView getImageView(RGResource resource) const;
+  VkExtent2D getExtent(RGResource resource) const;
+  // Image barriers recorded before the pass
+  const std::vector<VkImageMemoryBarrier2> &getBarriers(RGPass pass) const;
+
+  // Framebuffers referencing imported views are dropped once the frames in
+  // flight are done with them, call when the swapchain is recreated
+  void invalidateFramebuffers();
+
+  bool usesDynamicRendering() const { return m_dynamicRendering; }
+
+  const Stats &getStats() const { return m_stats; }
+
+private:
+  struct ResourceUse {
+    RGResource resource;
+    RGUsage usage;
+    VkPipelineStageFlags2 stages;
+    VkAttachmentLoadOp loadOp;
+    VkClearValue clear;
+  };
+
+  struct Pass {
+    std::string name;
+    RGPassType type;
+    ExecuteFn execute;
+    std::vector<ResourceUse> uses;
+    bool sideEffect = false;
+    bool culled = false;
+
+    // Compiled
+    std::vector<VkImageMemoryBarrier2> barriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    VkExtent2D extent{};
+    // Zero for the whole extent
+    VkExtent2D renderArea{};
+    // Render pass objects
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    std::vector<VkClearValue> clearValues;
+    // Dynamic rendering
+    std::vector<VkRenderingAttachmentInfo> colorAttachments;
+    VkRenderingAttachmentInfo depthAttachment{};
+    bool hasDepth = false;
+    bool hasStencil = false;
+  };
+
+  // Layout, stages and access the image was last left in
+  struct ResourceState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Last write or layout transition
+    VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    // Stages already synchronized with that write
+    VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+  };
+
+  struct Resource {
+    std::string name;
+    bool imported = false;
+    bool presented = false;
+    RGImageDesc desc;
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkImageUsageFlags usage = 0;
+    uint32_t baseArrayLayer = 0;
+    uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS;
+    // Buffer resources have no image
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    ResourceState state;
+
+    // Alive passes using it, UINT32_MAX when unused
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+    // Into m_transients.images
+    uint32_t transient = UINT32_MAX;
+  };
+
+  struct TransientImage {
+    RGImageDesc desc;
+    VkImageUsageFlags usage;
+    VkImage image;
+    VkImageView view;
+    uint32_t block;
+  };
+
+  // Memory shared by transient images with disjoint lifetimes, remembers
+  // how its last user left it so the next one can wait on that
+  struct MemoryBlock {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memoryType;
+    VkPipelineStageFlags2 lastStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 lastAccess = VK_ACCESS_2_NONE;
+  };
+
+  struct TransientSet {
+    uint64_t signature = 0;
+    std::vector<TransientImage> images;
+    std::vector<MemoryBlock> blocks;
+    // Sum of the image requirements, for the stats
+    VkDeviceSize unaliasedSize = 0;
+  };
+
+  struct FramebufferKey {
+    VkRenderPass renderPass;
+    std::vector<VkImageView> views;
+    uint32_t width;
+    uint32_t height;
+    bool operator==(const FramebufferKey &other) const = default;
+  };
+  struct FramebufferKeyHash {
+    size_t operator()(const FramebufferKey &key) const;
+  };
+
+  void cullPasses();
+  void computeLifetimes();
+  void allocateTransients();
+  void buildBarriers();
+  void buildRenderPasses();
+
+  void addBarrier(std::vector<VkImageMemoryBarrier2> &barriers,
+                  Resource &resource, VkImageLayout layout,
+                  VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                  bool write);
+  void addBufferBarrier(std::vector<VkBufferMemoryBarrier2> &barriers,
+                        Resource &resource, VkPipelineStageFlags2 stages,
+                        VkAccessFlags2 access, bool write);
+  // What has to be waited on before the use, and the state after it.
+  // Returns whether a barrier is needed.
+  bool updateState(ResourceState &state, VkImageLayout layout,
+                   VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                   bool write, VkPipelineStageFlags2 &srcStages,
+                   VkAccessFlags2 &srcAccess);
+
+  VkRenderPass getRenderPass(const std::vector<VkAttachmentDescription> &attachments,
+                             uint32_t colorCount, bool hasDepth);
+  VkFramebuffer getFramebuffer(const FramebufferKey &key);
+
+  // Immediately or through the deletion queue
+  void destroyTransients(TransientSet &transients, bool deferred);
+
+private:
+  VulkanContext *mp_context;
+  DeletionQueue *mp_deletionQueue;
+  bool m_dynamicRendering = false;
+
+  std::vector<Resource> m_resources;
+  std::vector<Pass> m_passes;
+  std::vector<VkImageMemoryBarrier2> m_finalBarriers;
+  Stats m_stats;
+
+  TransientSet m_transients;
+
+  // Keyed by the attachment descriptions, see getRenderPass
+  std::vector<std::pair<std::vector<VkAttachmentDescription>, VkRenderPass>>
+      m_renderPasses;
+  std::unordered_map<FramebufferKey, VkFramebuffer, FramebufferKeyHash>
+      m_framebuffers;
+};
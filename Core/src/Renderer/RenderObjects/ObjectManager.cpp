@@ -6,9 +6,11 @@
 #include <print>
 
 void ObjManager::init(VulkanContext *p_context,
-                      BufferManager *p_bufferManager) {
+                      BufferManager *p_bufferManager,
+                      DeletionQueue *p_deletionQueue) {
   mp_bufferManager = p_bufferManager;
   mp_context = p_context;
+  mp_deletionQueue = p_deletionQueue;
 }
 void ObjManager::shutdown() { destroyBuffers(); }
 
@@ -22,6 +24,16 @@ uint32_t ObjManager::addRenderObject(const RenderObject &obj) {
   objInfo.vertexCount = obj.getVertices().size();
   objInfo.vertexOffset = m_allVertices.size();
   objInfo.vertexOffsetValue = objInfo.vertexOffset;
+  objInfo.boundsMin = glm::vec3(0.0f);
+  objInfo.boundsMax = glm::vec3(0.0f);
+  if (!obj.getVertices().empty()) {
+    objInfo.boundsMin = obj.getVertices()[0].pos;
+    objInfo.boundsMax = obj.getVertices()[0].pos;
+  }
+  for (const Vertex &vertex : obj.getVertices()) {
+    objInfo.boundsMin = glm::min(objInfo.boundsMin, vertex.pos);
+    objInfo.boundsMax = glm::max(objInfo.boundsMax, vertex.pos);
+  }
 
   m_objInfos.push_back(objInfo);
 
@@ -39,54 +51,50 @@ uint32_t ObjManager::addRenderObject(const RenderObject &obj) {
 void ObjManager::createVertexBuffer() {
   std::println("Creating vertex Buffer");
   VkDeviceSize bufferSize = sizeof(m_allVertices[0]) * m_allVertices.size();
+  uploadBuffer(m_allVertices.data(), bufferSize,
+               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer,
+               m_vertexBufferMemory);
+}
+void ObjManager::createPositionBuffer() {
+  std::println("Creating position Buffer");
+  std::vector<glm::vec3> positions;
+  positions.reserve(m_allVertices.size());
+  for (const Vertex &vertex : m_allVertices) {
+    positions.push_back(vertex.pos);
+  }
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  mp_bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                 stagingBuffer, stagingBufferMemory);
-
-  void *data;
-  vkMapMemory(mp_context->getDevice(), stagingBufferMemory, 0, bufferSize, 0,
-              &data);
-  memcpy(data, m_allVertices.data(), (size_t)bufferSize);
-  vkUnmapMemory(mp_context->getDevice(), stagingBufferMemory);
-
-  mp_bufferManager->createBuffer(bufferSize,
-                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                 m_vertexBuffer, m_vertexBufferMemory);
-
-  mp_bufferManager->copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
-
-  vkDestroyBuffer(mp_context->getDevice(), stagingBuffer, nullptr);
-  vkFreeMemory(mp_context->getDevice(), stagingBufferMemory, nullptr);
+  VkDeviceSize bufferSize = sizeof(positions[0]) * positions.size();
+  uploadBuffer(positions.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+               m_positionBuffer, m_positionBufferMemory);
 }
 void ObjManager::createIndexBuffer() {
   std::println("Creating index Buffer");
   VkDeviceSize bufferSize = sizeof(m_allIndices[0]) * m_allIndices.size();
+  uploadBuffer(m_allIndices.data(), bufferSize,
+               VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indexBuffer,
+               m_indexBufferMemory);
+}
 
+void ObjManager::uploadBuffer(const void *p_data, VkDeviceSize size,
+                              VkBufferUsageFlags usage, VkBuffer &buffer,
+                              VkDeviceMemory &memory) {
   VkBuffer stagingBuffer;
   VkDeviceMemory stagingBufferMemory;
-  mp_bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+  mp_bufferManager->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                                  stagingBuffer, stagingBufferMemory);
 
   void *data;
-  vkMapMemory(mp_context->getDevice(), stagingBufferMemory, 0, bufferSize, 0,
-              &data);
-  memcpy(data, m_allIndices.data(), (size_t)bufferSize);
+  vkMapMemory(mp_context->getDevice(), stagingBufferMemory, 0, size, 0, &data);
+  memcpy(data, p_data, (size_t)size);
   vkUnmapMemory(mp_context->getDevice(), stagingBufferMemory);
 
-  mp_bufferManager->createBuffer(
-      bufferSize,
-      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexBufferMemory);
+  mp_bufferManager->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer,
+                                 memory);
 
-  mp_bufferManager->copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
+  mp_bufferManager->copyBuffer(stagingBuffer, buffer, size);
 
   vkDestroyBuffer(mp_context->getDevice(), stagingBuffer, nullptr);
   vkFreeMemory(mp_context->getDevice(), stagingBufferMemory, nullptr);
@@ -106,16 +114,32 @@ void ObjManager::destroyBuffers() {
   if (m_vertexBufferMemory != VK_NULL_HANDLE) {
     vkFreeMemory(mp_context->getDevice(), m_vertexBufferMemory, nullptr);
   }
+
+  if (m_positionBuffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(mp_context->getDevice(), m_positionBuffer, nullptr);
+  }
+  if (m_positionBufferMemory != VK_NULL_HANDLE) {
+    vkFreeMemory(mp_context->getDevice(), m_positionBufferMemory, nullptr);
+  }
 }
 
 void ObjManager::rebuildBuffers() {
   if (!m_needsRebuild)
     return;
 
-  destroyBuffers();
+  mp_deletionQueue->destroyBuffer(m_vertexBuffer, m_vertexBufferMemory);
+  mp_deletionQueue->destroyBuffer(m_positionBuffer, m_positionBufferMemory);
+  mp_deletionQueue->destroyBuffer(m_indexBuffer, m_indexBufferMemory);
+  m_vertexBuffer = VK_NULL_HANDLE;
+  m_vertexBufferMemory = VK_NULL_HANDLE;
+  m_positionBuffer = VK_NULL_HANDLE;
+  m_positionBufferMemory = VK_NULL_HANDLE;
+  m_indexBuffer = VK_NULL_HANDLE;
+  m_indexBufferMemory = VK_NULL_HANDLE;
 
   if (!m_allVertices.empty()) {
     createVertexBuffer();
+    createPositionBuffer();
   }
   if (!m_allIndices.empty()) {
     createIndexBuffer();
@@ -3,6 +3,7 @@
 #include "BufferManager/BufferManager.h"
 #include "RenderObjects/RenderObject.h"
 #include "Swapchain/Swapchain.h"
+#include "VulkanSyncObjects/DeletionQueue.h"
 #include "vulkan/vulkan_core.h"
 #include <stdexcept>
 #include <vector>
@@ -13,11 +14,15 @@ struct ObjBufferInfo {
   uint32_t indexOffset;
   uint32_t indexCount;
   int32_t vertexOffsetValue;
+  // Object space bounds of the vertices
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
 };
 
 class ObjManager {
 public:
-  void init(VulkanContext *p_context, BufferManager *p_bufferManager);
+  void init(VulkanContext *p_context, BufferManager *p_bufferManager,
+            DeletionQueue *p_deletionQueue);
   void shutdown();
 
   uint32_t addRenderObject(const RenderObject &obj);
@@ -39,16 +44,32 @@ public:
       rebuildBuffers();
     return m_indexBuffer;
   }
+  // Positions of m_allVertices only, same vertex offsets as the vertex
+  // buffer, for depth only passes
+  inline VkBuffer getPositionBuffer() {
+    if (m_needsRebuild)
+      rebuildBuffers();
+    return m_positionBuffer;
+  }
 
 private:
   void createVertexBuffer();
+  void createPositionBuffer();
   void createIndexBuffer();
+  // Device local buffer filled through a staging buffer
+  void uploadBuffer(const void *p_data, VkDeviceSize size,
+                    VkBufferUsageFlags usage, VkBuffer &buffer,
+                    VkDeviceMemory &memory);
   void destroyBuffers();
+  // Frames in flight may still read the old buffers, they are handed to
+  // the deletion queue
   void rebuildBuffers();
 
 private:
   VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
   VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
+  VkBuffer m_positionBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_positionBufferMemory = VK_NULL_HANDLE;
   VkBuffer m_indexBuffer = VK_NULL_HANDLE;
   VkDeviceMemory m_indexBufferMemory = VK_NULL_HANDLE;
 
@@ -63,4 +84,5 @@ private:
 
   VulkanContext *mp_context;
   BufferManager *mp_bufferManager;
+  DeletionQueue *mp_deletionQueue;
 };
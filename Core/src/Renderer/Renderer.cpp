@@ -1,5 +1,5 @@
 #include "Renderer.h"
-#include "BufferManager/UniformBufferManager.h"
+#include "Common/DrawConstants.h"
 #include "Common/UniformBufferObject.h"
 #include "Core/Application.h"
 #include <GLFW/glfw3.h>
@@ -19,17 +19,30 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstdlib>
+#include <print>
 #include <cstring>
 #include <stdexcept>
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Per-frame resources are sized for MAX_FRAMES_IN_FLIGHT, this many are
+// used until SetFramesInFlight says otherwise
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+// Relative to the working directory, like the shader paths
+const char *PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// Per-frame constants for every subsystem, bump allocated each frame
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 1024 * 1024;
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
+const bool enableShaderHotReload = false;
 #else
 const bool enableValidationLayers = true;
+const bool enableShaderHotReload = true;
 #endif
 
 // Define static member
@@ -37,15 +50,32 @@ RendererData Renderer::s_Data = {};
 
 void Renderer::OnFrameBufferResize() { s_Data.framebufferResized = true; }
 
+void Renderer::SetFramesInFlight(uint32_t count) {
+  s_Data.requestedFramesInFlight =
+      std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT);
+}
+
+uint32_t Renderer::GetFramesInFlight() {
+  return s_Data.syncManager.getFramesInFlight();
+}
+
 void Renderer::Init(const std::string &vertShaderPath,
-                    const std::string &fragShaderPath) {
+                    const std::string &fragShaderPath,
+                    const std::string &clusterShaderPath,
+                    const std::string &depthVertShaderPath,
+                    const std::string &shadowVertShaderPath) {
   s_Data.vertShaderPath = vertShaderPath;
   s_Data.fragShaderPath = fragShaderPath;
+  s_Data.clusterShaderPath = clusterShaderPath;
+  s_Data.depthVertShaderPath = depthVertShaderPath;
+  s_Data.shadowVertShaderPath = shadowVertShaderPath;
 
   InitVulkan();
 }
 
 void Renderer::InitVulkan() {
+  auto startupBegin = std::chrono::steady_clock::now();
+
   ApplicationInfo appInfo;
   appInfo.width = Core::Application::Get().getWindow()->getFramebufferSize().x;
   appInfo.height = Core::Application::Get().getWindow()->getFramebufferSize().y;
@@ -57,65 +87,113 @@ void Renderer::InitVulkan() {
   s_Data.swapchain.init(&s_Data.context);
   s_Data.swapchain.createSwapChain();
   s_Data.swapchain.createImageViews();
-  s_Data.swapchain.createDepthResources();
-
-  s_Data.renderPass.init(&s_Data.context, s_Data.swapchain);
-
-  s_Data.swapchain.createFramebuffers(s_Data.renderPass.getRenderPass());
-
-  s_Data.pipeline.init(&s_Data.context, s_Data.renderPass,
-                       s_Data.vertShaderPath, s_Data.fragShaderPath);
+  UpdateUpscaleSupport();
+  s_Data.presentPacer.init(&s_Data.context);
+  s_Data.presentPacer.onSwapchainCreated(
+      s_Data.swapchain.getPresentMode(),
+      static_cast<uint32_t>(s_Data.swapchain.getSwapChainImages().size()));
+
+  // Everything that recycles per-frame resources or defers destruction
+  // keys off its timeline
+  s_Data.syncManager.init(&s_Data.context, DEFAULT_FRAMES_IN_FLIGHT,
+                          s_Data.swapchain.getSwapChainImages().size());
+  s_Data.requestedFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+  s_Data.deletionQueue.init(&s_Data.context, &s_Data.syncManager);
+
+  s_Data.renderGraph.init(&s_Data.context, &s_Data.deletionQueue);
+  s_Data.depthFormat = s_Data.swapchain.findDepthFormat(&s_Data.context);
+  s_Data.mainRenderPass = s_Data.renderGraph.getCompatibleRenderPass(
+      {s_Data.swapchain.getSwapChainImageFormat()}, s_Data.depthFormat);
+  s_Data.depthRenderPass =
+      s_Data.renderGraph.getCompatibleRenderPass({}, s_Data.depthFormat);
+
+  s_Data.threadPool.init();
+
+  s_Data.pipelineCache.init(&s_Data.context, PIPELINE_CACHE_PATH);
+  s_Data.pipelineManager.init(&s_Data.context, &s_Data.pipelineCache,
+                              &s_Data.threadPool, &s_Data.deletionQueue);
+  if (enableShaderHotReload)
+    s_Data.pipelineManager.enableHotReload();
+  s_Data.vertShader =
+      s_Data.pipelineManager.registerShader(s_Data.vertShaderPath);
+  s_Data.fragShader =
+      s_Data.pipelineManager.registerShader(s_Data.fragShaderPath);
+  // Built up front, it is also what draws fall back to while their own
+  // permutation compiles
+  s_Data.pipelineManager.getOrCreate(
+      MakePipelineKey(PipelineState::opaque()));
+  s_Data.clusterShader =
+      s_Data.pipelineManager.registerShader(s_Data.clusterShaderPath);
+  s_Data.pipelineManager.getOrCreateCompute(s_Data.clusterShader);
+  // Depth prepass and shadow pipelines are requested on first use
+  s_Data.depthVertShader =
+      s_Data.pipelineManager.registerShader(s_Data.depthVertShaderPath);
+  s_Data.shadowVertShader =
+      s_Data.pipelineManager.registerShader(s_Data.shadowVertShaderPath);
 
   s_Data.commandManager.init(&s_Data.context);
   s_Data.commandManager.createCommandPools();
 
   s_Data.bufferManager.init(&s_Data.context, &s_Data.commandManager);
 
-  s_Data.objectManager.init(&s_Data.context, &s_Data.bufferManager);
+  s_Data.objectManager.init(&s_Data.context, &s_Data.bufferManager,
+                            &s_Data.deletionQueue);
 
   s_Data.whiteTexture.init(&s_Data.context, &s_Data.commandManager);
   s_Data.whiteTexture.createDefaultWhite(&s_Data.bufferManager);
 
-  s_Data.uniformBufferManager.resize(MAX_FRAMES_IN_FLIGHT);
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-    s_Data.uniformBufferManager[i] = UBOManager(
-        &s_Data.context, &s_Data.bufferManager, sizeof(UniformBufferObject));
-  }
+  s_Data.textureLoader.init(&s_Data.context, &s_Data.bufferManager,
+                            &s_Data.threadPool, &s_Data.whiteTexture,
+                            &s_Data.deletionQueue);
+
+  s_Data.uniformRing.init(&s_Data.context, &s_Data.bufferManager,
+                          MAX_FRAMES_IN_FLIGHT, UNIFORM_RING_FRAME_SIZE);
+
+  s_Data.descriptorManager.init(&s_Data.context, MAX_FRAMES_IN_FLIGHT);
+
+  s_Data.lighting.init(&s_Data.context, &s_Data.bufferManager,
+                       MAX_FRAMES_IN_FLIGHT);
+  s_Data.shadows.init(&s_Data.context);
+  s_Data.shadowRenderPass = s_Data.renderGraph.getCompatibleRenderPass(
+      {}, s_Data.shadows.getFormat());
 
-  s_Data.descriptorManager.init(&s_Data.context);
-  s_Data.descriptorManager.createPool(MAX_FRAMES_IN_FLIGHT);
-  std::vector<VkDescriptorSetLayout> layouts(
-      MAX_FRAMES_IN_FLIGHT, s_Data.pipeline.getDescriptionSetLayout());
-  s_Data.descriptorSets = s_Data.descriptorManager.allocateSets(
-      layouts, s_Data.uniformBufferManager, s_Data.whiteTexture,
-      MAX_FRAMES_IN_FLIGHT);
+  s_Data.pipelineStats.init(&s_Data.context, MAX_FRAMES_IN_FLIGHT);
+  s_Data.gpuTimer.init(&s_Data.context, MAX_FRAMES_IN_FLIGHT);
 
   s_Data.commandManager.allocateFrameCommandBuffers(MAX_FRAMES_IN_FLIGHT);
 
-  s_Data.syncManager.init(&s_Data.context, MAX_FRAMES_IN_FLIGHT,
-                          s_Data.swapchain.getSwapChainImages().size());
+  double startupMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - startupBegin)
+                         .count();
+  std::println("Renderer startup ({} pipeline cache): {:.2f} ms total, "
+               "{:.2f} ms pipeline creation",
+               s_Data.pipelineCache.isWarm() ? "warm" : "cold", startupMs,
+               s_Data.pipelineManager.getCreationTimeMs());
 }
 
 void Renderer::Cleanup() {
   vkDeviceWaitIdle(s_Data.context.getDevice());
 
+  s_Data.textureLoader.shutdown();
+  s_Data.pipelineManager.shutdown();
+  s_Data.threadPool.shutdown();
   s_Data.whiteTexture.cleanup();
 
   s_Data.objectManager.shutdown();
 
-  s_Data.pipeline.shutdown();
-  s_Data.renderPass.shutdown();
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    s_Data.uniformBufferManager[i].shutdown();
-  }
+  s_Data.pipelineCache.shutdown();
+  s_Data.renderGraph.shutdown();
 
-  vkDestroyDescriptorSetLayout(s_Data.context.getDevice(),
-                               s_Data.pipeline.getDescriptionSetLayout(),
-                               nullptr);
+  s_Data.uniformRing.shutdown();
+  s_Data.lighting.shutdown();
+  s_Data.shadows.shutdown();
+  s_Data.pipelineStats.shutdown();
+  s_Data.gpuTimer.shutdown();
 
   s_Data.descriptorManager.shutdown();
 
+  // Last, the shutdowns above may still hand it objects
+  s_Data.deletionQueue.shutdown();
   s_Data.syncManager.cleanup();
 
   s_Data.commandManager.shutdown();
@@ -138,40 +216,381 @@ void Renderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
     throw std::runtime_error("failed to begin recording command buffer!");
   }
 
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = s_Data.renderPass.getRenderPass();
-  renderPassInfo.framebuffer =
-      s_Data.swapchain.getSwapChainFramebuffers()[imageIndex];
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = s_Data.swapchain.getSwapChainExtent();
+  s_Data.drawStats = {};
+  BuildFrameGraph(imageIndex);
+  s_Data.renderGraph.compile();
+
+  uint32_t frameIndex = s_Data.syncManager.getFlightFrameIndex();
+  s_Data.gpuTimer.begin(commandBuffer, frameIndex);
+  s_Data.pipelineStats.begin(commandBuffer, frameIndex);
+  s_Data.renderGraph.execute(commandBuffer);
+  s_Data.pipelineStats.end(commandBuffer, frameIndex);
+  s_Data.gpuTimer.end(commandBuffer, frameIndex);
 
-  std::array<VkClearValue, 2> clearValues{};
-  clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-  clearValues[1].depthStencil = {1.0f, 0};
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+}
 
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
+void Renderer::BuildFrameGraph(uint32_t imageIndex) {
+  RenderGraph &graph = s_Data.renderGraph;
+  graph.reset();
+
+  // With dynamic resolution the scene goes into the top left of an
+  // offscreen target and only the final blit touches the swapchain image,
+  // so only that has to wait for the acquire
+  VkExtent2D swapchainExtent = s_Data.swapchain.getSwapChainExtent();
+  bool upscale =
+      s_Data.dynamicResolution.isEnabled() && s_Data.upscaleSupported;
+  VkExtent2D targetExtent =
+      upscale ? s_Data.dynamicResolution.getTargetExtent(swapchainExtent)
+              : swapchainExtent;
+  s_Data.renderExtent =
+      upscale ? s_Data.dynamicResolution.getRenderExtent(swapchainExtent)
+              : swapchainExtent;
+  s_Data.frameData.acquireWaitStage =
+      upscale ? VK_PIPELINE_STAGE_2_TRANSFER_BIT
+              : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+  RGResource backbuffer = graph.importImage(
+      "backbuffer", s_Data.swapchain.getSwapChainImages()[imageIndex],
+      s_Data.swapchain.getSwapChainImageViews()[imageIndex],
+      s_Data.swapchain.getSwapChainImageFormat(), swapchainExtent,
+      VK_IMAGE_LAYOUT_UNDEFINED, s_Data.frameData.acquireWaitStage);
+  RGResource sceneColor =
+      upscale ? graph.createImage(
+                    "scene color",
+                    {s_Data.swapchain.getSwapChainImageFormat(), targetExtent})
+              : backbuffer;
+  RGResource depth =
+      graph.createImage("depth", {s_Data.depthFormat, targetExtent});
+
+  PrepareDraws();
+  bool depthPrepass =
+      std::any_of(s_Data.drawQueue.begin(), s_Data.drawQueue.end(),
+                  [](const RendererData::DrawCommand &draw) {
+                    return draw.depthPipeline != VK_NULL_HANDLE;
+                  });
+
+  // Opaque draws cast shadows, with those outside the view, culled per
+  // cascade by their world bounds
+  s_Data.shadowCasters.clear();
+  s_Data.shadowCasterDraws.clear();
+  auto addShadowCaster = [](const RendererData::DrawCommand &draw) {
+    if (draw.state.blend != BlendMode::Opaque)
+      return;
+
+    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(draw.objID);
+    glm::vec3 center = (objInfo.boundsMin + objInfo.boundsMax) * 0.5f;
+    glm::vec3 extent = (objInfo.boundsMax - objInfo.boundsMin) * 0.5f;
+    glm::mat3 absRotation(draw.transform);
+    for (int column = 0; column < 3; column++) {
+      absRotation[column] = glm::abs(absRotation[column]);
+    }
+    glm::vec3 worldCenter = glm::vec3(draw.transform * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent = absRotation * extent;
+    s_Data.shadowCasters.push_back(
+        {worldCenter - worldExtent, worldCenter + worldExtent});
+    s_Data.shadowCasterDraws.push_back(&draw);
+  };
+  for (const RendererData::DrawCommand &draw : s_Data.drawQueue)
+    addShadowCaster(draw);
+  for (const RendererData::DrawCommand &draw : s_Data.shadowDrawQueue)
+    addShadowCaster(draw);
+  s_Data.shadows.update(s_Data.cameraUniforms.view,
+                        s_Data.cameraUniforms.proj, s_Data.shadowCasters);
+
+  // Shared by every pass of the frame
+  s_Data.lighting.fillUniforms(s_Data.cameraUniforms, s_Data.renderExtent);
+  s_Data.shadows.fillUniforms(s_Data.cameraUniforms);
+  s_Data.frameData.cameraOffset =
+      s_Data.uniformRing.push(s_Data.cameraUniforms);
+  s_Data.frameData.lights = s_Data.lighting.uploadLights(s_Data.uniformRing);
+
+  // One resource per layer, cascades that are not rendered keep what an
+  // earlier frame left in them. The main pass leaves them all shader read
+  // only.
+  std::array<RGResource, SHADOW_CASCADE_COUNT> cascades;
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    cascades[i] = graph.importImage(
+        "shadow cascade", s_Data.shadows.getImage(),
+        s_Data.shadows.getCascadeView(i), s_Data.shadows.getFormat(),
+        s_Data.shadows.getExtent(), s_Data.shadows.getLayout(),
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, i, 1);
+  }
+  s_Data.shadows.setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+    if (!s_Data.shadows.needsRender(i))
+      continue;
+
+    graph.addPass(
+        "shadow cascade", RGPassType::Raster,
+        [&](RenderGraph::PassBuilder &pass) {
+          pass.writeDepth(cascades[i], VK_ATTACHMENT_LOAD_OP_CLEAR,
+                          {1.0f, 0});
+        },
+        [i](VkCommandBuffer commandBuffer) {
+          RecordShadowCascade(commandBuffer, i);
+        });
+  }
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  if (depthPrepass) {
+    graph.addPass(
+        "depth prepass", RGPassType::Raster,
+        [&](RenderGraph::PassBuilder &pass) {
+          pass.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR, {1.0f, 0})
+              .renderArea(s_Data.renderExtent);
+        },
+        RecordDepthPrepass);
+  }
 
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    s_Data.pipeline.getPipeline());
+  // This frame's slice, free again after the frame timeline wait
+  RGResource clusters = graph.importBuffer(
+      "clusters", s_Data.lighting.getClusterBuffer(),
+      s_Data.lighting.getClusterOffset(
+          s_Data.syncManager.getFlightFrameIndex()),
+      s_Data.lighting.getClusterRange());
+
+  graph.addPass(
+      "light culling", RGPassType::Compute,
+      [&](RenderGraph::PassBuilder &pass) { pass.storageWrite(clusters); },
+      RecordLightCulling);
+
+  graph.addPass(
+      "main", RGPassType::Raster,
+      [&](RenderGraph::PassBuilder &pass) {
+        pass.writeColor(sceneColor, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                        {{0.0f, 0.0f, 0.0f, 1.0f}});
+        pass.renderArea(s_Data.renderExtent);
+        // Draws outside the prepass still write depth
+        pass.writeDepth(depth,
+                        depthPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                     : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                        {1.0f, 0});
+        pass.storageRead(clusters, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        for (RGResource cascade : cascades)
+          pass.sampled(cascade, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+      },
+      RecordMainPass);
+
+  if (upscale) {
+    graph.addPass(
+        "upscale", RGPassType::Transfer,
+        [&](RenderGraph::PassBuilder &pass) {
+          pass.transferSrc(sceneColor);
+          pass.transferDst(backbuffer);
+        },
+        [sceneColor, backbuffer](VkCommandBuffer commandBuffer) {
+          RecordUpscale(commandBuffer, s_Data.renderGraph.getImage(sceneColor),
+                        s_Data.renderGraph.getImage(backbuffer));
+        });
+  }
 
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = (float)s_Data.swapchain.getSwapChainExtent().width;
-  viewport.height = (float)s_Data.swapchain.getSwapChainExtent().height;
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  graph.present(backbuffer);
+}
 
-  VkRect2D scissor{};
-  scissor.offset = {0, 0};
-  scissor.extent = s_Data.swapchain.getSwapChainExtent();
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+void Renderer::RecordLightCulling(VkCommandBuffer commandBuffer) {
+  const ShaderProgramLayout &layout =
+      s_Data.pipelineManager.getComputeLayout(s_Data.clusterShader);
+
+  DescriptorWriter writer;
+  writer.writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                     s_Data.uniformRing.getBuffer(), 0,
+                     sizeof(UniformBufferObject));
+  writer.writeBuffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                     s_Data.uniformRing.getBuffer(),
+                     s_Data.frameData.lights.offset,
+                     s_Data.frameData.lights.range);
+  writer.writeBuffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                     s_Data.lighting.getClusterBuffer(),
+                     s_Data.lighting.getClusterOffset(
+                         s_Data.syncManager.getFlightFrameIndex()),
+                     s_Data.lighting.getClusterRange());
+  VkDescriptorSet set =
+      s_Data.descriptorManager.allocateFrame(layout.setLayouts[0], writer);
+
+  vkCmdBindPipeline(
+      commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+      s_Data.pipelineManager.getOrCreateCompute(s_Data.clusterShader));
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          layout.pipelineLayout, 0, 1, &set, 1,
+                          &s_Data.frameData.cameraOffset);
+  s_Data.drawStats.pipelineBinds++;
+  s_Data.drawStats.descriptorBinds++;
+  // One workgroup per cluster
+  vkCmdDispatch(commandBuffer, CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+}
+
+void Renderer::PrepareDraws() {
+  // Permutations still compiling on a worker draw with the default pipeline
+  VkPipeline fallback = s_Data.pipelineManager.getOrCreate(
+      MakePipelineKey(PipelineState::opaque()));
+  for (RendererData::DrawCommand &draw : s_Data.drawQueue) {
+    draw.depthPipeline = VK_NULL_HANDLE;
+
+    // Only draws that would write the depth they test against. Both
+    // pipelines have to be ready, a draw in the prepass has to be shaded
+    // with the equal test.
+    const PipelineState &state = draw.state;
+    bool prepassed =
+        s_Data.depthPrepass && state.blend == BlendMode::Opaque &&
+        state.depthTest && state.depthWrite && state.colorWrite &&
+        state.polygonMode == VK_POLYGON_MODE_FILL &&
+        (state.depthCompare == VK_COMPARE_OP_LESS ||
+         state.depthCompare == VK_COMPARE_OP_LESS_OR_EQUAL);
+    if (prepassed) {
+      PipelineState equalState = state;
+      equalState.depthWrite = VK_FALSE;
+      equalState.depthCompare = VK_COMPARE_OP_EQUAL;
+      VkPipeline depthPipeline =
+          s_Data.pipelineManager.request(MakeDepthOnlyPipelineKey(
+              state, s_Data.depthVertShader, s_Data.depthRenderPass,
+              s_Data.depthFormat));
+      VkPipeline pipeline =
+          s_Data.pipelineManager.request(MakePipelineKey(equalState));
+      if (depthPipeline != VK_NULL_HANDLE && pipeline != VK_NULL_HANDLE) {
+        draw.depthPipeline = depthPipeline;
+        draw.pipeline = pipeline;
+        continue;
+      }
+    }
+
+    draw.pipeline = s_Data.pipelineManager.request(MakePipelineKey(state));
+    if (draw.pipeline == VK_NULL_HANDLE)
+      draw.pipeline = fallback;
+  }
+
+  // Pipelines are numbered in order of first use this frame. Draws carry no
+  // material yet, they all share the frame's descriptor set.
+  s_Data.pipelineSortIds.clear();
+  s_Data.drawSortKeys.resize(s_Data.drawQueue.size());
+  for (uint32_t i = 0; i < s_Data.drawQueue.size(); i++) {
+    const RendererData::DrawCommand &draw = s_Data.drawQueue[i];
+    uint32_t nextId = static_cast<uint32_t>(s_Data.pipelineSortIds.size());
+    uint32_t pipelineId =
+        s_Data.pipelineSortIds.try_emplace(draw.pipeline, nextId).first->second;
+
+    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(draw.objID);
+    glm::vec3 center = (objInfo.boundsMin + objInfo.boundsMax) * 0.5f;
+    glm::vec4 viewCenter = s_Data.cameraUniforms.view *
+                           (draw.transform * glm::vec4(center, 1.0f));
+    DrawLayer layer = draw.state.blend == BlendMode::Opaque
+                          ? DrawLayer::Opaque
+                          : DrawLayer::Blended;
+    s_Data.drawSortKeys[i] =
+        makeDrawSortKey(layer, pipelineId, 0, -viewCenter.z);
+  }
+
+  s_Data.drawSorter.sort(s_Data.drawSortKeys, s_Data.drawOrder);
+  s_Data.sortedDraws.clear();
+  for (uint32_t index : s_Data.drawOrder) {
+    s_Data.sortedDraws.push_back(s_Data.drawQueue[index]);
+  }
+  s_Data.drawQueue.swap(s_Data.sortedDraws);
+}
+
+void Renderer::RecordDepthPrepass(VkCommandBuffer commandBuffer) {
+  SetViewportAndScissor(commandBuffer, s_Data.renderExtent);
+
+  // Positions only, same vertex offsets as the full vertex buffer
+  VkBuffer vertexBuffers[] = {s_Data.objectManager.getPositionBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, s_Data.objectManager.getIndexBuffer(), 0,
+                       VK_INDEX_TYPE_UINT32);
+
+  // depth.vert only reads the camera uniforms
+  const ShaderProgramLayout &programLayout =
+      s_Data.pipelineManager.getProgramLayout(s_Data.depthVertShader,
+                                              NULL_SHADER);
+  VkDescriptorSet frameSet = GetCameraDescriptorSet(programLayout);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          programLayout.pipelineLayout, 0, 1, &frameSet, 1,
+                          &s_Data.frameData.cameraOffset);
+  s_Data.drawStats.descriptorBinds++;
+
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  for (const RendererData::DrawCommand &draw : s_Data.drawQueue) {
+    if (draw.depthPipeline == VK_NULL_HANDLE)
+      continue;
+
+    if (draw.depthPipeline != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        draw.depthPipeline);
+      boundPipeline = draw.depthPipeline;
+      s_Data.drawStats.pipelineBinds++;
+    }
+
+    BindDrawTransform(commandBuffer, programLayout, frameSet, draw.transform);
+
+    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(draw.objID);
+    vkCmdDrawIndexed(commandBuffer, objInfo.indexCount, 1, objInfo.indexOffset,
+                     objInfo.vertexOffsetValue, 0);
+    s_Data.drawStats.draws++;
+  }
+}
+
+void Renderer::RecordShadowCascade(VkCommandBuffer commandBuffer,
+                                   uint32_t cascade) {
+  SetViewportAndScissor(commandBuffer, s_Data.shadows.getExtent());
+
+  VkBuffer vertexBuffers[] = {s_Data.objectManager.getPositionBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, s_Data.objectManager.getIndexBuffer(), 0,
+                       VK_INDEX_TYPE_UINT32);
+
+  const ShaderProgramLayout &programLayout =
+      s_Data.pipelineManager.getProgramLayout(s_Data.shadowVertShader,
+                                              NULL_SHADER);
+  VkDescriptorSet frameSet = GetCameraDescriptorSet(programLayout);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          programLayout.pipelineLayout, 0, 1, &frameSet, 1,
+                          &s_Data.frameData.cameraOffset);
+  s_Data.drawStats.descriptorBinds++;
+
+  // shadow.vert picks the cascade's matrix, pushed after DrawConstants
+  vkCmdPushConstants(commandBuffer, programLayout.pipelineLayout,
+                     VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawConstants),
+                     sizeof(uint32_t), &cascade);
+
+  bool complete = true;
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  for (uint32_t caster : s_Data.shadows.getCasters(cascade)) {
+    const RendererData::DrawCommand &draw =
+        *s_Data.shadowCasterDraws[caster];
+
+    // Missing casters keep the cascade dirty until they are drawn
+    VkPipeline pipeline =
+        s_Data.pipelineManager.request(MakeDepthOnlyPipelineKey(
+            draw.state, s_Data.shadowVertShader, s_Data.shadowRenderPass,
+            s_Data.shadows.getFormat()));
+    if (pipeline == VK_NULL_HANDLE) {
+      complete = false;
+      continue;
+    }
+
+    if (pipeline != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        pipeline);
+      boundPipeline = pipeline;
+      s_Data.drawStats.pipelineBinds++;
+    }
+
+    BindDrawTransform(commandBuffer, programLayout, frameSet, draw.transform);
+
+    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(draw.objID);
+    vkCmdDrawIndexed(commandBuffer, objInfo.indexCount, 1, objInfo.indexOffset,
+                     objInfo.vertexOffsetValue, 0);
+    s_Data.drawStats.draws++;
+  }
+
+  s_Data.shadows.markRendered(cascade, complete);
+}
+
+void Renderer::RecordMainPass(VkCommandBuffer commandBuffer) {
+  SetViewportAndScissor(commandBuffer, s_Data.renderExtent);
 
   // Bind shared vertex and index buffers
   VkBuffer vertexBuffers[] = {s_Data.objectManager.getVertexBuffer()};
@@ -181,24 +600,96 @@ void Renderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                        VK_INDEX_TYPE_UINT32);
 
   // Bind descriptor sets once
-  vkCmdBindDescriptorSets(
-      commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-      s_Data.pipeline.getPipelineLayout(), 0, 1,
-      &s_Data.descriptorSets[s_Data.syncManager.getFlightFrameIndex()], 0,
-      nullptr);
+  const ShaderProgramLayout &programLayout =
+      s_Data.pipelineManager.getProgramLayout(s_Data.vertShader,
+                                              s_Data.fragShader);
+  VkDescriptorSet frameSet = AllocateFrameDescriptorSet(programLayout);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          programLayout.pipelineLayout, 0, 1, &frameSet, 1,
+                          &s_Data.frameData.cameraOffset);
+  s_Data.drawStats.descriptorBinds++;
 
   // Draw all queued objects
-  for (uint32_t objId : s_Data.drawQueue) {
-    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(objId);
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  for (const RendererData::DrawCommand &draw : s_Data.drawQueue) {
+    if (draw.pipeline != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        draw.pipeline);
+      boundPipeline = draw.pipeline;
+      s_Data.drawStats.pipelineBinds++;
+    }
+
+    BindDrawTransform(commandBuffer, programLayout, frameSet, draw.transform);
+
+    const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(draw.objID);
 
     vkCmdDrawIndexed(commandBuffer, objInfo.indexCount, 1, objInfo.indexOffset,
                      objInfo.vertexOffsetValue, 0);
+    s_Data.drawStats.draws++;
   }
+}
 
-  vkCmdEndRenderPass(commandBuffer);
+void Renderer::RecordUpscale(VkCommandBuffer commandBuffer, VkImage source,
+                             VkImage destination) {
+  VkExtent2D destinationExtent = s_Data.swapchain.getSwapChainExtent();
+
+  VkImageBlit region{};
+  region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.srcOffsets[1] = {static_cast<int32_t>(s_Data.renderExtent.width),
+                          static_cast<int32_t>(s_Data.renderExtent.height), 1};
+  region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.dstOffsets[1] = {static_cast<int32_t>(destinationExtent.width),
+                          static_cast<int32_t>(destinationExtent.height), 1};
+
+  vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+                 s_Data.upscaleFilter);
+}
 
-  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to record command buffer!");
+void Renderer::SetViewportAndScissor(VkCommandBuffer commandBuffer,
+                                     VkExtent2D extent) {
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = (float)extent.width;
+  viewport.height = (float)extent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.offset = {0, 0};
+  scissor.extent = extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void Renderer::BindDrawTransform(VkCommandBuffer commandBuffer,
+                                 const ShaderProgramLayout &layout,
+                                 VkDescriptorSet frameSet,
+                                 const glm::mat4 &transform) {
+  // Per-draw transforms are pushed when the vertex shader declares the
+  // DrawConstants block, otherwise each draw gets its own copy of the camera
+  // uniforms in the ring and only the dynamic offset changes
+  auto pushRange = std::find_if(
+      layout.pushConstants.begin(), layout.pushConstants.end(),
+      [](const VkPushConstantRange &range) {
+        return (range.stageFlags & VK_SHADER_STAGE_VERTEX_BIT) &&
+               range.offset == 0 && range.size >= sizeof(DrawConstants);
+      });
+
+  if (pushRange != layout.pushConstants.end()) {
+    DrawConstants constants{transform};
+    vkCmdPushConstants(commandBuffer, layout.pipelineLayout,
+                       pushRange->stageFlags, 0, sizeof(DrawConstants),
+                       &constants);
+  } else {
+    UniformBufferObject ubo = s_Data.cameraUniforms;
+    ubo.model = ubo.model * transform;
+    uint32_t drawOffset = s_Data.uniformRing.push(ubo);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            layout.pipelineLayout, 0, 1, &frameSet, 1,
+                            &drawOffset);
+    s_Data.drawStats.descriptorBinds++;
   }
 }
 
@@ -208,36 +699,71 @@ void Renderer::UpdateUniformBuffer(Camera camera) {
   ubo.model = glm::mat4(1.0f);
   ubo.view = camera.getViewMatrix();
   ubo.proj = camera.getProjectionMatrix();
+  ubo.viewPos = glm::vec4(camera.getPosition(), 1.0f);
+  s_Data.lighting.setDepthRange(camera.getNear(), camera.getFar());
+  s_Data.shadows.setDepthRange(camera.getNear(), camera.getFar());
 
-  s_Data.uniformBufferManager[s_Data.syncManager.getFlightFrameIndex()]
-      .writeData(&ubo);
+  // Pushed to the uniform ring when the frame is recorded, the previous
+  // use of this frame's region may still be in flight here
+  s_Data.cameraUniforms = ubo;
 }
 
-void Renderer::BeginDraw() {
-  s_Data.frameData.frameFence = s_Data.syncManager.getFrameFence();
-  vkWaitForFences(s_Data.context.getDevice(), 1, &s_Data.frameData.frameFence,
-                  VK_TRUE, UINT64_MAX);
-  vkResetFences(s_Data.context.getDevice(), 1, &s_Data.frameData.frameFence);
+bool Renderer::BeginDraw() {
+  s_Data.syncManager.setFramesInFlight(s_Data.requestedFramesInFlight);
+  s_Data.syncManager.beginFrame();
+  s_Data.deletionQueue.flush();
+  s_Data.pipelineStats.collect(s_Data.syncManager.getFlightFrameIndex());
+  if (s_Data.gpuTimer.collect(s_Data.syncManager.getFlightFrameIndex()))
+    s_Data.dynamicResolution.update(*s_Data.gpuTimer.getFrameMs());
+
+  // This frame's descriptor sets are no longer in use by the GPU
+  s_Data.descriptorManager.beginFrame(s_Data.syncManager.getFlightFrameIndex());
+  s_Data.uniformRing.beginFrame(s_Data.syncManager.getFlightFrameIndex());
+  s_Data.pipelineManager.update();
+  s_Data.textureLoader.update();
+
+  // Cleared even when the frame is skipped, draws and lights queued for it
+  // are dropped
+  s_Data.drawQueue.clear();
+  s_Data.shadowDrawQueue.clear();
+  s_Data.lighting.beginFrame();
+  s_Data.shadows.beginFrame();
+
+  if (s_Data.framebufferResized && !RecreateSwapChain()) {
+    s_Data.presentPacer.skipFrame();
+    return false;
+  }
 
   s_Data.frameData.adquireSemaphore = s_Data.syncManager.getAcquireSemaphore();
 
-  VkResult result = vkAcquireNextImageKHR(
-      s_Data.context.getDevice(), s_Data.swapchain.getSwapChain(), UINT64_MAX,
-      s_Data.frameData.adquireSemaphore, VK_NULL_HANDLE,
-      &s_Data.frameData.swapChainImageIndex);
+  // An out of date acquire leaves the semaphore unsignaled, it can be
+  // reused right away on the recreated swapchain
+  VkResult result = VK_ERROR_OUT_OF_DATE_KHR;
+  for (uint32_t attempt = 0; attempt < 2; attempt++) {
+    result = vkAcquireNextImageKHR(
+        s_Data.context.getDevice(), s_Data.swapchain.getSwapChain(),
+        UINT64_MAX, s_Data.frameData.adquireSemaphore, VK_NULL_HANDLE,
+        &s_Data.frameData.swapChainImageIndex);
+    if (result != VK_ERROR_OUT_OF_DATE_KHR)
+      break;
+
+    s_Data.framebufferResized = true;
+    if (!RecreateSwapChain()) {
+      s_Data.presentPacer.skipFrame();
+      return false;
+    }
+  }
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    s_Data.swapchain.recreateSwapChain(s_Data.renderPass.getRenderPass());
-    return;
+    s_Data.presentPacer.skipFrame();
+    return false;
   } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
     throw std::runtime_error("failed to acquire swap chain image!");
   }
 
   s_Data.frameData.commandBuffer = s_Data.commandManager.getFrameCommandBuffer(
       s_Data.syncManager.getFlightFrameIndex());
-
-  // Clear the draw queue for this frame
-  s_Data.drawQueue.clear();
+  return true;
 }
 
 void Renderer::EndDraw() {
@@ -246,33 +772,45 @@ void Renderer::EndDraw() {
 
   VkSemaphore submitSemaphore = s_Data.syncManager.getSubmitSemaphore(
       s_Data.frameData.swapChainImageIndex);
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-  VkSemaphore waitSemaphores[] = {s_Data.frameData.adquireSemaphore};
-  VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
-
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &s_Data.frameData.commandBuffer;
-
-  VkSemaphore signalSemaphores[] = {submitSemaphore};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
-
-  if (vkQueueSubmit(s_Data.context.getGraphicsQueue(), 1, &submitInfo,
-                    s_Data.frameData.frameFence) != VK_SUCCESS) {
+  VkSemaphoreSubmitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  waitInfo.semaphore = s_Data.frameData.adquireSemaphore;
+  waitInfo.stageMask = s_Data.frameData.acquireWaitStage;
+
+  VkCommandBufferSubmitInfo commandBufferInfo{};
+  commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+  commandBufferInfo.commandBuffer = s_Data.frameData.commandBuffer;
+
+  // Binary semaphore for present, timeline value for frame pacing
+  VkSemaphoreSubmitInfo signalInfos[2]{};
+  signalInfos[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  signalInfos[0].semaphore = submitSemaphore;
+  signalInfos[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+  signalInfos[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  signalInfos[1].semaphore = s_Data.syncManager.getTimelineSemaphore();
+  signalInfos[1].value = s_Data.syncManager.getFrameValue();
+  signalInfos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+  VkSubmitInfo2 submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+  submitInfo.waitSemaphoreInfoCount = 1;
+  submitInfo.pWaitSemaphoreInfos = &waitInfo;
+  submitInfo.commandBufferInfoCount = 1;
+  submitInfo.pCommandBufferInfos = &commandBufferInfo;
+  submitInfo.signalSemaphoreInfoCount = 2;
+  submitInfo.pSignalSemaphoreInfos = signalInfos;
+
+  if (vkQueueSubmit2(s_Data.context.getGraphicsQueue(), 1, &submitInfo,
+                     VK_NULL_HANDLE) != VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
+  s_Data.syncManager.endFrame();
 
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &submitSemaphore;
 
   VkSwapchainKHR swapChains[] = {s_Data.swapchain.getSwapChain()};
   presentInfo.swapchainCount = 1;
@@ -280,25 +818,288 @@ void Renderer::EndDraw() {
 
   presentInfo.pImageIndices = &s_Data.frameData.swapChainImageIndex;
 
+  uint64_t presentId = s_Data.presentPacer.nextPresentId();
+  VkPresentIdKHR presentIdInfo{};
+  presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+  presentIdInfo.swapchainCount = 1;
+  presentIdInfo.pPresentIds = &presentId;
+  if (presentId != 0)
+    presentInfo.pNext = &presentIdInfo;
+
   VkResult result;
   result = vkQueuePresentKHR(s_Data.context.getPresentQueue(), &presentInfo);
+  s_Data.presentPacer.presented(presentId);
 
-  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-      s_Data.framebufferResized) {
-    s_Data.framebufferResized = false;
-    s_Data.swapchain.recreateSwapChain(s_Data.renderPass.getRenderPass());
+  // Recreated at the start of the next frame, after its timeline wait
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+    s_Data.framebufferResized = true;
   } else if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to present swap chain image!");
   }
 
-  s_Data.syncManager.nextFlightFrame();
+  // The application samples the next frame's input once this returns
+  s_Data.presentPacer.endFrame(s_Data.swapchain.getSwapChain());
+}
+
+AABB Renderer::GetObjectBounds(uint32_t objID) {
+  const ObjBufferInfo &objInfo = s_Data.objectManager.getObjInfo(objID);
+  return {objInfo.boundsMin, objInfo.boundsMax};
 }
 
-void Renderer::DrawObject(uint32_t objID) {
+void Renderer::DrawObject(uint32_t objID, const PipelineState &state,
+                          const glm::mat4 &transform) {
   // Add object to the draw queue
-  s_Data.drawQueue.push_back(objID);
+  s_Data.drawQueue.push_back(
+      {objID, state, transform, VK_NULL_HANDLE, VK_NULL_HANDLE});
+}
+
+void Renderer::DrawShadowCaster(uint32_t objID, const PipelineState &state,
+                                const glm::mat4 &transform) {
+  s_Data.shadowDrawQueue.push_back(
+      {objID, state, transform, VK_NULL_HANDLE, VK_NULL_HANDLE});
+}
+
+void Renderer::SubmitScene(const SceneGraph &scene) {
+  scene.forEachRenderable([](uint32_t objID, const PipelineState &state,
+                             const glm::mat4 &transform) {
+    DrawObject(objID, state, transform);
+  });
+}
+
+void Renderer::SubmitWorld(Core::World &world) {
+  s_Data.drawQueue.reserve(
+      s_Data.drawQueue.size() +
+      world.count<MeshComponent, TransformComponent, MaterialComponent>());
+  world.each<MeshComponent, TransformComponent, MaterialComponent,
+             VisibilityComponent>(
+      [](const MeshComponent &mesh, const TransformComponent &transform,
+         const MaterialComponent &material,
+         const VisibilityComponent &visibility) {
+        if (visibility.visible) {
+          s_Data.drawQueue.push_back({mesh.objID, material.state,
+                                      transform.world, VK_NULL_HANDLE,
+                                      VK_NULL_HANDLE});
+        } else if (material.state.blend == BlendMode::Opaque) {
+          s_Data.shadowDrawQueue.push_back({mesh.objID, material.state,
+                                            transform.world, VK_NULL_HANDLE,
+                                            VK_NULL_HANDLE});
+        }
+      });
+  // Nobody culls these, they are always drawn
+  world.each<MeshComponent, TransformComponent, MaterialComponent>(
+      Core::componentMask<VisibilityComponent>(),
+      [](const MeshComponent &mesh, const TransformComponent &transform,
+         const MaterialComponent &material) {
+        s_Data.drawQueue.push_back({mesh.objID, material.state,
+                                    transform.world, VK_NULL_HANDLE,
+                                    VK_NULL_HANDLE});
+      });
+}
+
+void Renderer::SubmitLight(const Light &light) {
+  if (light.type == LightType::Directional)
+    s_Data.shadows.setLight(light);
+  else
+    s_Data.lighting.addLight(light);
+}
+
+PipelineKey Renderer::MakePipelineKey(const PipelineState &state) {
+  PipelineKey key;
+  key.vertShader = s_Data.vertShader;
+  key.fragShader = s_Data.fragShader;
+  key.vertexLayout = VertexLayout::Standard;
+  key.state = state;
+  key.renderPass = s_Data.mainRenderPass;
+  key.subpass = 0;
+  key.colorFormat = s_Data.swapchain.getSwapChainImageFormat();
+  key.depthFormat = s_Data.depthFormat;
+  return key;
+}
+
+PipelineKey Renderer::MakeDepthOnlyPipelineKey(const PipelineState &state,
+                                               ShaderId vertShader,
+                                               VkRenderPass renderPass,
+                                               VkFormat depthFormat) {
+  PipelineState depthState = PipelineState::depthPrepass();
+  depthState.topology = state.topology;
+  depthState.cullMode = state.cullMode;
+  depthState.frontFace = state.frontFace;
+  depthState.depthCompare = state.depthCompare;
+
+  PipelineKey key;
+  key.vertShader = vertShader;
+  key.fragShader = NULL_SHADER;
+  key.vertexLayout = VertexLayout::PositionOnly;
+  key.state = depthState;
+  key.renderPass = renderPass;
+  key.subpass = 0;
+  key.colorFormat = VK_FORMAT_UNDEFINED;
+  key.depthFormat = depthFormat;
+  return key;
+}
+
+bool Renderer::RecreateSwapChain() {
+  auto start = std::chrono::steady_clock::now();
+
+  RetiredSwapchain retired;
+  if (!s_Data.swapchain.recreateSwapChain(retired))
+    return false;
+  s_Data.framebufferResized = false;
+  UpdateUpscaleSupport();
+  s_Data.presentPacer.onSwapchainCreated(
+      s_Data.swapchain.getPresentMode(),
+      static_cast<uint32_t>(s_Data.swapchain.getSwapChainImages().size()));
+
+  // Frames in flight keep presenting to the old swapchain, it goes away
+  // with them instead of draining the device
+  s_Data.renderGraph.invalidateFramebuffers();
+  for (VkImageView view : retired.imageViews)
+    s_Data.deletionQueue.destroyImageView(view);
+  s_Data.deletionQueue.destroySwapchain(retired.swapChain);
+  for (VkSemaphore semaphore : s_Data.syncManager.recreateSubmitSemaphores(
+           s_Data.swapchain.getSwapChainImages().size()))
+    s_Data.deletionQueue.destroySemaphore(semaphore);
+  // The transient depth follows the new extent on its own
+
+  SwapchainStats &stats = s_Data.swapchainStats;
+  stats.lastRecreateMs = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  stats.maxRecreateMs = std::max(stats.maxRecreateMs, stats.lastRecreateMs);
+  stats.recreateCount++;
+  return true;
+}
+
+const SwapchainStats &Renderer::GetSwapchainStats() {
+  return s_Data.swapchainStats;
+}
+
+void Renderer::SetDepthPrepass(bool enabled) { s_Data.depthPrepass = enabled; }
+
+bool Renderer::IsDepthPrepassEnabled() { return s_Data.depthPrepass; }
+
+std::optional<uint64_t> Renderer::GetFragmentInvocations() {
+  return s_Data.pipelineStats.getFragmentInvocations();
+}
+
+const CascadedShadowMaps::Stats &Renderer::GetShadowStats() {
+  return s_Data.shadows.getStats();
+}
+
+void Renderer::SetDynamicResolution(
+    const DynamicResolutionSettings &settings) {
+  s_Data.dynamicResolution.setSettings(settings);
+}
+
+const DynamicResolutionSettings &Renderer::GetDynamicResolution() {
+  return s_Data.dynamicResolution.getSettings();
+}
+
+float Renderer::GetResolutionScale() {
+  return s_Data.upscaleSupported ? s_Data.dynamicResolution.getScale() : 1.0f;
+}
+
+std::optional<double> Renderer::GetGpuFrameMs() {
+  return s_Data.gpuTimer.getFrameMs();
+}
+
+void Renderer::SetPresentPolicy(const PresentPolicy &policy) {
+  const PresentPolicy &current = s_Data.presentPacer.getPolicy();
+  if (policy.presentMode != current.presentMode ||
+      policy.imageCount != current.imageCount) {
+    s_Data.swapchain.setPreferredPresentMode(policy.presentMode);
+    s_Data.swapchain.setPreferredImageCount(policy.imageCount);
+    s_Data.framebufferResized = true;
+  }
+  s_Data.presentPacer.setPolicy(policy);
+}
+
+const PresentPolicy &Renderer::GetPresentPolicy() {
+  return s_Data.presentPacer.getPolicy();
+}
+
+const PresentStats &Renderer::GetPresentStats() {
+  return s_Data.presentPacer.getStats();
+}
+
+const DrawStats &Renderer::GetDrawStats() { return s_Data.drawStats; }
+
+void Renderer::UpdateUpscaleSupport() {
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(
+      s_Data.context.getPhysicalDevice(),
+      s_Data.swapchain.getSwapChainImageFormat(), &properties);
+  VkFormatFeatureFlags features = properties.optimalTilingFeatures;
+
+  s_Data.upscaleSupported =
+      (s_Data.swapchain.getSwapChainImageUsage() &
+       VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+      (features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) &&
+      (features & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+  s_Data.upscaleFilter =
+      (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+          ? VK_FILTER_LINEAR
+          : VK_FILTER_NEAREST;
 }
 
 uint32_t Renderer::addObject(RenderObject &obj) {
   return s_Data.objectManager.addRenderObject(obj);
 }
+
+TextureHandle Renderer::LoadTexture(const std::string &path, bool streamed) {
+  return s_Data.textureLoader.load(path, streamed);
+}
+
+void Renderer::RequestTextureDetail(TextureHandle texture,
+                                    float screenPixels) {
+  s_Data.textureLoader.requestDetail(texture, screenPixels);
+}
+
+void Renderer::SetTextureBudget(VkDeviceSize bytes) {
+  s_Data.textureLoader.setStreamingBudget(bytes);
+}
+
+void Renderer::SetTexture(TextureHandle texture) {
+  s_Data.activeTexture = texture;
+}
+
+VkDescriptorSet
+Renderer::AllocateFrameDescriptorSet(const ShaderProgramLayout &layout) {
+  Texture &texture = s_Data.activeTexture
+                         ? s_Data.textureLoader.get(*s_Data.activeTexture)
+                         : s_Data.whiteTexture;
+
+  // Written fresh every frame, a texture swapped in by the loader is simply
+  // picked up by the next frame's set
+  DescriptorWriter writer;
+  writer.writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                     s_Data.uniformRing.getBuffer(), 0,
+                     sizeof(UniformBufferObject));
+  writer.writeImage(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    texture.getImageView(), texture.getSampler(),
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  writer.writeBuffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                     s_Data.uniformRing.getBuffer(),
+                     s_Data.frameData.lights.offset,
+                     s_Data.frameData.lights.range);
+  writer.writeBuffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                     s_Data.lighting.getClusterBuffer(),
+                     s_Data.lighting.getClusterOffset(
+                         s_Data.syncManager.getFlightFrameIndex()),
+                     s_Data.lighting.getClusterRange());
+  writer.writeImage(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    s_Data.shadows.getArrayView(), s_Data.shadows.getSampler(),
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  return s_Data.descriptorManager.allocateFrame(layout.setLayouts[0], writer);
+}
+
+VkDescriptorSet
+Renderer::GetCameraDescriptorSet(const ShaderProgramLayout &layout) {
+  // The ring buffer lives as long as the renderer, only the dynamic offset
+  // moves
+  DescriptorWriter writer;
+  writer.writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                     s_Data.uniformRing.getBuffer(), 0,
+                     sizeof(UniformBufferObject));
+  return s_Data.descriptorManager.getCached(layout.setLayouts[0], writer);
+}
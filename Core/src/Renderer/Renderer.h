@@ -1,66 +1,236 @@
 #pragma once
 #include "BufferManager/BufferManager.h"
-#include "BufferManager/UniformBufferManager.h"
+#include "BufferManager/UniformRingBuffer.h"
+#include "Common/UniformBufferObject.h"
 #include "Commands/CommandManager.h"
+#include "Core/ECS/World.h"
+#include "Core/ThreadPool.h"
 #include "DescriptorManager/DescriptorManager.h"
-#include "Pipeline/Pipeline.h"
-#include "Pipeline/RenderPass.h"
+#include "DrawSort/DrawSort.h"
+#include "DynamicResolution/DynamicResolution.h"
+#include "Lighting/CascadedShadowMaps.h"
+#include "Lighting/ClusteredLighting.h"
+#include "Lighting/Light.h"
+#include "Pipeline/PipelineCache.h"
+#include "Pipeline/PipelineManager.h"
+#include "Pipeline/PipelineState.h"
+#include "Queries/GpuTimer.h"
+#include "Queries/PipelineStatistics.h"
 #include "RenderObjects/ObjectManager.h"
+#include "RenderGraph/RenderGraph.h"
 #include "RenderObjects/RenderObject.h"
+#include "Scene/BVH/BVH.h"
 #include "Scene/Camera/Camera.h"
+#include "Scene/Components/Components.h"
+#include "Scene/SceneGraph/SceneGraph.h"
+#include "Swapchain/PresentPacer.h"
 #include "Swapchain/Swapchain.h"
 #include "Texture/Texture.h"
+#include "Texture/TextureLoader.h"
+#include "VulkanSyncObjects/DeletionQueue.h"
 #include "VulkanSyncObjects/VulkanSyncObjects.h"
 #include "vulkan/vulkan_core.h"
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// Time spent in Renderer::RecreateSwapChain, on the main thread
+struct SwapchainStats {
+  uint32_t recreateCount = 0;
+  double lastRecreateMs = 0.0;
+  double maxRecreateMs = 0.0;
+};
+
+// Commands recorded for the last frame, all passes together
+struct DrawStats {
+  uint32_t draws = 0;
+  uint32_t pipelineBinds = 0;
+  uint32_t descriptorBinds = 0;
+};
+
 struct RendererData {
   std::string vertShaderPath;
   std::string fragShaderPath;
+  std::string clusterShaderPath;
+  std::string depthVertShaderPath;
+  std::string shadowVertShaderPath;
   VulkanContext context;
   Swapchain swapchain;
-  RenderPass renderPass;
-  Pipeline pipeline;
+  // Present wait, frame limiter and input to present latency
+  PresentPacer presentPacer;
+  // Rebuilt every frame, the main pass renders into the swapchain image
+  // with a transient depth buffer
+  RenderGraph renderGraph;
+  VkFormat depthFormat;
+  // Compatible with the main pass, what pipelines are built against.
+  // VK_NULL_HANDLE with dynamic rendering.
+  VkRenderPass mainRenderPass;
+  // Depth only, what the depth prepass pipelines are built against
+  VkRenderPass depthRenderPass;
+  // Depth only in the shadow map format
+  VkRenderPass shadowRenderPass;
+  PipelineCache pipelineCache;
+  PipelineManager pipelineManager;
+  ShaderId vertShader;
+  ShaderId fragShader;
+  ShaderId clusterShader;
+  ShaderId depthVertShader;
+  ShaderId shadowVertShader;
+  // Lays down depth for opaque draws first, the main pass then shades each
+  // pixel once with an equal depth test
+  bool depthPrepass = false;
+  PipelineStatistics pipelineStats;
+  GpuTimer gpuTimer;
+  // Scale of the scene's resolution, driven by gpuTimer
+  DynamicResolution dynamicResolution;
+  // Swapchain images take upscaling blits from an image in their format
+  bool upscaleSupported = false;
+  VkFilter upscaleFilter = VK_FILTER_LINEAR;
+  // Part of the color and depth targets the scene is rendered into this
+  // frame, the whole swapchain extent without dynamic resolution
+  VkExtent2D renderExtent{};
   VkSurfaceKHR surface;
   BufferManager bufferManager;
   CommandManager commandManager;
-  std::vector<UBOManager> uniformBufferManager;
+  UniformRingBuffer uniformRing;
+  UniformBufferObject cameraUniforms{};
+  // Lights submitted this frame and their per-cluster lists
+  ClusteredLighting lighting;
+  // The directional light and its shadow cascades
+  CascadedShadowMaps shadows;
   DescriptorManager descriptorManager;
-  std::vector<VkDescriptorSet> descriptorSets;
   VulkanSyncManager syncManager;
+  // Destroys what frames in flight may still use once they have finished
+  DeletionQueue deletionQueue;
+  // Set by resizes, out of date presents and present policy changes,
+  // BeginDraw recreates
   bool framebufferResized = false;
+  SwapchainStats swapchainStats;
   struct {
     uint32_t flightCurrentFrame;
     uint32_t swapChainImageIndex;
     VkCommandBuffer commandBuffer;
+    // Set when the frame graph is built
+    uint32_t cameraOffset;
+    LightBufferRange lights;
     // Sync
     VkSemaphore adquireSemaphore;
+    // First use of the swapchain image, what the acquire wait blocks
+    VkPipelineStageFlags2 acquireWaitStage;
     VkSemaphore submitSemaphore;
-    VkFence frameFence;
   } frameData;
+  // Applied at the start of the next frame
+  uint32_t requestedFramesInFlight;
   ObjManager objectManager;
 
   // Draw queue for batch rendering
-  std::vector<uint32_t> drawQueue;
+  struct DrawCommand {
+    uint32_t objID;
+    PipelineState state;
+    glm::mat4 transform;
+    VkPipeline pipeline;
+    // Set when the draw is part of the depth prepass
+    VkPipeline depthPipeline;
+  };
+  std::vector<DrawCommand> drawQueue;
+  // Drawn into the shadow cascades only, never sorted
+  std::vector<DrawCommand> shadowDrawQueue;
+  // Opaque draws of the frame and the shadow only ones, and the draw each
+  // came from
+  std::vector<ShadowCaster> shadowCasters;
+  std::vector<const DrawCommand *> shadowCasterDraws;
+  // Sort keys of drawQueue and what PrepareDraws orders it with
+  std::vector<uint64_t> drawSortKeys;
+  std::vector<uint32_t> drawOrder;
+  std::vector<DrawCommand> sortedDraws;
+  DrawSorter drawSorter;
+  // Per-frame ids of the pipelines in drawQueue, for the sort keys
+  std::unordered_map<VkPipeline, uint32_t> pipelineSortIds;
+  DrawStats drawStats;
   Texture whiteTexture;
+
+  Core::ThreadPool threadPool;
+  TextureLoader textureLoader;
+  // Bound through the per-frame descriptor set, whiteTexture stands in
+  // until it is resident
+  std::optional<TextureHandle> activeTexture;
 };
 
 class Renderer {
 public:
   static void Init(const std::string &vertShaderPath,
-                   const std::string &fragShaderPath);
+                   const std::string &fragShaderPath,
+                   const std::string &clusterShaderPath,
+                   const std::string &depthVertShaderPath,
+                   const std::string &shadowVertShaderPath);
   [[nodiscard]] static uint32_t addObject(RenderObject &obj);
+  // Object space, for culling and picking
+  static AABB GetObjectBounds(uint32_t objID);
+  // Streamed textures keep only the mip levels requested through
+  // RequestTextureDetail resident, within the texture budget
+  [[nodiscard]] static TextureHandle LoadTexture(const std::string &path,
+                                                 bool streamed = false);
+  static void SetTexture(TextureHandle texture);
+  static void RequestTextureDetail(TextureHandle texture, float screenPixels);
+  static void SetTextureBudget(VkDeviceSize bytes);
   static void UpdateUniformBuffer(Camera camera);
-  static void BeginDraw();
+  // False when there is nothing to draw to (minimized window), skip the
+  // frame's draws and EndDraw
+  [[nodiscard]] static bool BeginDraw();
   static void EndDraw();
-  static void DrawObject(uint32_t objID);
+  // `transform` is object to world, sent as push constants
+  static void DrawObject(uint32_t objID,
+                         const PipelineState &state = PipelineState::opaque(),
+                         const glm::mat4 &transform = glm::mat4(1.0f));
+  // Every node with a mesh, at the world transforms of the last update()
+  static void SubmitScene(const SceneGraph &scene);
+  // Opaque objects outside the view that still cast shadows into it
+  static void DrawShadowCaster(
+      uint32_t objID, const PipelineState &state = PipelineState::opaque(),
+      const glm::mat4 &transform = glm::mat4(1.0f));
+  // Every entity with mesh, transform and material components. The ones
+  // whose visibility component says they are culled only cast shadows.
+  static void SubmitWorld(Core::World &world);
+  // Lights for the current frame, up to MAX_LIGHTS point and spot lights.
+  // One directional light, the only one casting shadows.
+  static void SubmitLight(const Light &light);
   static void SetClearColor(const glm::vec3 &color);
   static void Cleanup();
   static void OnFrameBufferResize();
+  // 1 to MAX_FRAMES_IN_FLIGHT, fewer trades throughput for latency. Takes
+  // effect next frame after the GPU has drained.
+  static void SetFramesInFlight(uint32_t count);
+  static uint32_t GetFramesInFlight();
+  static const SwapchainStats &GetSwapchainStats();
+  // Opaque filled draws go through a depth only pass first. Takes effect
+  // next frame.
+  static void SetDepthPrepass(bool enabled);
+  static bool IsDepthPrepassEnabled();
+  // Of the last finished frame, empty without pipeline statistics queries
+  static std::optional<uint64_t> GetFragmentInvocations();
+  // Cascades rendered and caster draws of the last frame recorded
+  static const CascadedShadowMaps::Stats &GetShadowStats();
+  // The scene is rendered offscreen at a scale picked from the GPU frame
+  // time and blitted to the swapchain. Stays at full resolution when the
+  // swapchain images cannot be blitted to.
+  static void SetDynamicResolution(const DynamicResolutionSettings &settings);
+  static const DynamicResolutionSettings &GetDynamicResolution();
+  // Of the frame being recorded, 1 without dynamic resolution
+  static float GetResolutionScale();
+  // Of the last finished frame, empty without timestamp queries
+  static std::optional<double> GetGpuFrameMs();
+  // Present mode and image count apply with the swapchain recreated at the
+  // start of the next frame, the frame limiter and present waits right away
+  static void SetPresentPolicy(const PresentPolicy &policy);
+  static const PresentPolicy &GetPresentPolicy();
+  // Latency under the current policy, what it actually got
+  static const PresentStats &GetPresentStats();
+  // Of the last recorded frame
+  static const DrawStats &GetDrawStats();
   static inline RendererData &GetData() { return s_Data; }
 
 private:
@@ -68,7 +238,43 @@ private:
   static void CreateIndexBuffer();
   static void RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                   uint32_t imageIndex);
+  static void BuildFrameGraph(uint32_t imageIndex);
+  // Resolves the pipelines of every queued draw and sorts them by their
+  // sort keys
+  static void PrepareDraws();
+  static void RecordLightCulling(VkCommandBuffer commandBuffer);
+  static void RecordDepthPrepass(VkCommandBuffer commandBuffer);
+  static void RecordShadowCascade(VkCommandBuffer commandBuffer,
+                                  uint32_t cascade);
+  static void RecordMainPass(VkCommandBuffer commandBuffer);
+  // Scales the rendered part of `source` onto the whole of `destination`
+  static void RecordUpscale(VkCommandBuffer commandBuffer, VkImage source,
+                            VkImage destination);
+  // Whether the swapchain can take the upscaling blit, and its filter
+  static void UpdateUpscaleSupport();
+  static void SetViewportAndScissor(VkCommandBuffer commandBuffer,
+                                    VkExtent2D extent);
+  // Push constants when the vertex shader declares the DrawConstants block,
+  // otherwise a copy of the camera uniforms with the transform applied
+  static void BindDrawTransform(VkCommandBuffer commandBuffer,
+                                const ShaderProgramLayout &layout,
+                                VkDescriptorSet frameSet,
+                                const glm::mat4 &transform);
+  // False while minimized, the resize stays pending
+  static bool RecreateSwapChain();
   static void InitVulkan();
+  static VkDescriptorSet
+  AllocateFrameDescriptorSet(const ShaderProgramLayout &layout);
+  // Camera uniforms only, for the depth only passes. The contents never
+  // change, so the set is cached rather than written every frame.
+  static VkDescriptorSet
+  GetCameraDescriptorSet(const ShaderProgramLayout &layout);
+  static PipelineKey MakePipelineKey(const PipelineState &state);
+  // Position only, no fragment shader, rasterizes like `state`
+  static PipelineKey MakeDepthOnlyPipelineKey(const PipelineState &state,
+                                              ShaderId vertShader,
+                                              VkRenderPass renderPass,
+                                              VkFormat depthFormat);
 
 private:
   static RendererData s_Data;
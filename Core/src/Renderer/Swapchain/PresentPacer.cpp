@@ -0,0 +1,140 @@
+#include "Swapchain/PresentPacer.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+// Blocking waits give up after this, e.g. while the window is hidden
+const uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
+
+// Sleeps overshoot by up to a scheduler tick, the limiter wakes this early
+// and spins the rest
+const std::chrono::microseconds LIMITER_SPIN_MARGIN(1500);
+
+double toMs(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+void PresentPacer::init(VulkanContext *p_context) {
+  mp_context = p_context;
+  if (mp_context->isPresentWaitEnabled()) {
+    m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+        vkGetDeviceProcAddr(mp_context->getDevice(), "vkWaitForPresentKHR"));
+  }
+  resetStats();
+}
+
+void PresentPacer::setPolicy(const PresentPolicy &policy) {
+  m_policy = policy;
+  m_nextFrameTime = {};
+  resetStats();
+}
+
+void PresentPacer::onSwapchainCreated(VkPresentModeKHR presentMode,
+                                      uint32_t imageCount) {
+  m_pending.clear();
+  m_stats.presentMode = presentMode;
+  m_stats.imageCount = imageCount;
+  resetStats();
+}
+
+uint64_t PresentPacer::nextPresentId() {
+  if (!m_waitForPresent)
+    return 0;
+  return ++m_lastPresentId;
+}
+
+void PresentPacer::presented(uint64_t presentId) {
+  if (presentId == 0) {
+    recordLatency(m_inputTime, Clock::now());
+    return;
+  }
+  m_pending.push_back({presentId, m_inputTime});
+}
+
+void PresentPacer::endFrame(VkSwapchainKHR swapChain) {
+  Clock::time_point waitStart = Clock::now();
+  if (m_waitForPresent && !m_pending.empty()) {
+    uint32_t maxQueued = m_policy.maxQueuedPresents;
+    if (maxQueued > 0 && m_pending.size() >= maxQueued) {
+      waitForPresent(swapChain, m_pending[m_pending.size() - maxQueued].id,
+                     PRESENT_WAIT_TIMEOUT_NS);
+    }
+
+    // Waiting on an id returns once it or any later one is displayed, so
+    // the oldest are retired first
+    while (!m_pending.empty() &&
+           waitForPresent(swapChain, m_pending.front().id, 0)) {
+      recordLatency(m_pending.front().inputTime, Clock::now());
+      m_pending.pop_front();
+    }
+  }
+  Clock::time_point limiterStart = Clock::now();
+  m_stats.presentWaitMs = toMs(limiterStart - waitStart);
+
+  limitFrameRate();
+  m_inputTime = Clock::now();
+  m_stats.limiterMs = toMs(m_inputTime - limiterStart);
+}
+
+void PresentPacer::skipFrame() {
+  m_inputTime = Clock::now();
+  m_nextFrameTime = {};
+}
+
+bool PresentPacer::waitForPresent(VkSwapchainKHR swapChain,
+                                  uint64_t presentId, uint64_t timeoutNs) {
+  VkResult result = m_waitForPresent(mp_context->getDevice(), swapChain,
+                                        presentId, timeoutNs);
+  if (result == VK_SUCCESS)
+    return true;
+  // Out of date or lost, these presents will never be reported
+  if (result != VK_TIMEOUT)
+    m_pending.clear();
+  return false;
+}
+
+void PresentPacer::limitFrameRate() {
+  if (m_policy.maxFrameRate <= 0.0f)
+    return;
+
+  auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / m_policy.maxFrameRate));
+  Clock::time_point now = Clock::now();
+
+  // A frame that ran over its slot starts the schedule over instead of
+  // rushing the following ones to catch up
+  if (m_nextFrameTime == Clock::time_point{} ||
+      now - m_nextFrameTime > period) {
+    m_nextFrameTime = now + period;
+    return;
+  }
+
+  if (m_nextFrameTime - now > LIMITER_SPIN_MARGIN)
+    std::this_thread::sleep_for(m_nextFrameTime - now - LIMITER_SPIN_MARGIN);
+  while (Clock::now() < m_nextFrameTime)
+    std::this_thread::yield();
+
+  m_nextFrameTime += period;
+}
+
+void PresentPacer::recordLatency(Clock::time_point inputTime,
+                                 Clock::time_point now) {
+  double latencyMs = toMs(now - inputTime);
+  m_stats.samples++;
+  m_stats.lastLatencyMs = latencyMs;
+  m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, latencyMs);
+  m_latencySumMs += latencyMs;
+  m_stats.averageLatencyMs = m_latencySumMs / m_stats.samples;
+}
+
+void PresentPacer::resetStats() {
+  m_stats.measuresDisplay = m_waitForPresent != nullptr;
+  m_stats.samples = 0;
+  m_stats.lastLatencyMs = 0.0;
+  m_stats.averageLatencyMs = 0.0;
+  m_stats.maxLatencyMs = 0.0;
+  m_latencySumMs = 0.0;
+}
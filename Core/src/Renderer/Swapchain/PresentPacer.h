@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Swapchain/Swapchain.h"
+#include "vulkan/vulkan_core.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+struct PresentPolicy {
+  // Falls back to FIFO when the surface lacks it
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  // Swapchain images, 0 for one more than the surface minimum
+  uint32_t imageCount = 0;
+  // CPU side frame rate cap, 0 for none
+  float maxFrameRate = 0.0f;
+  // With present wait, presents allowed to be queued ahead of the display
+  // before the next frame samples its input. 0 never waits.
+  uint32_t maxQueuedPresents = 0;
+};
+
+// Input to present latency under the current policy, since it was set or
+// the swapchain was last created
+struct PresentStats {
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  uint32_t imageCount = 0;
+  // Up to the frame reaching the display with present wait, up to
+  // vkQueuePresentKHR returning otherwise
+  bool measuresDisplay = false;
+  uint32_t samples = 0;
+  double lastLatencyMs = 0.0;
+  double averageLatencyMs = 0.0;
+  double maxLatencyMs = 0.0;
+  // Last frame, main thread
+  double limiterMs = 0.0;
+  double presentWaitMs = 0.0;
+};
+
+// Paces the main thread after each present. A frame's input is taken to be
+// sampled when endFrame() returns, which is right before the application
+// polls its events for the next frame.
+//
+// With VK_KHR_present_wait every present is tagged with an id, presents
+// that have reached the display are retired at the end of each frame and
+// their latency recorded then. That is up to a frame late unless the
+// policy waits on them anyway.
+class PresentPacer {
+public:
+  void init(VulkanContext *p_context);
+
+  // Resets the stats. The present mode and image count are the
+  // swapchain's business, they apply once it is recreated.
+  void setPolicy(const PresentPolicy &policy);
+  const PresentPolicy &getPolicy() const { return m_policy; }
+
+  // Presents pending on the previous swapchain are dropped
+  void onSwapchainCreated(VkPresentModeKHR presentMode, uint32_t imageCount);
+
+  // For the VkPresentIdKHR of the next present, 0 without present wait
+  uint64_t nextPresentId();
+  // After vkQueuePresentKHR, whatever it returned
+  void presented(uint64_t presentId);
+  // After presenting: waits on the display as the policy says, then on
+  // the frame limiter
+  void endFrame(VkSwapchainKHR swapChain);
+  // Nothing was presented this frame, the latency clock starts over
+  void skipFrame();
+
+  const PresentStats &getStats() const { return m_stats; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PendingPresent {
+    uint64_t id;
+    Clock::time_point inputTime;
+  };
+
+  // False on timeout, pending presents are dropped on errors
+  bool waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId,
+                      uint64_t timeoutNs);
+  void limitFrameRate();
+  void recordLatency(Clock::time_point inputTime, Clock::time_point now);
+  void resetStats();
+
+private:
+  VulkanContext *mp_context;
+  PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+
+  PresentPolicy m_policy;
+  PresentStats m_stats;
+
+  // Ids only grow, across swapchains as well
+  uint64_t m_lastPresentId = 0;
+  std::deque<PendingPresent> m_pending;
+  Clock::time_point m_inputTime = Clock::now();
+  // Frame limiter deadline, empty until it first runs
+  Clock::time_point m_nextFrameTime{};
+  double m_latencySumMs = 0.0;
+};
@@ -1,20 +1,17 @@
 #include "Swapchain.h"
 #include "Common/Images/CreateImage.h"
-#include "Common/MemoryType/MemoryType.h"
 #include "Core/Application.h"
 #include <algorithm>
-#include <array>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
+#include <utility>
 
 void Swapchain::init(VulkanContext *p_context) {
   mp_context = p_context;
 
   // createSwapChain();
   // createImageViews();
-  // createFramebuffers(renderPass);
-  // createDepthResources();
 }
 
 void Swapchain::shutdown() { cleanupSwapChain(); }
@@ -29,7 +26,7 @@ void Swapchain::createImageViews() {
   }
 }
 
-void Swapchain::createSwapChain() {
+void Swapchain::createSwapChain(VkSwapchainKHR oldSwapChain) {
   SwapChainSupportDetails swapChainSupport = querySwapChainSupport(
       mp_context->getPhysicalDevice(), mp_context->getSurface());
 
@@ -39,7 +36,11 @@ void Swapchain::createSwapChain() {
       chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  uint32_t imageCount = m_preferredImageCount != 0
+                            ? m_preferredImageCount
+                            : swapChainSupport.capabilities.minImageCount + 1;
+  imageCount =
+      std::max(imageCount, swapChainSupport.capabilities.minImageCount);
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -54,7 +55,12 @@ void Swapchain::createSwapChain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // Transfer destination as well when possible, for upscaling blits
+  m_swapChainImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (swapChainSupport.capabilities.supportedUsageFlags &
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+    m_swapChainImageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  createInfo.imageUsage = m_swapChainImageUsage;
 
   QueueFamilyIndices indices =
       mp_context->findQueueFamilies(mp_context->getPhysicalDevice());
@@ -73,6 +79,9 @@ void Swapchain::createSwapChain() {
   createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   createInfo.presentMode = presentMode;
   createInfo.clipped = VK_TRUE;
+  // Lets the driver reuse the old images' memory, presents already queued
+  // on the old swapchain still complete
+  createInfo.oldSwapchain = oldSwapChain;
 
   if (vkCreateSwapchainKHR(mp_context->getDevice(), &createInfo, nullptr,
                            &m_swapChain) != VK_SUCCESS) {
@@ -87,6 +96,7 @@ void Swapchain::createSwapChain() {
 
   m_swapChainImageFormat = surfaceFormat.format;
   m_swapChainExtent = extent;
+  m_presentMode = presentMode;
 }
 
 VkSurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(
@@ -104,11 +114,12 @@ VkSurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(
 VkPresentModeKHR Swapchain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
   for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+    if (availablePresentMode == m_preferredPresentMode) {
       return availablePresentMode;
     }
   }
 
+  // The only mode every surface has to support
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -137,14 +148,6 @@ Swapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
 }
 
 void Swapchain::cleanupSwapChain() {
-  vkDestroyImageView(mp_context->getDevice(), m_depthImageView, nullptr);
-  vkDestroyImage(mp_context->getDevice(), m_depthImage, nullptr);
-  vkFreeMemory(mp_context->getDevice(), m_depthImageMemory, nullptr);
-
-  for (auto framebuffer : m_swapChainFramebuffers) {
-    vkDestroyFramebuffer(mp_context->getDevice(), framebuffer, nullptr);
-  }
-
   for (auto imageView : m_swapChainImageViews) {
     vkDestroyImageView(mp_context->getDevice(), imageView, nullptr);
   }
@@ -152,38 +155,18 @@ void Swapchain::cleanupSwapChain() {
   vkDestroySwapchainKHR(mp_context->getDevice(), m_swapChain, nullptr);
 }
 
-void Swapchain::recreateSwapChain(VkRenderPass &renderPass) {
-  int width = 0, height = 0;
+bool Swapchain::recreateSwapChain(RetiredSwapchain &retired) {
   glm::vec2 size = Core::Application::Get().getFramebufferSize();
-  width = size.x;
-  height = size.y;
-  while (width == 0 || height == 0) {
-    glm::vec2 size = Core::Application::Get().getFramebufferSize();
-    width = size.x;
-    height = size.y;
-
-    glfwWaitEvents();
-  }
+  if (size.x == 0 || size.y == 0)
+    return false;
 
-  vkDeviceWaitIdle(mp_context->getDevice());
+  retired.swapChain = m_swapChain;
+  retired.imageViews = std::move(m_swapChainImageViews);
+  m_swapChainImageViews.clear();
 
-  cleanupSwapChain();
-  createSwapChain();
+  createSwapChain(retired.swapChain);
   createImageViews();
-  createDepthResources();
-  createFramebuffers(renderPass);
-}
-
-void Swapchain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat(mp_context);
-
-  createImage(mp_context, m_swapChainExtent.width, m_swapChainExtent.height,
-              depthFormat, VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage,
-              m_depthImageMemory);
-  m_depthImageView = createImageView(mp_context, m_depthImage, depthFormat,
-                                     VK_IMAGE_ASPECT_DEPTH_BIT);
+  return true;
 }
 
 VkFormat Swapchain::findDepthFormat(VulkanContext *p_context) {
@@ -214,26 +197,3 @@ VkFormat Swapchain::findSupportedFormat(VulkanContext *p_context,
 
   throw std::runtime_error("failed to find supported format!");
 }
-
-void Swapchain::createFramebuffers(VkRenderPass &renderPass) {
-  m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
-
-  for (size_t i = 0; i < getSwapChainImageViews().size(); i++) {
-    std::array<VkImageView, 2> attachments = {getSwapChainImageViews()[i],
-                                              m_depthImageView};
-
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
-    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = getSwapChainExtent().width;
-    framebufferInfo.height = getSwapChainExtent().height;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(mp_context->getDevice(), &framebufferInfo, nullptr,
-                            &getSwapChainFramebuffers()[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create framebuffer!");
-    }
-  }
-}
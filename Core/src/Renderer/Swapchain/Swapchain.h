@@ -2,6 +2,15 @@
 #include "Common/SwapchainSupportDetails.h"
 #include "Core/VulkanContext.h"
 #include "vulkan/vulkan_core.h"
+#include <vector>
+
+// What a recreation replaced. Frames in flight may still be presenting to
+// it, the caller destroys it once they have finished.
+struct RetiredSwapchain {
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+  std::vector<VkImageView> imageViews;
+};
+
 class Swapchain {
 public:
   void init(VulkanContext *p_context);
@@ -18,27 +27,39 @@ public:
 
   VkExtent2D getSwapChainExtent() const { return m_swapChainExtent; }
 
-  const std::vector<VkImageView> &getSwapChainImageViews() const {
-    return m_swapChainImageViews;
+  VkImageUsageFlags getSwapChainImageUsage() const {
+    return m_swapChainImageUsage;
   }
 
-  std::vector<VkFramebuffer> &getSwapChainFramebuffers() {
-    return m_swapChainFramebuffers;
+  // What the current swapchain was created with
+  VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+
+  // Take effect on the next creation. The mode falls back to FIFO when the
+  // surface lacks it, an image count of 0 picks one more than the surface
+  // minimum and any other count is clamped to the surface limits.
+  void setPreferredPresentMode(VkPresentModeKHR presentMode) {
+    m_preferredPresentMode = presentMode;
+  }
+  void setPreferredImageCount(uint32_t imageCount) {
+    m_preferredImageCount = imageCount;
   }
 
+  const std::vector<VkImageView> &getSwapChainImageViews() const {
+    return m_swapChainImageViews;
+  }
 
-  void recreateSwapChain(VkRenderPass &renderPass);
+  // Hands the current swapchain to the driver as oldSwapchain, without
+  // waiting on the device. Returns false, leaving everything untouched,
+  // while the window is minimized. Depth and framebuffers live in the
+  // render graph, they have to be dropped there as well.
+  bool recreateSwapChain(RetiredSwapchain &retired);
 
   VkFormat findDepthFormat(VulkanContext *p_context);
 
-  void createSwapChain();
+  void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 
   void createImageViews();
 
-  void createDepthResources();
-
-  void createFramebuffers(VkRenderPass &renderPass);
-
 private:
   VkSurfaceFormatKHR chooseSwapSurfaceFormat(
       const std::vector<VkSurfaceFormatKHR> &availableFormats);
@@ -58,7 +79,7 @@ private:
 private:
   VulkanContext *mp_context = nullptr;
 
-  VkSwapchainKHR m_swapChain;
+  VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
 
   std::vector<VkImage> m_swapChainImages;
 
@@ -66,13 +87,12 @@ private:
 
   VkExtent2D m_swapChainExtent;
 
-  std::vector<VkImageView> m_swapChainImageViews;
-
-  std::vector<VkFramebuffer> m_swapChainFramebuffers;
+  VkImageUsageFlags m_swapChainImageUsage = 0;
 
-  VkImage m_depthImage;
+  VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
-  VkDeviceMemory m_depthImageMemory;
+  VkPresentModeKHR m_preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  uint32_t m_preferredImageCount = 0;
 
-  VkImageView m_depthImageView;
+  std::vector<VkImageView> m_swapChainImageViews;
 };
@@ -1,11 +1,14 @@
 #include "Texture.h"
 #include "Common/CommandUtils/CommandUtils.h"
 #include "Common/Images/CreateImage.h"
+#include "Common/Images/KTX2.h"
 #include "Swapchain/Swapchain.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <stb_image.h>
 #include <stdexcept>
+#include <vector>
 
 void Texture::init(VulkanContext *p_context, CommandManager *p_cmdManager) {
   mp_context = p_context;
@@ -14,7 +17,10 @@ void Texture::init(VulkanContext *p_context, CommandManager *p_cmdManager) {
 
 void Texture::loadFromFile(VulkanContext *p_context, BufferManager *p_bufferMan,
                            const std::string &path) {
-  createTextureImage(p_context, p_bufferMan, path);
+  if (isKTX2Path(path))
+    createTextureImageFromKTX2(p_context, p_bufferMan, path);
+  else
+    createTextureImage(p_context, p_bufferMan, path);
   createTextureImageView(p_context);
   createTextureSampler(p_context);
 }
@@ -116,11 +122,125 @@ void Texture::createTextureImage(VulkanContext *p_context,
   vkFreeMemory(p_context->getDevice(), stagingBufferMemory, nullptr);
 }
 
+void Texture::createTextureImageFromKTX2(VulkanContext *p_context,
+                                         BufferManager *p_bufferManager,
+                                         const std::string &path) {
+  KTX2Reader reader;
+  reader.open(path);
+  const KTX2Texture &ktx = reader.getTexture();
+
+  VkFormatProperties formatProps;
+  vkGetPhysicalDeviceFormatProperties(p_context->getPhysicalDevice(),
+                                      static_cast<VkFormat>(ktx.vkFormat),
+                                      &formatProps);
+  if (!(formatProps.optimalTilingFeatures &
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+    throw std::runtime_error("texture format not supported by device! " +
+                             path);
+  }
+
+  // Pack every level into one staging buffer, blocks are uploaded as is
+  VkDeviceSize stagingSize = 0;
+  std::vector<VkBufferImageCopy> regions =
+      getKTX2CopyRegions(ktx, 0, 0, stagingSize);
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  p_bufferManager->createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                stagingBuffer, stagingBufferMemory);
+
+  void *data;
+  vkMapMemory(p_context->getDevice(), stagingBufferMemory, 0, stagingSize, 0,
+              &data);
+  for (uint32_t level = 0; level < ktx.levelCount; level++) {
+    reader.readLevel(level,
+                     static_cast<char *>(data) + regions[level].bufferOffset);
+  }
+  vkUnmapMemory(p_context->getDevice(), stagingBufferMemory);
+
+  m_format = static_cast<VkFormat>(ktx.vkFormat);
+  m_mipLevels = ktx.levelCount;
+
+  createImage(p_context, ktx.width, ktx.height, m_format,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textureImage,
+              m_textureImageMemory, m_mipLevels);
+
+  transitionImageLayout(m_textureImage, m_format, VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  p_bufferManager->copyBufferToImage(stagingBuffer, m_textureImage, regions);
+  transitionImageLayout(m_textureImage, m_format,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  vkDestroyBuffer(p_context->getDevice(), stagingBuffer, nullptr);
+  vkFreeMemory(p_context->getDevice(), stagingBufferMemory, nullptr);
+}
+
+void Texture::create(VkFormat format, uint32_t width, uint32_t height,
+                     uint32_t mipLevels) {
+  m_format = format;
+  m_mipLevels = mipLevels;
+
+  createImage(mp_context, width, height, m_format, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textureImage,
+              m_textureImageMemory, m_mipLevels);
+  createTextureImageView(mp_context);
+  createTextureSampler(mp_context);
+}
+
+void Texture::recordUpload(VkCommandBuffer cmd, VkBuffer stagingBuffer,
+                           const std::vector<VkBufferImageCopy> &regions) {
+  recordLayoutTransition(cmd, m_textureImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  vkCmdCopyBufferToImage(cmd, stagingBuffer, m_textureImage,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         static_cast<uint32_t>(regions.size()),
+                         regions.data());
+  recordLayoutTransition(cmd, m_textureImage,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+std::vector<VkBufferImageCopy>
+Texture::getKTX2CopyRegions(const KTX2Texture &ktx, uint32_t baseLevel,
+                            VkDeviceSize baseOffset,
+                            VkDeviceSize &stagingSize) {
+  std::vector<VkBufferImageCopy> regions(ktx.levelCount - baseLevel);
+  stagingSize = 0;
+  for (uint32_t level = baseLevel; level < ktx.levelCount; level++) {
+    stagingSize = (stagingSize + 15) & ~VkDeviceSize(15);
+
+    VkBufferImageCopy &region = regions[level - baseLevel];
+    region = {};
+    region.bufferOffset = baseOffset + stagingSize;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = level - baseLevel;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {std::max(ktx.width >> level, 1u),
+                          std::max(ktx.height >> level, 1u), 1};
+
+    stagingSize += ktx.levels[level].byteLength;
+  }
+  return regions;
+}
+
 void Texture::transitionImageLayout(VkImage image, VkFormat format,
                                     VkImageLayout oldLayout,
                                     VkImageLayout newLayout) {
   OneTimeSubmit submit(mp_cmdManager);
+  recordLayoutTransition(submit.get(), image, oldLayout, newLayout);
+}
 
+void Texture::recordLayoutTransition(VkCommandBuffer cmd, VkImage image,
+                                     VkImageLayout oldLayout,
+                                     VkImageLayout newLayout) {
   VkImageMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.oldLayout = oldLayout;
@@ -130,7 +250,7 @@ void Texture::transitionImageLayout(VkImage image, VkFormat format,
   barrier.image = image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = m_mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
 
@@ -155,14 +275,14 @@ void Texture::transitionImageLayout(VkImage image, VkFormat format,
     throw std::invalid_argument("unsupported layout transition!");
   }
 
-  vkCmdPipelineBarrier(submit.get(), sourceStage, destinationStage, 0, 0,
+  vkCmdPipelineBarrier(cmd, sourceStage, destinationStage, 0, 0,
                        nullptr, 0, nullptr, 1, &barrier);
 }
 
 void Texture::createTextureImageView(VulkanContext *p_context) {
   m_textureImageView =
-      createImageView(p_context, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-                      VK_IMAGE_ASPECT_COLOR_BIT);
+      createImageView(p_context, m_textureImage, m_format,
+                      VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels);
 }
 
 void Texture::createTextureSampler(VulkanContext *p_context) {
@@ -183,6 +303,8 @@ void Texture::createTextureSampler(VulkanContext *p_context) {
   samplerInfo.compareEnable = VK_FALSE;
   samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
   samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = static_cast<float>(m_mipLevels);
 
   if (vkCreateSampler(p_context->getDevice(), &samplerInfo, nullptr,
                       &m_textureSampler) != VK_SUCCESS) {
@@ -1,9 +1,11 @@
 #pragma once
 #include "BufferManager/BufferManager.h"
 #include "Commands/CommandManager.h"
+#include "Common/Images/KTX2.h"
 #include "Swapchain/Swapchain.h"
 #include "vulkan/vulkan_core.h"
 #include <string>
+#include <vector>
 
 class Texture {
 public:
@@ -11,6 +13,20 @@ public:
   void loadFromFile(VulkanContext *p_context, BufferManager *p_bufferMan,
                     const std::string &path);
   void createDefaultWhite(BufferManager *p_bufferMan);
+
+  // Creates the image, view and sampler with undefined contents, the texels
+  // are filled later by recordUpload on a caller owned command buffer
+  void create(VkFormat format, uint32_t width, uint32_t height,
+              uint32_t mipLevels);
+  void recordUpload(VkCommandBuffer cmd, VkBuffer stagingBuffer,
+                    const std::vector<VkBufferImageCopy> &regions);
+
+  // One region per level from `baseLevel` down, packed from `baseOffset` at
+  // 16 byte alignment. `baseLevel` becomes mip 0 of the destination image.
+  static std::vector<VkBufferImageCopy>
+  getKTX2CopyRegions(const KTX2Texture &ktx, uint32_t baseLevel,
+                     VkDeviceSize baseOffset, VkDeviceSize &stagingSize);
+
   VkImageView getImageView() { return m_textureImageView; }
   VkSampler getSampler() { return m_textureSampler; }
 
@@ -21,10 +37,17 @@ private:
                           BufferManager *p_bufferManger,
                           const std::string &path);
 
+  void createTextureImageFromKTX2(VulkanContext *p_context,
+                                  BufferManager *p_bufferManager,
+                                  const std::string &path);
+
   void createTextureImageView(VulkanContext *p_context);
 
   void transitionImageLayout(VkImage image, VkFormat format,
                              VkImageLayout oldLayout, VkImageLayout newLayout);
+  void recordLayoutTransition(VkCommandBuffer cmd, VkImage image,
+                              VkImageLayout oldLayout,
+                              VkImageLayout newLayout);
 
   void createTextureSampler(VulkanContext *p_context);
 
@@ -37,6 +60,8 @@ private:
   VkDeviceMemory m_textureImageMemory;
   VkImageView m_textureImageView;
   VkSampler m_textureSampler;
+  VkFormat m_format = VK_FORMAT_R8G8B8A8_SRGB;
+  uint32_t m_mipLevels = 1;
 
   VulkanContext *mp_context;
   CommandManager *mp_cmdManager;
@@ -0,0 +1,347 @@
+#include "TextureLoader.h"
+#include "Common/Images/KTX2.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stb_image.h>
+#include <stdexcept>
+
+// Satisfies the texel block alignment of every format the loader produces
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+// Base level request meaning "only the mip tail" for a first streamed load
+static const uint32_t MIP_TAIL_LEVEL = UINT32_MAX;
+
+void TextureLoader::init(VulkanContext *p_context,
+                         BufferManager *p_bufferManager,
+                         Core::ThreadPool *p_threadPool,
+                         Texture *p_placeholder,
+                         DeletionQueue *p_deletionQueue,
+                         VkDeviceSize stagingSize) {
+  mp_context = p_context;
+  mp_threadPool = p_threadPool;
+  mp_placeholder = p_placeholder;
+  mp_deletionQueue = p_deletionQueue;
+  m_frame = 0;
+  m_shuttingDown = false;
+
+  m_stagingRing.init(p_context, p_bufferManager, stagingSize);
+
+  QueueFamilyIndices queueFamilyIndices =
+      mp_context->findQueueFamilies(mp_context->getPhysicalDevice());
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+  if (vkCreateCommandPool(mp_context->getDevice(), &poolInfo, nullptr,
+                          &m_commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture upload command pool!");
+  }
+}
+
+void TextureLoader::shutdown() {
+  // Unblock workers waiting for staging space, then let the queue drain
+  m_shuttingDown = true;
+  m_stagingRing.abort();
+  mp_threadPool->waitIdle();
+
+  retireUploads(true);
+
+  for (TextureSlot &slot : m_slots) {
+    if (slot.texture)
+      slot.texture->cleanup();
+  }
+  m_slots.clear();
+  m_decoded.clear();
+
+  vkDestroyCommandPool(mp_context->getDevice(), m_commandPool, nullptr);
+  m_stagingRing.shutdown();
+}
+
+TextureHandle TextureLoader::load(const std::string &path, bool streamed) {
+  TextureHandle handle = static_cast<TextureHandle>(m_slots.size());
+
+  TextureSlot &slot = m_slots.emplace_back();
+  slot.path = path;
+  // Only KTX2 files carry levels that can be read on their own
+  slot.streamed = streamed && isKTX2Path(path);
+  slot.streaming = true;
+
+  uint32_t baseLevel = slot.streamed ? MIP_TAIL_LEVEL : 0;
+  mp_threadPool->submit(
+      [this, handle, path, baseLevel] { decode(handle, path, baseLevel); });
+  return handle;
+}
+
+void TextureLoader::requestDetail(TextureHandle handle, float screenPixels) {
+  m_residency.requestScreenSize(handle, screenPixels, m_frame);
+}
+
+Texture &TextureLoader::get(TextureHandle handle) {
+  if (handle < m_slots.size() && m_slots[handle].resident)
+    return *m_slots[handle].texture;
+  return *mp_placeholder;
+}
+
+bool TextureLoader::isResident(TextureHandle handle) const {
+  return handle < m_slots.size() && m_slots[handle].resident;
+}
+
+uint32_t TextureLoader::getResidentLevel(TextureHandle handle) const {
+  return isResident(handle) ? m_slots[handle].residentLevel : 0;
+}
+
+void TextureLoader::update() {
+  m_frame++;
+
+  retireUploads(false);
+  submitDecoded();
+  updateResidency();
+}
+
+void TextureLoader::decode(TextureHandle handle, const std::string &path,
+                           uint32_t baseLevel) {
+  if (m_shuttingDown)
+    return;
+
+  DecodedImage image{};
+  image.handle = handle;
+  image.baseLevel = baseLevel;
+
+  try {
+    bool decoded = isKTX2Path(path) ? decodeKTX2(path, baseLevel, image)
+                                    : decodeImage(path, image);
+    if (!decoded)
+      return;
+  } catch (const std::exception &e) {
+    std::cout << "Error loading texture " << path << ": " << e.what() << '\n';
+    image.failed = true;
+    // Nothing will copy out of it, later allocations queue behind it in the
+    // ring until it is released
+    if (image.staging.size != 0) {
+      m_stagingRing.release(image.staging);
+      image.staging = {};
+    }
+  }
+
+  std::lock_guard lock(m_decodedMutex);
+  m_decoded.push_back(std::move(image));
+}
+
+bool TextureLoader::decodeKTX2(const std::string &path, uint32_t baseLevel,
+                               DecodedImage &image) {
+  KTX2Reader reader;
+  reader.open(path);
+  const KTX2Texture &ktx = reader.getTexture();
+  if (baseLevel == MIP_TAIL_LEVEL)
+    baseLevel = TextureResidency::tailLevel(ktx);
+  baseLevel = std::min(baseLevel, ktx.levelCount - 1);
+  image.baseLevel = baseLevel;
+
+  VkFormatProperties formatProps;
+  vkGetPhysicalDeviceFormatProperties(mp_context->getPhysicalDevice(),
+                                      static_cast<VkFormat>(ktx.vkFormat),
+                                      &formatProps);
+  if (!(formatProps.optimalTilingFeatures &
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+    throw std::runtime_error("texture format not supported by device!");
+  }
+
+  VkDeviceSize stagingSize = 0;
+  image.regions =
+      Texture::getKTX2CopyRegions(ktx, baseLevel, 0, stagingSize);
+  if (stagingSize > m_stagingRing.getCapacity())
+    throw std::runtime_error("texture does not fit in the staging ring!");
+  if (!m_stagingRing.allocate(stagingSize, STAGING_ALIGNMENT, image.staging))
+    return false;
+
+  for (uint32_t level = baseLevel; level < ktx.levelCount; level++) {
+    VkBufferImageCopy &region = image.regions[level - baseLevel];
+    reader.readLevel(level, static_cast<char *>(image.staging.mapped) +
+                                region.bufferOffset);
+    region.bufferOffset += image.staging.offset;
+  }
+
+  image.format = static_cast<VkFormat>(ktx.vkFormat);
+  image.width = std::max(ktx.width >> baseLevel, 1u);
+  image.height = std::max(ktx.height >> baseLevel, 1u);
+  image.mipLevels = ktx.levelCount - baseLevel;
+  image.ktx = ktx;
+  return true;
+}
+
+bool TextureLoader::decodeImage(const std::string &path, DecodedImage &image) {
+  int texWidth, texHeight, texChannels;
+  stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels,
+                              STBI_rgb_alpha);
+  if (!pixels) {
+    throw std::runtime_error("failed to load texture image!");
+  }
+
+  VkDeviceSize imageSize = VkDeviceSize(texWidth) * texHeight * 4;
+  if (imageSize > m_stagingRing.getCapacity()) {
+    stbi_image_free(pixels);
+    throw std::runtime_error("texture does not fit in the staging ring!");
+  }
+  if (!m_stagingRing.allocate(imageSize, STAGING_ALIGNMENT, image.staging)) {
+    stbi_image_free(pixels);
+    return false;
+  }
+
+  memcpy(image.staging.mapped, pixels, static_cast<size_t>(imageSize));
+  stbi_image_free(pixels);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = image.staging.offset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {static_cast<uint32_t>(texWidth),
+                        static_cast<uint32_t>(texHeight), 1};
+  image.regions = {region};
+
+  image.format = VK_FORMAT_R8G8B8A8_SRGB;
+  image.width = static_cast<uint32_t>(texWidth);
+  image.height = static_cast<uint32_t>(texHeight);
+  image.mipLevels = 1;
+  return true;
+}
+
+void TextureLoader::submitDecoded() {
+  std::vector<DecodedImage> decoded;
+  {
+    std::lock_guard lock(m_decodedMutex);
+    decoded = std::move(m_decoded);
+    m_decoded.clear();
+  }
+
+  UploadBatch batch{};
+  for (DecodedImage &image : decoded) {
+    if (!image.failed) {
+      batch.images.push_back(std::move(image));
+      continue;
+    }
+
+    // Keep what is resident and stop asking for the levels that failed
+    TextureSlot &slot = m_slots[image.handle];
+    slot.streaming = false;
+    if (slot.streamed && slot.resident && image.baseLevel < slot.residentLevel)
+      slot.finestLevel = image.baseLevel + 1;
+  }
+  if (batch.images.empty())
+    return;
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = m_commandPool;
+  allocInfo.commandBufferCount = 1;
+
+  if (vkAllocateCommandBuffers(mp_context->getDevice(), &allocInfo,
+                               &batch.cmd) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate texture upload commands!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(batch.cmd, &beginInfo);
+
+  for (const DecodedImage &image : batch.images) {
+    // Uploads are recorded by the loader, the texture never submits itself
+    auto texture = std::make_unique<Texture>();
+    texture->init(mp_context, nullptr);
+    texture->create(image.format, image.width, image.height, image.mipLevels);
+    texture->recordUpload(batch.cmd, m_stagingRing.getBuffer(),
+                          image.regions);
+    batch.textures.push_back(std::move(texture));
+  }
+
+  vkEndCommandBuffer(batch.cmd);
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(mp_context->getDevice(), &fenceInfo, nullptr,
+                    &batch.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture upload fence!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &batch.cmd;
+
+  if (vkQueueSubmit(mp_context->getGraphicsQueue(), 1, &submitInfo,
+                    batch.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit texture upload!");
+  }
+
+  m_uploads.push_back(std::move(batch));
+}
+
+void TextureLoader::retireUploads(bool wait) {
+  for (size_t i = 0; i < m_uploads.size();) {
+    UploadBatch &batch = m_uploads[i];
+
+    if (wait) {
+      vkWaitForFences(mp_context->getDevice(), 1, &batch.fence, VK_TRUE,
+                      UINT64_MAX);
+    } else if (vkGetFenceStatus(mp_context->getDevice(), batch.fence) !=
+               VK_SUCCESS) {
+      i++;
+      continue;
+    }
+
+    for (size_t j = 0; j < batch.images.size(); j++) {
+      const DecodedImage &image = batch.images[j];
+      TextureSlot &slot = m_slots[image.handle];
+
+      if (slot.texture)
+        mp_deletionQueue->enqueue(
+            [texture = std::shared_ptr<Texture>(std::move(slot.texture))] {
+              texture->cleanup();
+            });
+      else if (slot.streamed)
+        m_residency.track(image.handle, image.ktx);
+
+      slot.texture = std::move(batch.textures[j]);
+      slot.resident = true;
+      slot.streaming = false;
+      slot.residentLevel = image.baseLevel;
+
+      m_stagingRing.release(image.staging);
+    }
+
+    vkDestroyFence(mp_context->getDevice(), batch.fence, nullptr);
+    vkFreeCommandBuffers(mp_context->getDevice(), m_commandPool, 1,
+                         &batch.cmd);
+    m_uploads.erase(m_uploads.begin() + i);
+  }
+}
+
+void TextureLoader::updateResidency() {
+  m_residency.resolve(m_frame);
+
+  for (TextureHandle handle = 0; handle < m_slots.size(); handle++) {
+    TextureSlot &slot = m_slots[handle];
+    if (!slot.streamed || !slot.resident || slot.streaming)
+      continue;
+
+    uint32_t target =
+        std::max(m_residency.getTargetLevel(handle), slot.finestLevel);
+    if (target == slot.residentLevel)
+      continue;
+
+    // Rebuild the whole level range, the coarse levels are small next to
+    // the level being added and this keeps the live image untouched
+    slot.streaming = true;
+    std::string path = slot.path;
+    mp_threadPool->submit(
+        [this, handle, path, target] { decode(handle, path, target); });
+  }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "BufferManager/BufferManager.h"
+#include "BufferManager/StagingRing.h"
+#include "Core/ThreadPool.h"
+#include "Swapchain/Swapchain.h"
+#include "Texture/Texture.h"
+#include "Texture/TextureResidency.h"
+#include "VulkanSyncObjects/DeletionQueue.h"
+#include "vulkan/vulkan_core.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using TextureHandle = uint32_t;
+
+// Decodes textures on the thread pool straight into a staging ring and
+// uploads them without blocking the frame. Until a texture is resident,
+// get() hands out the placeholder so callers can bind it right away.
+//
+// Streamed KTX2 textures start with only their mip tail resident. Finer
+// levels are paged in and out as TextureResidency decides, by building a
+// replacement image with the new level range and swapping it in once its
+// upload has completed.
+class TextureLoader {
+public:
+  void init(VulkanContext *p_context, BufferManager *p_bufferManager,
+            Core::ThreadPool *p_threadPool, Texture *p_placeholder,
+            DeletionQueue *p_deletionQueue,
+            VkDeviceSize stagingSize = 64 * 1024 * 1024);
+  void shutdown();
+
+  // Returns immediately, decoding happens on a worker
+  TextureHandle load(const std::string &path, bool streamed = false);
+
+  // Main thread, once per frame after the frame timeline wait: submits
+  // finished decodes, retires completed uploads and applies residency
+  void update();
+
+  // Streamed textures only: the texture covers `screenPixels` this frame
+  void requestDetail(TextureHandle handle, float screenPixels);
+  void setStreamingBudget(VkDeviceSize bytes) { m_residency.setBudget(bytes); }
+
+  Texture &get(TextureHandle handle);
+  bool isResident(TextureHandle handle) const;
+  uint32_t getResidentLevel(TextureHandle handle) const;
+
+private:
+  struct DecodedImage {
+    TextureHandle handle;
+    bool failed = false;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    // Finest level of the source file held by this image
+    uint32_t baseLevel = 0;
+    KTX2Texture ktx;
+    StagingAllocation staging;
+    std::vector<VkBufferImageCopy> regions;
+  };
+
+  struct UploadBatch {
+    VkCommandBuffer cmd;
+    VkFence fence;
+    std::vector<DecodedImage> images;
+    std::vector<std::unique_ptr<Texture>> textures;
+  };
+
+  struct TextureSlot {
+    std::string path;
+    std::unique_ptr<Texture> texture;
+    bool resident = false;
+    bool streamed = false;
+    // A residency change is decoding or uploading
+    bool streaming = false;
+    uint32_t residentLevel = 0;
+    // Levels finer than this failed to load and are not requested again
+    uint32_t finestLevel = 0;
+  };
+
+  void decode(TextureHandle handle, const std::string &path,
+              uint32_t baseLevel);
+  bool decodeKTX2(const std::string &path, uint32_t baseLevel,
+                  DecodedImage &image);
+  bool decodeImage(const std::string &path, DecodedImage &image);
+
+  void submitDecoded();
+  void retireUploads(bool wait);
+  void updateResidency();
+
+private:
+  std::vector<TextureSlot> m_slots;
+
+  std::mutex m_decodedMutex;
+  std::vector<DecodedImage> m_decoded;
+
+  std::vector<UploadBatch> m_uploads;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+
+  uint64_t m_frame = 0;
+  // Replaced images stay alive until no frame in flight can sample them
+  DeletionQueue *mp_deletionQueue;
+
+  StagingRing m_stagingRing;
+  TextureResidency m_residency;
+  std::atomic<bool> m_shuttingDown = false;
+
+  VulkanContext *mp_context;
+  Core::ThreadPool *mp_threadPool;
+  Texture *mp_placeholder;
+};
@@ -0,0 +1,128 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Largest dimension of the level that is never evicted
+static const uint32_t MIP_TAIL_SIZE = 128;
+
+// Frames a request stays valid, keeps levels from thrashing while the camera
+// moves back and forth
+static const uint64_t REQUEST_LIFETIME = 120;
+
+void TextureResidency::track(uint32_t handle, const KTX2Texture &ktx) {
+  Entry entry;
+  entry.ktx = ktx;
+  entry.tailLevel = tailLevel(ktx);
+  entry.requestedLevel = entry.tailLevel;
+  entry.targetLevel = entry.tailLevel;
+  m_entries[handle] = std::move(entry);
+}
+
+void TextureResidency::untrack(uint32_t handle) { m_entries.erase(handle); }
+
+void TextureResidency::request(uint32_t handle, uint32_t level,
+                               uint64_t frame) {
+  auto it = m_entries.find(handle);
+  if (it == m_entries.end())
+    return;
+
+  Entry &entry = it->second;
+  level = std::min(level, entry.tailLevel);
+
+  // Keep the finest level asked for until that request expires
+  bool expired = frame - entry.requestFrame > REQUEST_LIFETIME;
+  if (expired || level <= entry.requestedLevel) {
+    entry.requestedLevel = level;
+    entry.requestFrame = frame;
+  }
+  entry.lastSeenFrame = frame;
+}
+
+void TextureResidency::requestScreenSize(uint32_t handle, float screenPixels,
+                                         uint64_t frame) {
+  auto it = m_entries.find(handle);
+  if (it == m_entries.end())
+    return;
+  request(handle, levelForScreenSize(it->second.ktx, screenPixels), frame);
+}
+
+void TextureResidency::resolve(uint64_t frame) {
+  std::vector<Entry *> entries;
+  entries.reserve(m_entries.size());
+
+  m_targetBytes = 0;
+  for (auto &[handle, entry] : m_entries) {
+    bool expired = frame - entry.requestFrame > REQUEST_LIFETIME;
+    entry.targetLevel = expired ? entry.tailLevel : entry.requestedLevel;
+    m_targetBytes += residentBytes(entry.ktx, entry.targetLevel);
+    entries.push_back(&entry);
+  }
+
+  if (m_targetBytes <= m_budget)
+    return;
+
+  std::sort(entries.begin(), entries.end(), [](Entry *a, Entry *b) {
+    return a->lastSeenFrame < b->lastSeenFrame;
+  });
+
+  // Drop one level at a time across all textures, oldest requests first, so
+  // a single texture is not pushed to its tail while others stay sharp
+  bool coarsened = true;
+  while (m_targetBytes > m_budget && coarsened) {
+    coarsened = false;
+    for (Entry *entry : entries) {
+      if (entry->targetLevel >= entry->tailLevel)
+        continue;
+
+      m_targetBytes -= entry->ktx.levels[entry->targetLevel].byteLength;
+      entry->targetLevel++;
+      coarsened = true;
+      if (m_targetBytes <= m_budget)
+        break;
+    }
+  }
+}
+
+uint32_t TextureResidency::getTargetLevel(uint32_t handle) const {
+  auto it = m_entries.find(handle);
+  return it == m_entries.end() ? 0 : it->second.targetLevel;
+}
+
+uint32_t TextureResidency::getTailLevel(uint32_t handle) const {
+  auto it = m_entries.find(handle);
+  return it == m_entries.end() ? 0 : it->second.tailLevel;
+}
+
+uint32_t TextureResidency::levelForScreenSize(const KTX2Texture &ktx,
+                                              float screenPixels) {
+  uint32_t size = std::max(ktx.width, ktx.height);
+  if (screenPixels <= 1.0f)
+    return ktx.levelCount - 1;
+
+  float level = std::floor(std::log2(size / screenPixels));
+  return static_cast<uint32_t>(
+      std::clamp(level, 0.0f, static_cast<float>(ktx.levelCount - 1)));
+}
+
+float TextureResidency::estimateScreenSize(float worldSize, float distance,
+                                          float fovY, float viewportHeight) {
+  float visibleHeight = 2.0f * std::max(distance, 0.001f) * std::tan(fovY / 2);
+  return worldSize / visibleHeight * viewportHeight;
+}
+
+uint32_t TextureResidency::tailLevel(const KTX2Texture &ktx) {
+  uint32_t level = 0;
+  while (level + 1 < ktx.levelCount &&
+         std::max(ktx.width >> level, ktx.height >> level) > MIP_TAIL_SIZE)
+    level++;
+  return level;
+}
+
+uint64_t TextureResidency::residentBytes(const KTX2Texture &ktx,
+                                         uint32_t baseLevel) {
+  uint64_t bytes = 0;
+  for (uint32_t level = baseLevel; level < ktx.levelCount; level++)
+    bytes += ktx.levels[level].byteLength;
+  return bytes;
+}
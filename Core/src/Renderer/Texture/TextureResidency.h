@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common/Images/KTX2.h"
+#include <cstdint>
+#include <unordered_map>
+
+// CPU side policy for streamed textures: turns per-frame detail requests
+// into a resident base mip level for each texture while keeping the sum of
+// resident levels under a fixed budget. The coarsest levels (the mip tail)
+// are always resident.
+class TextureResidency {
+public:
+  void setBudget(uint64_t bytes) { m_budget = bytes; }
+  uint64_t getBudget() const { return m_budget; }
+
+  void track(uint32_t handle, const KTX2Texture &ktx);
+  void untrack(uint32_t handle);
+
+  // `level` is the finest mip level the texture needs this frame
+  void request(uint32_t handle, uint32_t level, uint64_t frame);
+  void requestScreenSize(uint32_t handle, float screenPixels, uint64_t frame);
+
+  // Picks target levels for every tracked texture. When the requests do not
+  // fit, the least recently requested textures are coarsened first.
+  void resolve(uint64_t frame);
+
+  uint32_t getTargetLevel(uint32_t handle) const;
+  uint32_t getTailLevel(uint32_t handle) const;
+  uint64_t getTargetBytes() const { return m_targetBytes; }
+
+  // Finest level worth keeping when the texture covers `screenPixels` along
+  // its largest axis
+  static uint32_t levelForScreenSize(const KTX2Texture &ktx,
+                                     float screenPixels);
+  // Pixels covered by `worldSize` units seen from `distance` away
+  static float estimateScreenSize(float worldSize, float distance,
+                                  float fovY, float viewportHeight);
+  // First level small enough to stay resident permanently
+  static uint32_t tailLevel(const KTX2Texture &ktx);
+  // Bytes of levels [baseLevel, levelCount)
+  static uint64_t residentBytes(const KTX2Texture &ktx, uint32_t baseLevel);
+
+private:
+  struct Entry {
+    KTX2Texture ktx;
+    uint32_t tailLevel;
+    uint32_t requestedLevel;
+    uint64_t requestFrame = 0;
+    uint64_t lastSeenFrame = 0;
+    uint32_t targetLevel;
+  };
+
+  std::unordered_map<uint32_t, Entry> m_entries;
+  uint64_t m_budget = 256ull * 1024 * 1024;
+  uint64_t m_targetBytes = 0;
+};
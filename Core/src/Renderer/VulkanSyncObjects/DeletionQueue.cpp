@@ -0,0 +1,135 @@
+#include "VulkanSyncObjects/DeletionQueue.h"
+
+namespace {
+
+template <typename T> uint64_t toHandle(T object) {
+  return reinterpret_cast<uint64_t>(object);
+}
+
+template <typename T> T fromHandle(uint64_t handle) {
+  return reinterpret_cast<T>(handle);
+}
+
+} // namespace
+
+void DeletionQueue::init(VulkanContext *p_context,
+                         VulkanSyncManager *p_syncManager) {
+  mp_context = p_context;
+  mp_syncManager = p_syncManager;
+}
+
+void DeletionQueue::shutdown() {
+  while (!m_entries.empty()) {
+    destroy(m_entries.front());
+    m_entries.pop_front();
+  }
+}
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+  push(ObjectType::Buffer, toHandle(buffer), memory);
+}
+
+void DeletionQueue::destroyImage(VkImage image, VkDeviceMemory memory) {
+  push(ObjectType::Image, toHandle(image), memory);
+}
+
+void DeletionQueue::destroyImageView(VkImageView view) {
+  push(ObjectType::ImageView, toHandle(view));
+}
+
+void DeletionQueue::destroySampler(VkSampler sampler) {
+  push(ObjectType::Sampler, toHandle(sampler));
+}
+
+void DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer) {
+  push(ObjectType::Framebuffer, toHandle(framebuffer));
+}
+
+void DeletionQueue::destroyPipeline(VkPipeline pipeline) {
+  push(ObjectType::Pipeline, toHandle(pipeline));
+}
+
+void DeletionQueue::destroyDescriptorPool(VkDescriptorPool pool) {
+  push(ObjectType::DescriptorPool, toHandle(pool));
+}
+
+void DeletionQueue::destroySemaphore(VkSemaphore semaphore) {
+  push(ObjectType::Semaphore, toHandle(semaphore));
+}
+
+void DeletionQueue::destroySwapchain(VkSwapchainKHR swapChain) {
+  push(ObjectType::Swapchain, toHandle(swapChain));
+}
+
+void DeletionQueue::freeMemory(VkDeviceMemory memory) {
+  push(ObjectType::Memory, 0, memory);
+}
+
+void DeletionQueue::enqueue(std::function<void()> destroy) {
+  m_entries.push_back({mp_syncManager->getFrameValue(), ObjectType::Callback,
+                       0, VK_NULL_HANDLE, std::move(destroy)});
+}
+
+void DeletionQueue::push(ObjectType type, uint64_t handle,
+                         VkDeviceMemory memory) {
+  if (handle == 0 && memory == VK_NULL_HANDLE)
+    return;
+  m_entries.push_back(
+      {mp_syncManager->getFrameValue(), type, handle, memory, nullptr});
+}
+
+void DeletionQueue::flush() {
+  if (m_entries.empty())
+    return;
+
+  uint64_t completed = mp_syncManager->getCompletedValue();
+  while (!m_entries.empty() && m_entries.front().timelineValue <= completed) {
+    destroy(m_entries.front());
+    m_entries.pop_front();
+  }
+}
+
+void DeletionQueue::destroy(Entry &entry) {
+  VkDevice device = mp_context->getDevice();
+
+  switch (entry.type) {
+  case ObjectType::Buffer:
+    vkDestroyBuffer(device, fromHandle<VkBuffer>(entry.handle), nullptr);
+    break;
+  case ObjectType::Image:
+    vkDestroyImage(device, fromHandle<VkImage>(entry.handle), nullptr);
+    break;
+  case ObjectType::ImageView:
+    vkDestroyImageView(device, fromHandle<VkImageView>(entry.handle), nullptr);
+    break;
+  case ObjectType::Sampler:
+    vkDestroySampler(device, fromHandle<VkSampler>(entry.handle), nullptr);
+    break;
+  case ObjectType::Framebuffer:
+    vkDestroyFramebuffer(device, fromHandle<VkFramebuffer>(entry.handle),
+                         nullptr);
+    break;
+  case ObjectType::Pipeline:
+    vkDestroyPipeline(device, fromHandle<VkPipeline>(entry.handle), nullptr);
+    break;
+  case ObjectType::DescriptorPool:
+    vkDestroyDescriptorPool(device, fromHandle<VkDescriptorPool>(entry.handle),
+                            nullptr);
+    break;
+  case ObjectType::Semaphore:
+    vkDestroySemaphore(device, fromHandle<VkSemaphore>(entry.handle), nullptr);
+    break;
+  case ObjectType::Swapchain:
+    vkDestroySwapchainKHR(device, fromHandle<VkSwapchainKHR>(entry.handle),
+                          nullptr);
+    break;
+  case ObjectType::Memory:
+    break;
+  case ObjectType::Callback:
+    entry.callback();
+    break;
+  }
+
+  if (entry.memory != VK_NULL_HANDLE)
+    vkFreeMemory(device, entry.memory, nullptr);
+}
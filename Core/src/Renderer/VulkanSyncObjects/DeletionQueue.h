@@ -0,0 +1,71 @@
+#pragma once
+
+#include "VulkanSyncObjects/VulkanSyncObjects.h"
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Vulkan objects that frames in flight may still reference. Each is tagged
+// with the timeline value of the frame being recorded, the last one that
+// could have used it, and destroyed in flush() once the GPU has signaled
+// that value. Main thread only.
+class DeletionQueue {
+public:
+  void init(VulkanContext *p_context, VulkanSyncManager *p_syncManager);
+  // Destroys everything left, the device has to be idle
+  void shutdown();
+
+  // Memory, when given, is freed after the object
+  void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory = VK_NULL_HANDLE);
+  void destroyImage(VkImage image, VkDeviceMemory memory = VK_NULL_HANDLE);
+  void destroyImageView(VkImageView view);
+  void destroySampler(VkSampler sampler);
+  void destroyFramebuffer(VkFramebuffer framebuffer);
+  void destroyPipeline(VkPipeline pipeline);
+  void destroyDescriptorPool(VkDescriptorPool pool);
+  void destroySemaphore(VkSemaphore semaphore);
+  void destroySwapchain(VkSwapchainKHR swapChain);
+  void freeMemory(VkDeviceMemory memory);
+  // For objects owning several handles, e.g. a Texture
+  void enqueue(std::function<void()> destroy);
+
+  // Once per frame after the frame timeline wait
+  void flush();
+
+  size_t getPendingCount() const { return m_entries.size(); }
+
+private:
+  enum class ObjectType {
+    Buffer,
+    Image,
+    ImageView,
+    Sampler,
+    Framebuffer,
+    Pipeline,
+    DescriptorPool,
+    Semaphore,
+    Swapchain,
+    Memory,
+    Callback,
+  };
+
+  struct Entry {
+    uint64_t timelineValue;
+    ObjectType type;
+    uint64_t handle;
+    VkDeviceMemory memory;
+    std::function<void()> callback;
+  };
+
+  void push(ObjectType type, uint64_t handle,
+            VkDeviceMemory memory = VK_NULL_HANDLE);
+  void destroy(Entry &entry);
+
+private:
+  VulkanContext *mp_context;
+  VulkanSyncManager *mp_syncManager;
+
+  // Frame values only grow, so entries are ordered by timelineValue
+  std::deque<Entry> m_entries;
+};
@@ -1,51 +1,118 @@
 #include "VulkanSyncObjects/VulkanSyncObjects.h"
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
+#include <utility>
 
 void VulkanSyncManager::init(VulkanContext *p_context, uint32_t framesInFlight,
                              uint32_t swapChainImages) {
   mp_context = p_context;
-  m_framesInFlight = framesInFlight;
   m_swapChainImagesSize = swapChainImages;
   m_submitSemaphores.resize(swapChainImages);
-  m_adquiredSemaphore.resize(swapChainImages);
-  m_frameFences.resize(framesInFlight);
+  m_adquiredSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
+  m_frameValue = 0;
+  m_submittedValue = 0;
+  m_completedValue = 0;
+  m_framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+
+  VkSemaphoreTypeCreateInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  timelineInfo.initialValue = 0;
 
   VkSemaphoreCreateInfo semaphoreInfo{};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &timelineInfo;
+
+  if (vkCreateSemaphore(p_context->getDevice(), &semaphoreInfo, nullptr,
+                        &m_timeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create frame timeline semaphore!");
+  }
 
-  VkFenceCreateInfo fenceInfo{};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  // Acquire and present still need binary semaphores
+  semaphoreInfo.pNext = nullptr;
 
-  for (size_t i = 0; i < framesInFlight; i++) {
-    if (vkCreateFence(p_context->getDevice(), &fenceInfo, nullptr,
-                      &m_frameFences[i]) != VK_SUCCESS) {
+  for (size_t i = 0; i < m_adquiredSemaphore.size(); i++) {
+    if (vkCreateSemaphore(p_context->getDevice(), &semaphoreInfo, nullptr,
+                          &m_adquiredSemaphore[i]) != VK_SUCCESS) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
     }
   }
 
-  for (int i = 0; i < swapChainImages; i++) {
-    if (vkCreateSemaphore(p_context->getDevice(), &semaphoreInfo, nullptr,
-                          &m_submitSemaphores[i]) != VK_SUCCESS ||
-        vkCreateSemaphore(p_context->getDevice(), &semaphoreInfo, nullptr,
-                          &m_adquiredSemaphore[i]) != VK_SUCCESS) {
+  createSubmitSemaphores();
+}
+
+void VulkanSyncManager::createSubmitSemaphores() {
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  for (size_t i = 0; i < m_submitSemaphores.size(); i++) {
+    if (vkCreateSemaphore(mp_context->getDevice(), &semaphoreInfo, nullptr,
+                          &m_submitSemaphores[i]) != VK_SUCCESS) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
     }
   }
 }
 
-void VulkanSyncManager::nextFlightFrame() {
-  m_inFlightCurrentFrame = (m_inFlightCurrentFrame + 1) % m_framesInFlight;
+std::vector<VkSemaphore>
+VulkanSyncManager::recreateSubmitSemaphores(uint32_t swapChainImages) {
+  std::vector<VkSemaphore> old = std::move(m_submitSemaphores);
+  m_swapChainImagesSize = swapChainImages;
+  m_submitSemaphores.assign(swapChainImages, VK_NULL_HANDLE);
+  createSubmitSemaphores();
+  return old;
+}
+
+void VulkanSyncManager::beginFrame() {
+  // A frame that never got submitted (out of date acquire) keeps its value
+  m_frameValue = m_submittedValue + 1;
+  if (m_frameValue > m_framesInFlight)
+    wait(m_frameValue - m_framesInFlight);
+}
+
+void VulkanSyncManager::endFrame() { m_submittedValue = m_frameValue; }
+
+uint64_t VulkanSyncManager::getCompletedValue() {
+  uint64_t value = 0;
+  if (vkGetSemaphoreCounterValue(mp_context->getDevice(), m_timeline,
+                                 &value) != VK_SUCCESS) {
+    throw std::runtime_error("failed to read frame timeline semaphore!");
+  }
+  m_completedValue = std::max(m_completedValue, value);
+  return m_completedValue;
+}
+
+void VulkanSyncManager::wait(uint64_t value) {
+  if (value <= m_completedValue)
+    return;
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &m_timeline;
+  waitInfo.pValues = &value;
+
+  if (vkWaitSemaphores(mp_context->getDevice(), &waitInfo, UINT64_MAX) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to wait for frame timeline semaphore!");
+  }
+  m_completedValue = std::max(m_completedValue, value);
 }
 
-VkFence VulkanSyncManager::getFrameFence() {
-  return m_frameFences[m_inFlightCurrentFrame];
+void VulkanSyncManager::setFramesInFlight(uint32_t framesInFlight) {
+  framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+  if (framesInFlight == m_framesInFlight)
+    return;
+
+  // Slot indices change with the count, nothing may still be using them
+  wait(m_submittedValue);
+  m_framesInFlight = framesInFlight;
 }
+
 VkSemaphore VulkanSyncManager::getAcquireSemaphore() {
-  return m_adquiredSemaphore[m_inFlightCurrentFrame];
+  return m_adquiredSemaphore[getFlightFrameIndex()];
 }
 VkSemaphore VulkanSyncManager::getSubmitSemaphore(uint32_t imageIndex) {
   return m_submitSemaphores[imageIndex];
@@ -54,11 +121,12 @@ VkSemaphore VulkanSyncManager::getSubmitSemaphore(uint32_t imageIndex) {
 void VulkanSyncManager::cleanup() {
   for (size_t i = 0; i < m_swapChainImagesSize; i++) {
     vkDestroySemaphore(mp_context->getDevice(), m_submitSemaphores[i], nullptr);
+  }
+  for (size_t i = 0; i < m_adquiredSemaphore.size(); i++) {
     vkDestroySemaphore(mp_context->getDevice(), m_adquiredSemaphore[i],
                        nullptr);
   }
 
-  for (size_t i = 0; i < m_framesInFlight; i++) {
-    vkDestroyFence(mp_context->getDevice(), m_frameFences[i], nullptr);
-  }
+  vkDestroySemaphore(mp_context->getDevice(), m_timeline, nullptr);
+  m_timeline = VK_NULL_HANDLE;
 }
@@ -2,25 +2,60 @@
 
 #include "Swapchain/Swapchain.h"
 #include <cstdint>
+#include <vector>
+
+// Upper bound for setFramesInFlight, per-frame resources are sized for it
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Frame pacing on a single timeline semaphore. Frame N signals N once the
+// GPU is done with it, anything frame N used can be reused or destroyed
+// when getCompletedValue() >= N.
 class VulkanSyncManager {
 public:
   void init(VulkanContext *p_context, uint32_t framesInFlight,
             uint32_t swapChainImages);
   void cleanup();
 
-  VkFence getFrameFence();
+  // Waits for the frame framesInFlight frames back, its slot (command
+  // buffer, acquire semaphore, per-frame allocations) is free afterwards
+  void beginFrame();
+  // Call once the frame's submit, signaling getFrameValue(), is queued
+  void endFrame();
+
+  // Value the frame being recorded signals
+  uint64_t getFrameValue() const { return m_frameValue; }
+  uint64_t getSubmittedValue() const { return m_submittedValue; }
+  uint64_t getCompletedValue();
+  void wait(uint64_t value);
+
+  VkSemaphore getTimelineSemaphore() const { return m_timeline; }
   VkSemaphore getAcquireSemaphore();
   VkSemaphore getSubmitSemaphore(uint32_t imageIndex);
+  // One fresh submit semaphore per image of a recreated swapchain. The old
+  // ones may still be waited on by queued presents, they are returned for
+  // deferred destruction.
+  std::vector<VkSemaphore> recreateSubmitSemaphores(uint32_t swapChainImages);
 
-  uint32_t getFlightFrameIndex() { return m_inFlightCurrentFrame; }
-  void nextFlightFrame();
+  uint32_t getFlightFrameIndex() const {
+    return static_cast<uint32_t>(m_frameValue % m_framesInFlight);
+  }
+  uint32_t getFramesInFlight() const { return m_framesInFlight; }
+  // Clamped to [1, MAX_FRAMES_IN_FLIGHT]. Drains the submitted frames so
+  // the slots can be renumbered, meant for configuration changes.
+  void setFramesInFlight(uint32_t framesInFlight);
 
 private:
+  void createSubmitSemaphores();
+
+private:
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
   std::vector<VkSemaphore> m_submitSemaphores;
   std::vector<VkSemaphore> m_adquiredSemaphore;
-  std::vector<VkFence> m_frameFences;
 
-  uint32_t m_inFlightCurrentFrame = 0;
+  uint64_t m_frameValue = 0;
+  uint64_t m_submittedValue = 0;
+  uint64_t m_completedValue = 0;
+
   uint32_t m_framesInFlight = 0;
   uint32_t m_swapChainImagesSize;
 
@@ -0,0 +1,336 @@
+#include "BVH.h"
+#include <cfloat>
+
+namespace {
+
+// Centroid bins per axis the build evaluates splits between
+const uint32_t SAH_BINS = 16;
+
+const AABB EMPTY_BOUNDS = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+
+glm::vec3 centroid(const AABB &bounds) {
+  return (bounds.min + bounds.max) * 0.5f;
+}
+
+} // namespace
+
+AABB AABB::transform(const AABB &bounds, const glm::mat4 &transform) {
+  glm::vec3 center = centroid(bounds);
+  glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+  glm::mat3 absRotation(transform);
+  for (int column = 0; column < 3; column++) {
+    absRotation[column] = glm::abs(absRotation[column]);
+  }
+  glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+  glm::vec3 worldExtent = absRotation * extent;
+  return {worldCenter - worldExtent, worldCenter + worldExtent};
+}
+
+Frustum Frustum::fromViewProj(const glm::mat4 &viewProj) {
+  glm::vec4 rows[4];
+  for (int row = 0; row < 4; row++) {
+    rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row],
+                          viewProj[2][row], viewProj[3][row]);
+  }
+
+  Frustum frustum;
+  frustum.planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+                    rows[3] - rows[1], rows[2],           rows[3] - rows[2]};
+  for (glm::vec4 &plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+uint32_t BVH::createProxy(const AABB &bounds) {
+  uint32_t proxy;
+  if (!m_freeProxies.empty()) {
+    proxy = m_freeProxies.back();
+    m_freeProxies.pop_back();
+  } else {
+    proxy = static_cast<uint32_t>(m_proxies.size());
+    m_proxies.push_back(NULL_NODE);
+  }
+  insertLeaf(proxy, fatten(bounds));
+  return proxy;
+}
+
+void BVH::destroyProxy(uint32_t proxy) {
+  removeLeaf(proxy);
+  m_proxies[proxy] = NULL_NODE;
+  m_freeProxies.push_back(proxy);
+}
+
+bool BVH::moveProxy(uint32_t proxy, const AABB &bounds) {
+  if (m_nodes[m_proxies[proxy]].bounds.contains(bounds))
+    return false;
+
+  removeLeaf(proxy);
+  insertLeaf(proxy, fatten(bounds));
+  m_reinsertCount++;
+  return true;
+}
+
+void BVH::build(const std::vector<AABB> &bounds) {
+  clear();
+  uint32_t count = static_cast<uint32_t>(bounds.size());
+  m_proxies.resize(count);
+
+  std::vector<BuildRef> refs(count);
+  for (uint32_t proxy = 0; proxy < count; proxy++) {
+    AABB fat = fatten(bounds[proxy]);
+    refs[proxy] = {proxy, fat, centroid(fat)};
+  }
+  buildTree(refs);
+}
+
+void BVH::rebuild() {
+  std::vector<BuildRef> refs;
+  refs.reserve(m_leafCount);
+  for (uint32_t proxy = 0; proxy < m_proxies.size(); proxy++) {
+    if (m_proxies[proxy] == NULL_NODE)
+      continue;
+    const AABB &bounds = m_nodes[m_proxies[proxy]].bounds;
+    refs.push_back({proxy, bounds, centroid(bounds)});
+  }
+  buildTree(refs);
+}
+
+void BVH::clear() {
+  m_nodes.clear();
+  m_freePairs.clear();
+  m_proxies.clear();
+  m_freeProxies.clear();
+  m_leafCount = 0;
+  m_reinsertCount = 0;
+}
+
+float BVH::computeCost() const {
+  if (m_leafCount < 2)
+    return 0.0f;
+
+  float internalArea = 0.0f;
+  NodeStack stack;
+  stack.push(ROOT);
+  while (!stack.empty()) {
+    const Node &node = m_nodes[stack.pop()];
+    if (node.isLeaf())
+      continue;
+    internalArea += node.bounds.surfaceArea();
+    stack.push(node.child);
+    stack.push(node.child + 1);
+  }
+  return internalArea / m_nodes[ROOT].bounds.surfaceArea();
+}
+
+void BVH::buildTree(std::vector<BuildRef> &refs) {
+  m_nodes.assign(FIRST_PAIR, Node{});
+  m_freePairs.clear();
+  m_leafCount = static_cast<uint32_t>(refs.size());
+  m_reinsertCount = 0;
+  if (refs.empty())
+    return;
+  m_nodes.reserve(FIRST_PAIR + 2 * (refs.size() - 1));
+  m_nodes[ROOT].parent = NULL_NODE;
+
+  struct Task {
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+  };
+  std::vector<Task> tasks = {{ROOT, 0, m_leafCount}};
+  while (!tasks.empty()) {
+    Task task = tasks.back();
+    tasks.pop_back();
+    uint32_t end = task.first + task.count;
+
+    AABB bounds = EMPTY_BOUNDS;
+    AABB centroids = EMPTY_BOUNDS;
+    for (uint32_t i = task.first; i < end; i++) {
+      bounds = AABB::merge(bounds, refs[i].bounds);
+      centroids = AABB::merge(centroids, {refs[i].center, refs[i].center});
+    }
+    m_nodes[task.node].bounds = bounds;
+
+    if (task.count == 1) {
+      m_nodes[task.node].child = LEAF_BIT | refs[task.first].proxy;
+      m_proxies[refs[task.first].proxy] = task.node;
+      continue;
+    }
+
+    // Bins every axis in one pass over the proxies
+    glm::vec3 extent = centroids.max - centroids.min;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; axis++) {
+      scale[axis] = extent[axis] > 0.0f ? SAH_BINS / extent[axis] : 0.0f;
+    }
+    auto binOf = [&](const BuildRef &ref, int axis) {
+      float offset = (ref.center[axis] - centroids.min[axis]) * scale[axis];
+      return std::min(static_cast<uint32_t>(offset), SAH_BINS - 1);
+    };
+
+    std::array<std::array<AABB, SAH_BINS>, 3> binBounds;
+    std::array<std::array<uint32_t, SAH_BINS>, 3> binCounts{};
+    for (std::array<AABB, SAH_BINS> &axisBins : binBounds) {
+      axisBins.fill(EMPTY_BOUNDS);
+    }
+    for (uint32_t i = task.first; i < end; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        uint32_t bin = binOf(refs[i], axis);
+        binBounds[axis][bin] =
+            AABB::merge(binBounds[axis][bin], refs[i].bounds);
+        binCounts[axis][bin]++;
+      }
+    }
+
+    // Cheapest split between bins, by the surface area and proxy count of
+    // both sides
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestBin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      if (extent[axis] <= 0.0f)
+        continue;
+
+      // Right side of the split after each bin
+      std::array<float, SAH_BINS> rightAreas{};
+      std::array<uint32_t, SAH_BINS> rightCounts{};
+      AABB right = EMPTY_BOUNDS;
+      uint32_t rightCount = 0;
+      for (uint32_t bin = SAH_BINS - 1; bin > 0; bin--) {
+        right = AABB::merge(right, binBounds[axis][bin]);
+        rightCount += binCounts[axis][bin];
+        rightAreas[bin - 1] = right.surfaceArea();
+        rightCounts[bin - 1] = rightCount;
+      }
+
+      AABB left = EMPTY_BOUNDS;
+      uint32_t leftCount = 0;
+      for (uint32_t bin = 0; bin < SAH_BINS - 1; bin++) {
+        left = AABB::merge(left, binBounds[axis][bin]);
+        leftCount += binCounts[axis][bin];
+        if (leftCount == 0 || rightCounts[bin] == 0)
+          continue;
+        float cost = leftCount * left.surfaceArea() +
+                     rightCounts[bin] * rightAreas[bin];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = bin;
+        }
+      }
+    }
+
+    // Proxies sharing one centroid are split down the middle
+    uint32_t split = task.first + task.count / 2;
+    if (bestAxis >= 0) {
+      auto middle = std::partition(
+          refs.begin() + task.first, refs.begin() + end,
+          [&](const BuildRef &ref) { return binOf(ref, bestAxis) <= bestBin; });
+      split = static_cast<uint32_t>(middle - refs.begin());
+    }
+
+    uint32_t pair = allocatePair();
+    m_nodes[task.node].child = pair;
+    m_nodes[pair].parent = task.node;
+    m_nodes[pair + 1].parent = task.node;
+    tasks.push_back({pair, task.first, split - task.first});
+    tasks.push_back({pair + 1, split, end - split});
+  }
+}
+
+uint32_t BVH::allocatePair() {
+  if (!m_freePairs.empty()) {
+    uint32_t pair = m_freePairs.back();
+    m_freePairs.pop_back();
+    return pair;
+  }
+  uint32_t pair = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.resize(m_nodes.size() + 2);
+  return pair;
+}
+
+void BVH::insertLeaf(uint32_t proxy, const AABB &bounds) {
+  m_leafCount++;
+  if (m_leafCount == 1) {
+    m_nodes.resize(std::max<size_t>(m_nodes.size(), FIRST_PAIR));
+    m_nodes[ROOT] = {bounds, LEAF_BIT | proxy, NULL_NODE};
+    m_proxies[proxy] = ROOT;
+    return;
+  }
+
+  // Walk down towards the sibling that adds the least surface area. Every
+  // node on the way grows by the new bounds, which the children inherit
+  // as a cost on top of their own.
+  uint32_t sibling = ROOT;
+  while (!m_nodes[sibling].isLeaf()) {
+    const Node &node = m_nodes[sibling];
+    float area = node.bounds.surfaceArea();
+    float combinedArea = AABB::merge(node.bounds, bounds).surfaceArea();
+    float cost = 2.0f * combinedArea;
+    float inheritedCost = 2.0f * (combinedArea - area);
+
+    float childCosts[2];
+    for (uint32_t i = 0; i < 2; i++) {
+      const Node &child = m_nodes[node.child + i];
+      float childArea = AABB::merge(child.bounds, bounds).surfaceArea();
+      if (!child.isLeaf())
+        childArea -= child.bounds.surfaceArea();
+      childCosts[i] = childArea + inheritedCost;
+    }
+
+    if (cost < childCosts[0] && cost < childCosts[1])
+      break;
+    sibling = node.child + (childCosts[1] < childCosts[0] ? 1 : 0);
+  }
+
+  // The sibling moves into a new pair next to the leaf, and its slot
+  // becomes their parent
+  uint32_t pair = allocatePair();
+  m_nodes[pair] = m_nodes[sibling];
+  m_nodes[pair].parent = sibling;
+  relink(pair);
+  m_nodes[pair + 1] = {bounds, LEAF_BIT | proxy, sibling};
+  m_proxies[proxy] = pair + 1;
+
+  m_nodes[sibling].child = pair;
+  m_nodes[sibling].bounds = AABB::merge(m_nodes[pair].bounds, bounds);
+  refit(m_nodes[sibling].parent);
+}
+
+void BVH::removeLeaf(uint32_t proxy) {
+  uint32_t leaf = m_proxies[proxy];
+  m_leafCount--;
+  if (leaf == ROOT)
+    return;
+
+  // The sibling takes the parent's slot, freeing the pair
+  uint32_t parent = m_nodes[leaf].parent;
+  uint32_t grandParent = m_nodes[parent].parent;
+  m_nodes[parent] = m_nodes[leaf ^ 1];
+  m_nodes[parent].parent = grandParent;
+  relink(parent);
+  m_freePairs.push_back(leaf & ~1u);
+  refit(grandParent);
+}
+
+void BVH::relink(uint32_t node) {
+  if (m_nodes[node].isLeaf()) {
+    m_proxies[m_nodes[node].proxy()] = node;
+  } else {
+    m_nodes[m_nodes[node].child].parent = node;
+    m_nodes[m_nodes[node].child + 1].parent = node;
+  }
+}
+
+void BVH::refit(uint32_t node) {
+  while (node != NULL_NODE) {
+    Node &current = m_nodes[node];
+    AABB bounds = AABB::merge(m_nodes[current.child].bounds,
+                              m_nodes[current.child + 1].bounds);
+    if (bounds.min == current.bounds.min && bounds.max == current.bounds.max)
+      break;
+    current.bounds = bounds;
+    node = current.parent;
+  }
+}
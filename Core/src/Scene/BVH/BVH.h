@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+struct AABB {
+  glm::vec3 min;
+  glm::vec3 max;
+
+  static AABB merge(const AABB &a, const AABB &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+  }
+  bool contains(const AABB &other) const {
+    return min.x <= other.min.x && min.y <= other.min.y &&
+           min.z <= other.min.z && max.x >= other.max.x &&
+           max.y >= other.max.y && max.z >= other.max.z;
+  }
+  bool overlaps(const AABB &other) const {
+    return min.x <= other.max.x && min.y <= other.max.y &&
+           min.z <= other.max.z && max.x >= other.min.x &&
+           max.y >= other.min.y && max.z >= other.min.z;
+  }
+  float surfaceArea() const {
+    glm::vec3 extent = max - min;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z +
+                   extent.z * extent.x);
+  }
+  // Of an object space box under an affine transform
+  static AABB transform(const AABB &bounds, const glm::mat4 &transform);
+};
+
+// Planes of a view projection, normals pointing inwards
+struct Frustum {
+  enum class Result { Outside, Intersects, Inside };
+
+  // Vulkan clip space, depth from 0 to 1
+  static Frustum fromViewProj(const glm::mat4 &viewProj);
+
+  Result test(const AABB &bounds) const {
+    Result result = Result::Inside;
+    for (const glm::vec4 &plane : planes) {
+      // Corners furthest along and against the normal
+      glm::vec3 normal(plane);
+      glm::vec3 positive(normal.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                         normal.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                         normal.z >= 0.0f ? bounds.max.z : bounds.min.z);
+      glm::vec3 negative(normal.x >= 0.0f ? bounds.min.x : bounds.max.x,
+                         normal.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                         normal.z >= 0.0f ? bounds.min.z : bounds.max.z);
+      if (glm::dot(normal, positive) + plane.w < 0.0f)
+        return Result::Outside;
+      if (glm::dot(normal, negative) + plane.w < 0.0f)
+        result = Result::Intersects;
+    }
+    return result;
+  }
+
+  // left, right, bottom, top, near, far
+  std::array<glm::vec4, 6> planes;
+};
+
+// Dynamic bounding volume hierarchy over proxies, one per object. Built top
+// down with the binned surface area heuristic, then kept up to date as
+// proxies are created, moved and destroyed: a moved proxy whose bounds
+// leave its fattened leaf box is removed and reinserted next to the sibling
+// that grows the tree's surface area the least, and the boxes above it are
+// refit. rebuild() restores the build quality after many reinserts.
+//
+// Nodes are 32 bytes and the two children of a node are adjacent, so both
+// child boxes tested at each step come from one cache line.
+class BVH {
+public:
+  // Leaf boxes are this much larger than the proxy bounds on every side,
+  // moves within it cost nothing
+  explicit BVH(float margin = 0.1f) : m_margin(margin) {}
+
+  uint32_t createProxy(const AABB &bounds);
+  void destroyProxy(uint32_t proxy);
+  // True when the proxy left its leaf box and was reinserted
+  bool moveProxy(uint32_t proxy, const AABB &bounds);
+  // Fattened
+  const AABB &getBounds(uint32_t proxy) const {
+    return m_nodes[m_proxies[proxy]].bounds;
+  }
+
+  // Replaces every proxy, proxy i gets bounds[i]
+  void build(const std::vector<AABB> &bounds);
+  // Same proxies, tree built again from scratch
+  void rebuild();
+  void clear();
+
+  // fn(proxy) for every proxy overlapping `bounds`
+  template <typename Fn> void queryAABB(const AABB &bounds, Fn &&fn) const {
+    if (m_leafCount == 0 || !m_nodes[ROOT].bounds.overlaps(bounds))
+      return;
+    NodeStack stack;
+    stack.push(ROOT);
+    while (!stack.empty()) {
+      const Node &node = m_nodes[stack.pop()];
+      if (node.isLeaf()) {
+        fn(node.proxy());
+        continue;
+      }
+      for (uint32_t child = node.child; child < node.child + 2; child++) {
+        if (m_nodes[child].bounds.overlaps(bounds))
+          stack.push(child);
+      }
+    }
+  }
+
+  // fn(proxy) for every proxy at least partially inside the frustum.
+  // Subtrees entirely inside are reported without testing their nodes.
+  template <typename Fn>
+  void queryFrustum(const Frustum &frustum, Fn &&fn) const {
+    if (m_leafCount == 0)
+      return;
+    NodeStack stack;
+    stack.push(ROOT);
+    while (!stack.empty()) {
+      uint32_t entry = stack.pop();
+      const Node &node = m_nodes[entry & ~INSIDE_BIT];
+      bool inside = entry & INSIDE_BIT;
+      if (!inside) {
+        Frustum::Result result = frustum.test(node.bounds);
+        if (result == Frustum::Result::Outside)
+          continue;
+        inside = result == Frustum::Result::Inside;
+      }
+      if (node.isLeaf()) {
+        fn(node.proxy());
+        continue;
+      }
+      uint32_t flag = inside ? INSIDE_BIT : 0;
+      stack.push(node.child | flag);
+      stack.push((node.child + 1) | flag);
+    }
+  }
+
+  // Proxies along the ray, nearer subtrees first. fn(proxy, distance)
+  // receives the distance the ray enters the proxy's box and returns how
+  // far the ray goes on: `distance` of a confirmed hit to only look for
+  // closer ones, `maxDistance` unchanged to keep going.
+  template <typename Fn>
+  void raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               float maxDistance, Fn &&fn) const {
+    if (m_leafCount == 0)
+      return;
+    glm::vec3 invDirection = 1.0f / direction;
+    float distance;
+    if (!intersectRay(m_nodes[ROOT].bounds, origin, invDirection,
+                      maxDistance, distance))
+      return;
+
+    NodeStack stack;
+    stack.push(ROOT);
+    while (!stack.empty()) {
+      const Node &node = m_nodes[stack.pop()];
+      if (node.isLeaf()) {
+        if (intersectRay(node.bounds, origin, invDirection, maxDistance,
+                         distance))
+          maxDistance = fn(node.proxy(), distance);
+        continue;
+      }
+
+      float nearDistance, farDistance;
+      bool hitNear = intersectRay(m_nodes[node.child].bounds, origin,
+                                  invDirection, maxDistance, nearDistance);
+      bool hitFar = intersectRay(m_nodes[node.child + 1].bounds, origin,
+                                 invDirection, maxDistance, farDistance);
+      uint32_t nearChild = node.child;
+      uint32_t farChild = node.child + 1;
+      if (hitNear && hitFar && farDistance < nearDistance) {
+        std::swap(nearChild, farChild);
+      } else if (!hitNear) {
+        nearChild = farChild;
+        hitNear = hitFar;
+        hitFar = false;
+      }
+      // Popped first
+      if (hitFar)
+        stack.push(farChild);
+      if (hitNear)
+        stack.push(nearChild);
+    }
+  }
+
+  uint32_t getProxyCount() const { return m_leafCount; }
+  // Proxies reinserted by moveProxy since the last build
+  uint32_t getReinsertCount() const { return m_reinsertCount; }
+  // Surface area heuristic cost of the tree relative to its root, grows as
+  // reinserts degrade it
+  float computeCost() const;
+
+private:
+  static constexpr uint32_t ROOT = 0;
+  // Pairs of children start after the root and a padding node, at even
+  // indices
+  static constexpr uint32_t FIRST_PAIR = 2;
+  static constexpr uint32_t NULL_NODE = UINT32_MAX;
+  static constexpr uint32_t LEAF_BIT = 0x80000000u;
+  // Marks stack entries of frustum queries whose node is fully inside
+  static constexpr uint32_t INSIDE_BIT = 0x80000000u;
+
+  struct alignas(32) Node {
+    AABB bounds;
+    // First of the two adjacent children, or LEAF_BIT | proxy
+    uint32_t child;
+    uint32_t parent;
+
+    bool isLeaf() const { return child & LEAF_BIT; }
+    uint32_t proxy() const { return child & ~LEAF_BIT; }
+  };
+  static_assert(sizeof(Node) == 32, "two sibling nodes per cache line");
+
+  // Traversal stack, spills to the heap only for unusually deep trees
+  class NodeStack {
+  public:
+    void push(uint32_t node) {
+      if (m_size < m_inline.size())
+        m_inline[m_size] = node;
+      else
+        m_overflow.push_back(node);
+      m_size++;
+    }
+    uint32_t pop() {
+      m_size--;
+      if (m_size < m_inline.size())
+        return m_inline[m_size];
+      uint32_t node = m_overflow.back();
+      m_overflow.pop_back();
+      return node;
+    }
+    bool empty() const { return m_size == 0; }
+
+  private:
+    std::array<uint32_t, 64> m_inline;
+    std::vector<uint32_t> m_overflow;
+    uint32_t m_size = 0;
+  };
+
+  static bool intersectRay(const AABB &bounds, const glm::vec3 &origin,
+                           const glm::vec3 &invDirection, float maxDistance,
+                           float &distance) {
+    glm::vec3 t0 = (bounds.min - origin) * invDirection;
+    glm::vec3 t1 = (bounds.max - origin) * invDirection;
+    glm::vec3 tMin = glm::min(t0, t1);
+    glm::vec3 tMax = glm::max(t0, t1);
+    float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    float exit = std::min(std::min(tMax.x, tMax.y),
+                          std::min(tMax.z, maxDistance));
+    distance = enter;
+    return enter <= exit;
+  }
+
+  AABB fatten(const AABB &bounds) const {
+    return {bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin)};
+  }
+
+  struct BuildRef {
+    uint32_t proxy;
+    AABB bounds;
+    glm::vec3 center;
+  };
+
+  // Replaces the nodes with a tree over `refs`, which it reorders
+  void buildTree(std::vector<BuildRef> &refs);
+  uint32_t allocatePair();
+  void insertLeaf(uint32_t proxy, const AABB &bounds);
+  void removeLeaf(uint32_t proxy);
+  // Points the proxy or children of the node now stored at `node` back at it
+  void relink(uint32_t node);
+  // Recomputes boxes from `node` up to the root, stops once one is unchanged
+  void refit(uint32_t node);
+
+private:
+  float m_margin;
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_freePairs;
+  // Leaf node of each proxy, NULL_NODE for free proxies
+  std::vector<uint32_t> m_proxies;
+  std::vector<uint32_t> m_freeProxies;
+  uint32_t m_leafCount = 0;
+  uint32_t m_reinsertCount = 0;
+};
@@ -20,6 +20,9 @@ public:
 
   const glm::vec3 &getPosition();
   const glm::vec3 &getRotation();
+  float getFov() const { return m_fov; } // degrees
+  float getNear() const { return m_near; }
+  float getFar() const { return m_far; }
 
 private:
   void updateView();
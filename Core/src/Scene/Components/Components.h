@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Pipeline/PipelineState.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Components of renderable entities in a Core::World, an entity with mesh,
+// transform and material is drawn by Renderer::SubmitWorld
+
+struct TransformComponent {
+  // Object to world
+  glm::mat4 world{1.0f};
+};
+
+struct MeshComponent {
+  // From Renderer::addObject
+  uint32_t objID;
+};
+
+struct MaterialComponent {
+  PipelineState state = PipelineState::opaque();
+};
+
+// Set by whoever culls the entity against the camera. Entities outside the
+// view are left out of it but still cast shadows into it, entities without
+// one are always drawn.
+struct VisibilityComponent {
+  bool visible = true;
+};
@@ -0,0 +1,230 @@
+#include "SceneGraph.h"
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+// translate * rotate * scale without the generic matrix products
+glm::mat4 composeTransform(const glm::vec3 &translation,
+                           const glm::quat &rotation, const glm::vec3 &scale) {
+  glm::mat4 transform = glm::mat4_cast(rotation);
+  transform[0] *= scale.x;
+  transform[1] *= scale.y;
+  transform[2] *= scale.z;
+  transform[3] = glm::vec4(translation, 1.0f);
+  return transform;
+}
+
+} // namespace
+
+SceneNode SceneGraph::createNode(SceneNode parent) {
+  uint32_t parentSlot = parent != NULL_SCENE_NODE ? slotOf(parent) : NO_SLOT;
+
+  SceneNode node;
+  if (!m_freeNodes.empty()) {
+    node = m_freeNodes.back();
+    m_freeNodes.pop_back();
+  } else {
+    node = static_cast<SceneNode>(m_slots.size());
+    m_slots.push_back(NO_SLOT);
+  }
+
+  // Appended after its parent, the order stays valid for the sweep until
+  // the next update() moves it next to its depth
+  m_slots[node] = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.push_back(node);
+  m_parents.push_back(parentSlot);
+  m_translations.push_back(glm::vec3(0.0f));
+  m_rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  m_scales.push_back(glm::vec3(1.0f));
+  m_worldTransforms.push_back(glm::mat4(1.0f));
+  m_dirty.push_back(1);
+  m_alive.push_back(1);
+  m_meshes.push_back(NO_MESH);
+  m_states.push_back(PipelineState::opaque());
+
+  m_orderDirty = true;
+  return node;
+}
+
+void SceneGraph::destroyNode(SceneNode node) {
+  m_alive[slotOf(node)] = 0;
+  m_orderDirty = true;
+}
+
+void SceneGraph::setParent(SceneNode node, SceneNode parent) {
+  uint32_t slot = slotOf(node);
+  uint32_t parentSlot = parent != NULL_SCENE_NODE ? slotOf(parent) : NO_SLOT;
+  for (uint32_t ancestor = parentSlot; ancestor != NO_SLOT;
+       ancestor = m_parents[ancestor]) {
+    if (ancestor == slot) {
+      throw std::runtime_error(
+          "scene node cannot be parented to its own descendant!");
+    }
+  }
+
+  m_parents[slot] = parentSlot;
+  m_dirty[slot] = 1;
+  m_orderDirty = true;
+}
+
+SceneNode SceneGraph::getParent(SceneNode node) const {
+  uint32_t parentSlot = m_parents[slotOf(node)];
+  return parentSlot != NO_SLOT ? m_nodes[parentSlot] : NULL_SCENE_NODE;
+}
+
+void SceneGraph::setTranslation(SceneNode node, const glm::vec3 &translation) {
+  uint32_t slot = slotOf(node);
+  m_translations[slot] = translation;
+  m_dirty[slot] = 1;
+}
+
+void SceneGraph::setRotation(SceneNode node, const glm::quat &rotation) {
+  uint32_t slot = slotOf(node);
+  m_rotations[slot] = rotation;
+  m_dirty[slot] = 1;
+}
+
+void SceneGraph::setScale(SceneNode node, const glm::vec3 &scale) {
+  uint32_t slot = slotOf(node);
+  m_scales[slot] = scale;
+  m_dirty[slot] = 1;
+}
+
+const glm::vec3 &SceneGraph::getTranslation(SceneNode node) const {
+  return m_translations[slotOf(node)];
+}
+
+const glm::quat &SceneGraph::getRotation(SceneNode node) const {
+  return m_rotations[slotOf(node)];
+}
+
+const glm::vec3 &SceneGraph::getScale(SceneNode node) const {
+  return m_scales[slotOf(node)];
+}
+
+const glm::mat4 &SceneGraph::getWorldTransform(SceneNode node) const {
+  return m_worldTransforms[slotOf(node)];
+}
+
+void SceneGraph::setMesh(SceneNode node, uint32_t objID,
+                         const PipelineState &state) {
+  uint32_t slot = slotOf(node);
+  m_meshes[slot] = objID;
+  m_states[slot] = state;
+}
+
+void SceneGraph::setPipelineState(SceneNode node, const PipelineState &state) {
+  m_states[slotOf(node)] = state;
+}
+
+void SceneGraph::update() {
+  if (m_orderDirty)
+    rebuildOrder();
+
+  // Parents come first, so a parent's flag and world transform are final
+  // by the time its children are reached
+  uint32_t updated = 0;
+  for (uint32_t slot = 0; slot < m_nodes.size(); slot++) {
+    uint32_t parent = m_parents[slot];
+    if (parent != NO_SLOT)
+      m_dirty[slot] |= m_dirty[parent];
+    if (!m_dirty[slot])
+      continue;
+
+    glm::mat4 local = composeTransform(m_translations[slot],
+                                       m_rotations[slot], m_scales[slot]);
+    m_worldTransforms[slot] =
+        parent != NO_SLOT ? m_worldTransforms[parent] * local : local;
+    updated++;
+  }
+  std::fill(m_dirty.begin(), m_dirty.end(), 0);
+
+  m_stats.nodeCount = static_cast<uint32_t>(m_nodes.size());
+  m_stats.updatedNodes = updated;
+}
+
+uint32_t SceneGraph::slotOf(SceneNode node) const {
+  if (node >= m_slots.size() || m_slots[node] == NO_SLOT) {
+    throw std::runtime_error("invalid scene node!");
+  }
+  return m_slots[node];
+}
+
+void SceneGraph::rebuildOrder() {
+  uint32_t count = static_cast<uint32_t>(m_nodes.size());
+
+  // Depth of every slot, and whether an ancestor was destroyed. Each chain
+  // is walked up to the first resolved slot and resolved on the way down.
+  const uint32_t UNRESOLVED = UINT32_MAX;
+  std::vector<uint32_t> depths(count, UNRESOLVED);
+  std::vector<uint32_t> chain;
+  uint32_t maxDepth = 0;
+  for (uint32_t slot = 0; slot < count; slot++) {
+    for (uint32_t s = slot; s != NO_SLOT && depths[s] == UNRESOLVED;
+         s = m_parents[s])
+      chain.push_back(s);
+
+    while (!chain.empty()) {
+      uint32_t s = chain.back();
+      chain.pop_back();
+      uint32_t parent = m_parents[s];
+      if (parent == NO_SLOT) {
+        depths[s] = 0;
+      } else {
+        depths[s] = depths[parent] + 1;
+        m_alive[s] &= m_alive[parent];
+      }
+      maxDepth = std::max(maxDepth, depths[s]);
+    }
+  }
+
+  // Counting sort by depth, keeping the current order within a level
+  std::vector<uint32_t> levelStart(maxDepth + 2, 0);
+  for (uint32_t slot = 0; slot < count; slot++) {
+    if (m_alive[slot])
+      levelStart[depths[slot] + 1]++;
+  }
+  for (uint32_t depth = 1; depth < levelStart.size(); depth++)
+    levelStart[depth] += levelStart[depth - 1];
+
+  uint32_t aliveCount = levelStart.back();
+  std::vector<uint32_t> newSlots(count, NO_SLOT);
+  std::vector<uint32_t> order(aliveCount);
+  for (uint32_t slot = 0; slot < count; slot++) {
+    if (!m_alive[slot]) {
+      m_slots[m_nodes[slot]] = NO_SLOT;
+      m_freeNodes.push_back(m_nodes[slot]);
+      continue;
+    }
+    uint32_t newSlot = levelStart[depths[slot]]++;
+    newSlots[slot] = newSlot;
+    order[newSlot] = slot;
+  }
+
+  auto permute = [&](auto &values) {
+    std::remove_reference_t<decltype(values)> sorted(aliveCount);
+    for (uint32_t i = 0; i < aliveCount; i++)
+      sorted[i] = values[order[i]];
+    values = std::move(sorted);
+  };
+  permute(m_nodes);
+  permute(m_parents);
+  permute(m_translations);
+  permute(m_rotations);
+  permute(m_scales);
+  permute(m_worldTransforms);
+  permute(m_dirty);
+  permute(m_alive);
+  permute(m_meshes);
+  permute(m_states);
+
+  for (uint32_t slot = 0; slot < aliveCount; slot++) {
+    m_slots[m_nodes[slot]] = slot;
+    if (m_parents[slot] != NO_SLOT)
+      m_parents[slot] = newSlots[m_parents[slot]];
+  }
+
+  m_orderDirty = false;
+}
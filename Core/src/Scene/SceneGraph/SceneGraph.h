@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Pipeline/PipelineState.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+// Stable handle of a scene node
+using SceneNode = uint32_t;
+const SceneNode NULL_SCENE_NODE = UINT32_MAX;
+// Mesh of nodes that draw nothing
+const uint32_t NO_MESH = UINT32_MAX;
+
+// Hierarchy of nodes with translation/rotation/scale transforms relative to
+// their parent. Node data is stored as a structure of arrays indexed by
+// slot, and slots are kept sorted by depth so every parent comes before
+// its children. update() then computes world transforms in one linear
+// sweep, skipping the subtrees whose transforms have not changed.
+//
+// Structural changes (create, destroy, reparent) take effect on the
+// ordering at the next update(), handles stay valid in between.
+class SceneGraph {
+public:
+  struct Stats {
+    uint32_t nodeCount = 0;
+    // World transforms recomputed by the last update()
+    uint32_t updatedNodes = 0;
+  };
+
+  // A root without a parent
+  SceneNode createNode(SceneNode parent = NULL_SCENE_NODE);
+  // Together with its descendants, whose handles are released by the next
+  // update()
+  void destroyNode(SceneNode node);
+
+  // Keeps the local transform, the node moves along with its new parent
+  void setParent(SceneNode node, SceneNode parent);
+  SceneNode getParent(SceneNode node) const;
+
+  void setTranslation(SceneNode node, const glm::vec3 &translation);
+  void setRotation(SceneNode node, const glm::quat &rotation);
+  void setScale(SceneNode node, const glm::vec3 &scale);
+  const glm::vec3 &getTranslation(SceneNode node) const;
+  const glm::quat &getRotation(SceneNode node) const;
+  const glm::vec3 &getScale(SceneNode node) const;
+
+  // As of the last update()
+  const glm::mat4 &getWorldTransform(SceneNode node) const;
+
+  // Drawn at the node's world transform, see Renderer::SubmitScene
+  void setMesh(SceneNode node, uint32_t objID,
+               const PipelineState &state = PipelineState::opaque());
+  void setPipelineState(SceneNode node, const PipelineState &state);
+  void clearMesh(SceneNode node) { setMesh(node, NO_MESH); }
+
+  // Restores depth order after structural changes, then recomputes the
+  // world transforms of changed nodes and everything below them
+  void update();
+
+  // fn(objID, state, worldTransform) for every node with a mesh, in slot
+  // order
+  template <typename Fn> void forEachRenderable(Fn &&fn) const {
+    for (uint32_t slot = 0; slot < m_meshes.size(); slot++) {
+      if (m_meshes[slot] != NO_MESH && m_alive[slot])
+        fn(m_meshes[slot], m_states[slot], m_worldTransforms[slot]);
+    }
+  }
+
+  const Stats &getStats() const { return m_stats; }
+
+private:
+  static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+  uint32_t slotOf(SceneNode node) const;
+  // Sorts the slots by depth and drops destroyed subtrees
+  void rebuildOrder();
+
+private:
+  // Indexed by slot
+  std::vector<SceneNode> m_nodes;
+  // Slot of the parent, NO_SLOT for roots
+  std::vector<uint32_t> m_parents;
+  std::vector<glm::vec3> m_translations;
+  std::vector<glm::quat> m_rotations;
+  std::vector<glm::vec3> m_scales;
+  std::vector<glm::mat4> m_worldTransforms;
+  // Local transform or parent changed since the last update()
+  std::vector<uint8_t> m_dirty;
+  // Cleared by destroyNode, the slot goes away with the next update()
+  std::vector<uint8_t> m_alive;
+  std::vector<uint32_t> m_meshes;
+  std::vector<PipelineState> m_states;
+
+  // Indexed by node handle, NO_SLOT for free handles
+  std::vector<uint32_t> m_slots;
+  std::vector<SceneNode> m_freeNodes;
+  bool m_orderDirty = false;
+
+  Stats m_stats;
+};
@@ -0,0 +1,99 @@
+#include "Core/Application.h"
+#include "RenderGraph/RenderGraph.h"
+
+#include <exception>
+#include <iostream>
+
+// Two transients with the same description and disjoint lifetimes end up in
+// the same memory. The first use of the second one has to wait for every
+// access to the first, its color write and the compute read after it.
+static bool checkAliasedTransients(RenderGraph &graph) {
+  RGImageDesc desc{VK_FORMAT_R8G8B8A8_UNORM, {256, 256}};
+
+  graph.reset();
+  RGResource first = graph.createImage("first", desc);
+  RGResource second = graph.createImage("second", desc);
+
+  graph.addPass(
+      "write first", RGPassType::Raster,
+      [&](RenderGraph::PassBuilder &pass) {
+        pass.writeColor(first, VK_ATTACHMENT_LOAD_OP_CLEAR);
+      },
+      [](VkCommandBuffer) {});
+  graph.addPass(
+      "read first", RGPassType::Compute,
+      [&](RenderGraph::PassBuilder &pass) {
+        pass.sampled(first, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .sideEffect();
+      },
+      [](VkCommandBuffer) {});
+  RGPass writeSecond = graph.addPass(
+      "write second", RGPassType::Raster,
+      [&](RenderGraph::PassBuilder &pass) {
+        pass.writeColor(second, VK_ATTACHMENT_LOAD_OP_CLEAR);
+      },
+      [](VkCommandBuffer) {});
+  graph.addPass(
+      "read second", RGPassType::Compute,
+      [&](RenderGraph::PassBuilder &pass) {
+        pass.sampled(second, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .sideEffect();
+      },
+      [](VkCommandBuffer) {});
+
+  graph.compile();
+
+  const RenderGraph::Stats &stats = graph.getStats();
+  if (stats.transientBytes >= stats.unaliasedBytes) {
+    std::cerr << "transients were not aliased\n";
+    return false;
+  }
+
+  const VkImageMemoryBarrier2 *p_barrier = nullptr;
+  for (const VkImageMemoryBarrier2 &barrier : graph.getBarriers(writeSecond)) {
+    if (barrier.image == graph.getImage(second))
+      p_barrier = &barrier;
+  }
+  if (p_barrier == nullptr) {
+    std::cerr << "no barrier before the first use of the alias\n";
+    return false;
+  }
+
+  const VkPipelineStageFlags2 waitStages =
+      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT |
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  if ((p_barrier->srcStageMask & waitStages) != waitStages ||
+      (p_barrier->srcAccessMask &
+       VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT) == 0) {
+    std::cerr << "alias does not wait on the previous user of its memory\n";
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  Core::ApplicationSpec appSpec;
+  appSpec.Name = "RenderGraphAliasing";
+  appSpec.Window.Width = 256;
+  appSpec.Window.Height = 256;
+  Core::Application application(appSpec);
+
+  ApplicationInfo appInfo(appSpec.Window.Width, appSpec.Window.Height, false,
+                          {});
+  VulkanContext context;
+  RenderGraph graph;
+  bool passed = false;
+  try {
+    context.init(appInfo);
+    // Nothing is destroyed through the deletion queue before shutdown
+    graph.init(&context, nullptr);
+    passed = checkAliasedTransients(graph);
+    graph.shutdown();
+    context.shutdown();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint32_t blockSize(BlockFormat format) {
+  return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+// Principal axis of the block colors through power iteration, endpoints are
+// the extremes of the texels projected onto it.
+static void fitEndpoints(const uint8_t *rgba, int channels, float lo[4],
+                         float hi[4]) {
+  float mean[4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < channels; c++)
+      mean[c] += rgba[i * 4 + c] / 16.0f;
+
+  float cov[4][4] = {};
+  for (int i = 0; i < 16; i++) {
+    for (int a = 0; a < channels; a++) {
+      for (int b = 0; b < channels; b++) {
+        cov[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+      }
+    }
+  }
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iter = 0; iter < 8; iter++) {
+    float next[4] = {};
+    for (int a = 0; a < channels; a++)
+      for (int b = 0; b < channels; b++)
+        next[a] += cov[a][b] * axis[b];
+
+    float len = 0.0f;
+    for (int c = 0; c < channels; c++)
+      len += next[c] * next[c];
+    len = std::sqrt(len);
+    if (len < 1e-6f)
+      break;
+    for (int c = 0; c < channels; c++)
+      axis[c] = next[c] / len;
+  }
+
+  float tMin = 0.0f, tMax = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++)
+      t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+    tMin = std::min(tMin, t);
+    tMax = std::max(tMax, t);
+  }
+
+  for (int c = 0; c < channels; c++) {
+    lo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+    hi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+  }
+}
+
+static int colorDistance(const uint8_t *a, const int *b, int channels) {
+  int dist = 0;
+  for (int c = 0; c < channels; c++) {
+    int d = a[c] - b[c];
+    dist += d * d;
+  }
+  return dist;
+}
+
+// --- BC1 ---
+
+static uint16_t packRGB565(const float color[3]) {
+  uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+  uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+  uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int color[3]) {
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+void encodeBC1Block(const uint8_t *rgba, uint8_t *out) {
+  float lo[4], hi[4];
+  fitEndpoints(rgba, 3, lo, hi);
+
+  uint16_t c0 = packRGB565(hi);
+  uint16_t c1 = packRGB565(lo);
+  // c0 > c1 selects the opaque four color mode
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    int palette[4][3];
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (int i = 0; i < 16; i++) {
+      uint32_t best = 0;
+      int bestDist = colorDistance(rgba + i * 4, palette[0], 3);
+      for (uint32_t p = 1; p < 4; p++) {
+        int dist = colorDistance(rgba + i * 4, palette[p], 3);
+        if (dist < bestDist) {
+          bestDist = dist;
+          best = p;
+        }
+      }
+      indices |= best << (2 * i);
+    }
+  }
+
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+// --- BC4 / BC5 ---
+
+static void encodeBC4Block(const uint8_t *rgba, int channel, uint8_t *out) {
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; i++) {
+    lo = std::min<int>(lo, rgba[i * 4 + channel]);
+    hi = std::max<int>(hi, rgba[i * 4 + channel]);
+  }
+
+  uint64_t indices = 0;
+  if (hi != lo) {
+    // hi > lo selects the eight value mode
+    int palette[8] = {hi, lo};
+    for (int p = 1; p < 7; p++)
+      palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+
+    for (int i = 0; i < 16; i++) {
+      int value = rgba[i * 4 + channel];
+      uint64_t best = 0;
+      int bestDist = std::abs(value - palette[0]);
+      for (uint64_t p = 1; p < 8; p++) {
+        int dist = std::abs(value - palette[p]);
+        if (dist < bestDist) {
+          bestDist = dist;
+          best = p;
+        }
+      }
+      indices |= best << (3 * i);
+    }
+  }
+
+  out[0] = static_cast<uint8_t>(hi);
+  out[1] = static_cast<uint8_t>(lo);
+  for (int b = 0; b < 6; b++)
+    out[2 + b] = static_cast<uint8_t>(indices >> (8 * b));
+}
+
+void encodeBC5Block(const uint8_t *rgba, uint8_t *out) {
+  encodeBC4Block(rgba, 0, out);
+  encodeBC4Block(rgba, 1, out + 8);
+}
+
+// --- BC7 (mode 6: one subset, RGBA 7.7.7.7 endpoints + p-bit, 4 bit
+// indices) ---
+
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t *out) : mp_out(out) { std::memset(out, 0, 16); }
+
+  void write(uint32_t value, uint32_t bits) {
+    for (uint32_t b = 0; b < bits; b++, m_pos++) {
+      if (value & (1u << b))
+        mp_out[m_pos / 8] |= static_cast<uint8_t>(1u << (m_pos % 8));
+    }
+  }
+
+private:
+  uint8_t *mp_out;
+  uint32_t m_pos = 0;
+};
+
+static void quantizeBC7Endpoint(const float endpoint[4], uint32_t quantized[4],
+                                uint32_t &pBit) {
+  float bestError = 0.0f;
+  for (uint32_t p = 0; p < 2; p++) {
+    uint32_t candidate[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      long q = std::lround((endpoint[c] - p) / 2.0f);
+      candidate[c] = static_cast<uint32_t>(std::clamp(q, 0l, 127l));
+      float d = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+      error += d * d;
+    }
+    if (p == 0 || error < bestError) {
+      bestError = error;
+      pBit = p;
+      std::memcpy(quantized, candidate, sizeof(candidate));
+    }
+  }
+}
+
+void encodeBC7Block(const uint8_t *rgba, uint8_t *out) {
+  static const int weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                  34, 38, 43, 47, 51, 55, 60, 64};
+
+  float lo[4], hi[4];
+  fitEndpoints(rgba, 4, lo, hi);
+
+  uint32_t endpoints[2][4];
+  uint32_t pBits[2];
+  quantizeBC7Endpoint(lo, endpoints[0], pBits[0]);
+  quantizeBC7Endpoint(hi, endpoints[1], pBits[1]);
+
+  int palette[16][4];
+  for (int c = 0; c < 4; c++) {
+    int e0 = static_cast<int>((endpoints[0][c] << 1) | pBits[0]);
+    int e1 = static_cast<int>((endpoints[1][c] << 1) | pBits[1]);
+    for (int i = 0; i < 16; i++)
+      palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+  }
+
+  uint32_t indices[16];
+  for (int i = 0; i < 16; i++) {
+    uint32_t best = 0;
+    int bestDist = colorDistance(rgba + i * 4, palette[0], 4);
+    for (uint32_t p = 1; p < 16; p++) {
+      int dist = colorDistance(rgba + i * 4, palette[p], 4);
+      if (dist < bestDist) {
+        bestDist = dist;
+        best = p;
+      }
+    }
+    indices[i] = best;
+  }
+
+  // The anchor index is stored with an implicit zero MSB
+  if (indices[0] & 8) {
+    std::swap(endpoints[0], endpoints[1]);
+    std::swap(pBits[0], pBits[1]);
+    for (uint32_t &index : indices)
+      index = 15 - index;
+  }
+
+  BitWriter writer(out);
+  writer.write(1u << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    writer.write(endpoints[0][c], 7);
+    writer.write(endpoints[1][c], 7);
+  }
+  writer.write(pBits[0], 1);
+  writer.write(pBits[1], 1);
+  writer.write(indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    writer.write(indices[i], 4);
+}
+
+std::vector<uint8_t> compressImage(const uint8_t *rgba, uint32_t width,
+                                   uint32_t height, BlockFormat format) {
+  uint32_t blocksX = (width + 3) / 4;
+  uint32_t blocksY = (height + 3) / 4;
+  uint32_t bytesPerBlock = blockSize(format);
+
+  std::vector<uint8_t> out(size_t(blocksX) * blocksY * bytesPerBlock);
+
+  uint8_t block[16 * 4];
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+          uint32_t srcX = std::min(bx * 4 + x, width - 1);
+          uint32_t srcY = std::min(by * 4 + y, height - 1);
+          std::memcpy(block + (y * 4 + x) * 4,
+                      rgba + (size_t(srcY) * width + srcX) * 4, 4);
+        }
+      }
+
+      uint8_t *dst = out.data() + (size_t(by) * blocksX + bx) * bytesPerBlock;
+      switch (format) {
+      case BlockFormat::BC1:
+        encodeBC1Block(block, dst);
+        break;
+      case BlockFormat::BC5:
+        encodeBC5Block(block, dst);
+        break;
+      case BlockFormat::BC7:
+        encodeBC7Block(block, dst);
+        break;
+      }
+    }
+  }
+
+  return out;
+}
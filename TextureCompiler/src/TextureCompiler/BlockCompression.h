@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class BlockFormat {
+  BC1, // RGB, 4 bpp
+  BC5, // Two channel (normal maps), 8 bpp
+  BC7, // RGBA, 8 bpp (mode 6 only)
+};
+
+// Bytes per 4x4 block
+uint32_t blockSize(BlockFormat format);
+
+// `rgba` is a 4x4 block of RGBA8 texels in row-major order
+void encodeBC1Block(const uint8_t *rgba, uint8_t *out);
+void encodeBC5Block(const uint8_t *rgba, uint8_t *out);
+void encodeBC7Block(const uint8_t *rgba, uint8_t *out);
+
+// Encodes a whole RGBA8 image, edge blocks are padded by clamping
+std::vector<uint8_t> compressImage(const uint8_t *rgba, uint32_t width,
+                                   uint32_t height, BlockFormat format);
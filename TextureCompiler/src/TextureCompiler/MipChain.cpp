@@ -0,0 +1,67 @@
+#include "MipChain.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+static float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f
+                         : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static MipLevel downsample(const MipLevel &src, bool srgb,
+                           const std::array<float, 256> &toLinear) {
+  MipLevel dst;
+  dst.width = std::max(src.width / 2, 1u);
+  dst.height = std::max(src.height / 2, 1u);
+  dst.rgba.resize(size_t(dst.width) * dst.height * 4);
+
+  for (uint32_t y = 0; y < dst.height; y++) {
+    for (uint32_t x = 0; x < dst.width; x++) {
+      uint32_t x0 = std::min(x * 2, src.width - 1);
+      uint32_t x1 = std::min(x * 2 + 1, src.width - 1);
+      uint32_t y0 = std::min(y * 2, src.height - 1);
+      uint32_t y1 = std::min(y * 2 + 1, src.height - 1);
+      const uint32_t taps[4][2] = {{x0, y0}, {x1, y0}, {x0, y1}, {x1, y1}};
+
+      for (int c = 0; c < 4; c++) {
+        bool linearize = srgb && c < 3;
+        float sum = 0.0f;
+        for (const auto &tap : taps) {
+          uint8_t value =
+              src.rgba[(size_t(tap[1]) * src.width + tap[0]) * 4 + c];
+          sum += linearize ? toLinear[value] : value / 255.0f;
+        }
+        float avg = sum / 4.0f;
+        if (linearize)
+          avg = linearToSrgb(avg);
+
+        dst.rgba[(size_t(y) * dst.width + x) * 4 + c] = static_cast<uint8_t>(
+            std::lround(std::clamp(avg, 0.0f, 1.0f) * 255.0f));
+      }
+    }
+  }
+
+  return dst;
+}
+
+std::vector<MipLevel> buildMipChain(const uint8_t *rgba, uint32_t width,
+                                    uint32_t height, bool srgb) {
+  std::array<float, 256> toLinear;
+  for (int i = 0; i < 256; i++)
+    toLinear[i] = srgbToLinear(i / 255.0f);
+
+  std::vector<MipLevel> chain;
+  chain.push_back({width, height,
+                   std::vector<uint8_t>(rgba, rgba + size_t(width) * height *
+                                                         4)});
+
+  while (chain.back().width > 1 || chain.back().height > 1) {
+    chain.push_back(downsample(chain.back(), srgb, toLinear));
+  }
+
+  return chain;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct MipLevel {
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> rgba;
+};
+
+// Box-filtered chain down to 1x1. sRGB inputs are filtered in linear space.
+std::vector<MipLevel> buildMipChain(const uint8_t *rgba, uint32_t width,
+                                    uint32_t height, bool srgb);
@@ -0,0 +1,180 @@
+#include "BlockCompression.h"
+#include "Common/Images/KTX2.h"
+#include "MipChain.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// VkFormat values, spelled out so the tool builds without the Vulkan SDK
+enum : uint32_t {
+  FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+  FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+  FORMAT_BC5_UNORM_BLOCK = 141,
+  FORMAT_BC7_UNORM_BLOCK = 145,
+  FORMAT_BC7_SRGB_BLOCK = 146,
+};
+
+// Khronos Data Format basic descriptor block for a 4x4 compressed format
+static std::vector<uint32_t> buildDataFormatDescriptor(BlockFormat format,
+                                                       bool srgb) {
+  struct Sample {
+    uint32_t bitOffset;
+    uint32_t bitLength;
+    uint32_t channel;
+  };
+
+  uint32_t colorModel = 0;
+  std::vector<Sample> samples;
+  switch (format) {
+  case BlockFormat::BC1:
+    colorModel = 128; // KHR_DF_MODEL_BC1A
+    samples = {{0, 64, 0}};
+    break;
+  case BlockFormat::BC5:
+    colorModel = 132; // KHR_DF_MODEL_BC5
+    samples = {{0, 64, 0}, {64, 64, 1}};
+    break;
+  case BlockFormat::BC7:
+    colorModel = 134; // KHR_DF_MODEL_BC7
+    samples = {{0, 128, 0}};
+    break;
+  }
+
+  const uint32_t primaries = 1; // BT709
+  const uint32_t transfer = srgb ? 2 : 1;
+  const uint32_t blockBytes = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+  std::vector<uint32_t> dfd;
+  dfd.push_back(4 + blockBytes);
+  dfd.push_back(0);                       // vendor / descriptor type
+  dfd.push_back(2 | (blockBytes << 16));  // version / block size
+  dfd.push_back(colorModel | (primaries << 8) | (transfer << 16));
+  dfd.push_back(3 | (3 << 8));            // 4x4 texel block
+  dfd.push_back(blockSize(format));       // bytesPlane0
+  dfd.push_back(0);
+  for (const Sample &sample : samples) {
+    dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) |
+                  (sample.channel << 24));
+    dfd.push_back(0);
+    dfd.push_back(0);
+    dfd.push_back(0xFFFFFFFF);
+  }
+
+  return dfd;
+}
+
+static uint32_t vkFormatFor(BlockFormat format, bool srgb) {
+  switch (format) {
+  case BlockFormat::BC1:
+    return srgb ? FORMAT_BC1_RGB_SRGB_BLOCK : FORMAT_BC1_RGB_UNORM_BLOCK;
+  case BlockFormat::BC5:
+    return FORMAT_BC5_UNORM_BLOCK;
+  case BlockFormat::BC7:
+    return srgb ? FORMAT_BC7_SRGB_BLOCK : FORMAT_BC7_UNORM_BLOCK;
+  }
+  return 0;
+}
+
+static void printUsage() {
+  std::cout << "usage: TextureCompiler <input> <output.ktx2> "
+               "[--format bc1|bc5|bc7] [--linear] [--no-mips]\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printUsage();
+    return 1;
+  }
+
+  std::string inputPath = argv[1];
+  std::string outputPath = argv[2];
+  BlockFormat format = BlockFormat::BC7;
+  bool srgb = true;
+  bool mips = true;
+
+  for (int i = 3; i < argc; i++) {
+    if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "bc1")
+        format = BlockFormat::BC1;
+      else if (name == "bc5")
+        format = BlockFormat::BC5;
+      else if (name == "bc7")
+        format = BlockFormat::BC7;
+      else {
+        printUsage();
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--linear") == 0) {
+      srgb = false;
+    } else if (std::strcmp(argv[i], "--no-mips") == 0) {
+      mips = false;
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  // Two channel data is never color
+  if (format == BlockFormat::BC5)
+    srgb = false;
+
+  auto start = std::chrono::steady_clock::now();
+
+  int width, height, channels;
+  stbi_uc *pixels = stbi_load(inputPath.c_str(), &width, &height, &channels,
+                              STBI_rgb_alpha);
+  if (!pixels) {
+    std::cerr << "failed to load " << inputPath << '\n';
+    return 1;
+  }
+
+  std::vector<MipLevel> chain =
+      buildMipChain(pixels, width, height, srgb);
+  stbi_image_free(pixels);
+  if (!mips)
+    chain.resize(1);
+
+  std::vector<std::vector<uint8_t>> levelData;
+  for (const MipLevel &level : chain) {
+    levelData.push_back(
+        compressImage(level.rgba.data(), level.width, level.height, format));
+  }
+
+  KTX2Texture texture;
+  texture.vkFormat = vkFormatFor(format, srgb);
+  texture.typeSize = 1;
+  texture.width = static_cast<uint32_t>(width);
+  texture.height = static_cast<uint32_t>(height);
+  texture.levelCount = static_cast<uint32_t>(levelData.size());
+
+  try {
+    writeKTX2(outputPath, texture, buildDataFormatDescriptor(format, srgb),
+              levelData, blockSize(format));
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+
+  size_t compressedBytes = 0;
+  for (const auto &level : levelData)
+    compressedBytes += level.size();
+
+  auto elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << inputPath << " -> " << outputPath << ": " << width << "x"
+            << height << ", " << levelData.size() << " levels, "
+            << compressedBytes / 1024 << " KiB ("
+            << size_t(width) * height * 4 / 1024 << " KiB as RGBA8), "
+            << elapsed.count() << " ms\n";
+
+  return 0;
+}